@@ -1,6 +1,15 @@
 #include "apiservice.h"
+#include "protocol.h"
 #include <QNetworkProxy>
-#include <QDebug>
+#include <QLoggingCategory>
+
+#include <algorithm>
+
+// События соединения
+Q_LOGGING_CATEGORY(lcApi, "timp.client.api")
+// Содержимое каждого кадра: выключено по умолчанию, включается через
+// QT_LOGGING_RULES="timp.client.traffic.debug=true"
+Q_LOGGING_CATEGORY(lcApiTraffic, "timp.client.traffic", QtInfoMsg)
 
 // Инициализация статических членов
 ApiService* ApiService::instance = nullptr;
@@ -21,7 +30,7 @@ ApiService* ApiService::getInstance() {
 
 // Приватный конструктор
 ApiService::ApiService(QObject *parent)
-    : QObject(parent), socket(new QTcpSocket(this)) {
+    : QObject(parent), socket(new QTcpSocket(this)), reconnectTimer(new QTimer(this)) {
 
     // Подключаем сигналы сокета
     connect(socket, &QTcpSocket::connected, this, &ApiService::handleConnected);
@@ -29,28 +38,49 @@ ApiService::ApiService(QObject *parent)
     connect(socket, &QTcpSocket::errorOccurred, this, &ApiService::handleError);
     connect(socket, &QTcpSocket::readyRead, this, &ApiService::handleReadyRead);
 
-    qDebug() << "ApiService создан";
+    // Переподключение к тому же серверу; на новом соединении снова с hello и в JSON
+    reconnectTimer->setSingleShot(true);
+    connect(reconnectTimer, &QTimer::timeout, this, [this]() {
+        qCDebug(lcApi) << "Переподключение, попытка" << reconnectAttempts;
+        cborMode = false;
+        helloPending = false;
+        socket->abort();
+        socket->connectToHost(host, port);
+    });
+
+    qCDebug(lcApi) << "ApiService создан";
 }
 
 ApiService::~ApiService() {
+    // закрытие сокета здесь не должно запускать переподключение
+    clearSession();
     if (socket) {
         socket->disconnectFromHost();
         socket->deleteLater();
     }
-    qDebug() << "ApiService уничтожен";
+    qCDebug(lcApi) << "ApiService уничтожен";
 }
 
 // Подключение к серверу
 void ApiService::connectToServer(const QString& host, quint16 port) {
-    qDebug() << "Попытка подключения к" << host << ":" << port;
+    qCDebug(lcApi) << "Попытка подключения к" << host << ":" << port;
+
+    // Явное подключение начинает всё заново: старая сессия к нему не относится
+    clearSession();
+    this->host = host;
+    this->port = port;
 
     // Отключаемся, если уже подключены
     if (socket->state() != QAbstractSocket::UnconnectedState) {
-        qDebug() << "Сокет уже подключен, отключаемся";
+        qCDebug(lcApi) << "Сокет уже подключен, отключаемся";
         socket->disconnectFromHost();
         socket->waitForDisconnected();
     }
 
+    // Новое соединение всегда начинается в JSON
+    cborMode = false;
+    helloPending = false;
+
     socket->setProxy(QNetworkProxy::NoProxy);
     socket->connectToHost(host, port);
 }
@@ -82,10 +112,13 @@ void ApiService::sendMessage(const QString& message) {
 }
 
 // Запрос истории сообщений
-void ApiService::requestMessageHistory(int limit) {
+void ApiService::requestMessageHistory(int limit, qint64 beforeId) {
     QJsonObject request;
     request["command"] = "get_history";
     request["limit"] = limit;
+    if (beforeId > 0) {
+        request["before_id"] = beforeId;
+    }
     sendJsonRequest(request);
 }
 
@@ -96,6 +129,98 @@ void ApiService::requestOnlineUsers() {
     sendJsonRequest(request);
 }
 
+// Поиск по сообщениям
+void ApiService::searchMessages(const QString& query, int offset, qint64 untilId) {
+    QJsonObject request;
+    request["command"] = "search";
+    request["query"] = query;
+    if (untilId > 0) {
+        request["offset"] = offset;
+        request["until_id"] = untilId;
+    }
+    sendJsonRequest(request);
+}
+
+// Отправка личного сообщения
+void ApiService::sendDirectMessage(const QString& recipient, const QString& message) {
+    QJsonObject request;
+    request["command"] = "send_direct";
+    request["to"] = recipient;
+    request["message"] = message;
+    sendJsonRequest(request);
+}
+
+// Вход в комнату
+void ApiService::joinRoom(const QString& room) {
+    QJsonObject request;
+    request["command"] = "join_room";
+    request["room"] = room;
+    sendJsonRequest(request);
+}
+
+// Выход из комнаты
+void ApiService::leaveRoom(const QString& room) {
+    QJsonObject request;
+    request["command"] = "leave_room";
+    request["room"] = room;
+    sendJsonRequest(request);
+}
+
+// Возобновление сессии после обрыва
+void ApiService::sendResumeRequest() {
+    QJsonObject request;
+    request["command"] = "resume";
+    request["token"] = sessionToken;
+    // У каждой комнаты свой курсор: общий максимум потерял бы пропущенное в менее активных комнатах
+    QJsonObject lastSeen;
+    for (auto it = lastSeenIds.cbegin(); it != lastSeenIds.cend(); ++it) {
+        lastSeen[it.key()] = it.value();
+    }
+    request["last_seen"] = lastSeen;
+    sendJsonRequest(request);
+}
+
+void ApiService::clearSession() {
+    sessionToken.clear();
+    lastSeenIds.clear();
+    resuming = false;
+    reconnectAttempts = 0;
+    reconnectTimer->stop();
+}
+
+void ApiService::noteSeen(const QJsonObject& message) {
+    // У сообщений, разосланных до сохранения (сервер в режиме relaxed), id нет
+    const qint64 id = message["id"].toInteger();
+    const QString room = message["room"].toString();
+    if (id <= 0 || room.isEmpty()) {
+        return;
+    }
+    qint64& seen = lastSeenIds[room];
+    seen = std::max(seen, id);
+}
+
+void ApiService::scheduleReconnect(const QString& reason) {
+    if (sessionToken.isEmpty()) {
+        emit connectionError(reason);
+        return;
+    }
+    // обрыв приходит и как errorOccurred, и как disconnected
+    if (reconnectTimer->isActive()) {
+        return;
+    }
+    if (reconnectAttempts >= MaxReconnectAttempts) {
+        qCWarning(lcApi) << "Не удалось возобновить сессию:" << reason;
+        clearSession();
+        emit connectionError(reason);
+        return;
+    }
+
+    ++reconnectAttempts;
+    resuming = true;
+    reconnectTimer->start(std::min(1000 << (reconnectAttempts - 1), MaxReconnectDelayMs));
+    emit reconnecting(reconnectAttempts);
+}
+
 // Проверка статуса подключения
 bool ApiService::isConnected() const {
     return socket->state() == QAbstractSocket::ConnectedState;
@@ -103,29 +228,31 @@ bool ApiService::isConnected() const {
 
 // Отправка JSON-запроса
 void ApiService::sendJsonRequest(const QJsonObject& request) {
-    QJsonDocument doc(request);
-    socket->write(doc.toJson(QJsonDocument::Compact) + "\n");
+    socket->write(Protocol::encodeFrame(request, cborMode));
+}
+
+// Согласование формата кадров
+void ApiService::sendHello() {
+    QJsonObject request;
+    request["command"] = "hello";
+    request["protocols"] = QJsonArray{"cbor"};
+    helloPending = true;
+    sendJsonRequest(request);
 }
 
 // Обработка входящих данных
 void ApiService::handleReadyRead() {
-    qDebug() << "Получены данные от сервера";
-    while (socket->canReadLine()) {
-        QByteArray line = socket->readLine().trimmed();
-        qDebug() << "Получено:" << QString(line);
-
-        // Парсинг JSON
-        QJsonParseError parseError;
-        QJsonDocument response = QJsonDocument::fromJson(line, &parseError);
-
+    qCDebug(lcApiTraffic) << "Получены данные от сервера";
+    QJsonDocument response;
+    bool ok = false;
+    while (Protocol::readFrame(socket, response, ok)) {
         // Проверка ошибок парсинга
-        if (parseError.error != QJsonParseError::NoError) {
-            qDebug() << "Ошибка парсинга JSON:" << parseError.errorString();
-            emit connectionError("Ошибка парсинга JSON");
+        if (!ok) {
+            qCWarning(lcApi) << "Ошибка разбора кадра";
+            emit connectionError("Ошибка парсинга ответа сервера");
             return;
         }
 
-        qDebug() << "JSON разобран:" << response.toJson();
         processResponse(response);
     }
 }
@@ -134,19 +261,48 @@ void ApiService::handleReadyRead() {
 // Обработка ответа сервера
 void ApiService::processResponse(const QJsonDocument& response) {
     QJsonObject obj = response.object();
-    qDebug() << "Обработка ответа:" << response.toJson();
+    // Разбор кадра логируется только если категория включена (QT_LOGGING_RULES)
+    qCDebug(lcApiTraffic) << "Обработка ответа:" << obj;
 
     // Проверка на наличие полей status и message
     if (obj.contains("status")) {
         QString status = obj["status"].toString();
         QString message = obj["message"].toString();
 
-        qDebug() << "Статус ответа:" << status << message;
+        // Старый сервер не знает команду hello — остаёмся на JSON
+        if (helloPending && status == "error" && message == "unknown command") {
+            helloPending = false;
+            return;
+        }
+
+        qCDebug(lcApiTraffic) << "Статус ответа:" << status << message;
+
+        // Ответ на resume
+        if (resuming) {
+            if (status == "ok" && message.contains("session resumed")) {
+                qCDebug(lcApi) << "Сессия возобновлена";
+                resuming = false;
+                reconnectAttempts = 0;
+                emit sessionResumed();
+                return;
+            }
+            // Сервер ещё не заметил обрыв старого соединения — пробуем позже
+            if (status == "error" && message.contains("already online")) {
+                socket->abort();
+                scheduleReconnect("Не удалось возобновить сессию");
+                return;
+            }
+            if (status == "error" && message.contains("invalid session")) {
+                clearSession();
+                emit connectionError("Сессия истекла, войдите заново");
+                return;
+            }
+        }
 
         if (status == "ok") {
             // Успешный логин
             if (message.contains("success login")) {
-                qDebug() << "Отправка сигнала loginSuccess";
+                qCDebug(lcApi) << "Отправка сигнала loginSuccess";
                 emit loginSuccess("Авторизация успешна");
             }
             // Успешная регистрация
@@ -181,13 +337,27 @@ void ApiService::processResponse(const QJsonDocument& response) {
     if (obj.contains("type")) {
         QString type = obj["type"].toString();
 
+        // Ответ на hello: с этого момента запросы можно слать в CBOR
+        if (type == "hello") {
+            helloPending = false;
+            cborMode = obj["protocol"].toString() == "cbor";
+            qCDebug(lcApi) << "Формат кадров:" << obj["protocol"].toString();
+        }
         // Обычное сообщение
-        if (type == "message") {
+        else if (type == "message") {
+            noteSeen(obj);
             QString sender = obj["sender"].toString();
             QString content = obj["content"].toString();
             QString timestamp = obj["timestamp"].toString();
             emit messageReceived(sender, content, timestamp);
         }
+        // Личное сообщение
+        else if (type == "direct") {
+            QString sender = obj["sender"].toString();
+            QString content = obj["content"].toString();
+            QString timestamp = obj["timestamp"].toString();
+            emit directMessageReceived(sender, content, timestamp);
+        }
         // Системное сообщение
         else if (type == "system") {
             QString content = obj["content"].toString();
@@ -197,7 +367,29 @@ void ApiService::processResponse(const QJsonDocument& response) {
         // История сообщений
         else if (type == "history") {
             QJsonArray messages = obj["messages"].toArray();
-            emit historyReceived(messages);
+            for (const QJsonValue &value : messages) {
+                noteSeen(value.toObject());
+            }
+
+            // После resume приходят только пропущенные сообщения: дописываем их, а не заменяем историю
+            if (obj.contains("since_id")) {
+                for (const QJsonValue &value : messages) {
+                    QJsonObject message = value.toObject();
+                    emit messageReceived(message["sender"].toString(), message["content"].toString(),
+                                         message["timestamp"].toString());
+                }
+            } else {
+                emit historyReceived(messages);
+            }
+        }
+        // Результаты поиска
+        else if (type == "search_results") {
+            emit searchResultsReceived(obj["results"].toArray(), obj["has_more"].toBool());
+        }
+        // Токен для возобновления сессии после обрыва
+        else if (type == "session") {
+            sessionToken = obj["token"].toString();
+            reconnectAttempts = 0;
         }
         // Список пользователей онлайн
         else if (type == "online_users") {
@@ -208,23 +400,34 @@ void ApiService::processResponse(const QJsonDocument& response) {
             }
             emit onlineUsersReceived(users);
         }
+        // Изменение списка онлайн: сервер присылает только вошедшего/вышедшего
+        else if (type == "presence_delta") {
+            QString user = obj["user"].toString();
+            bool joined = obj["event"].toString() == "join";
+            emit presenceChanged(user, joined);
+        }
     }
 }
 
 // Обработка успешного подключения
 void ApiService::handleConnected() {
-    qDebug() << "Подключение установлено";
+    qCDebug(lcApi) << "Подключение установлено";
+    sendHello();
+    if (resuming) {
+        sendResumeRequest();
+        return;
+    }
     emit connected();
 }
 
 // Обработка разрыва соединения
 void ApiService::handleDisconnected() {
-    qDebug() << "Соединение разорвано";
-    emit connectionError("Соединение с сервером потеряно");
+    qCDebug(lcApi) << "Соединение разорвано";
+    scheduleReconnect("Соединение с сервером потеряно");
 }
 
 // Обработка ошибок сокета
 void ApiService::handleError(QAbstractSocket::SocketError error) {
-    qDebug() << "Ошибка сокета:" << error << socket->errorString();
-    emit connectionError("Ошибка сети: " + socket->errorString());
+    qCWarning(lcApi) << "Ошибка сокета:" << error << socket->errorString();
+    scheduleReconnect("Ошибка сети: " + socket->errorString());
 }
@@ -2,11 +2,13 @@
 #define APISERVICE_H
 
 #include <QObject>
+#include <QHash>
 #include <QTcpSocket>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QMutex>
+#include <QTimer>
 
 /**
  * @brief Класс ApiService реализует API-клиент для общения с сервером.
@@ -58,14 +60,47 @@ public:
     /**
      * @brief Запрашивает историю сообщений.
      * @param limit Количество сообщений (по умолчанию 50).
+     * @param beforeId Курсор before_id из предыдущего ответа — страница более старых сообщений (0 — последние).
      */
-    void requestMessageHistory(int limit = 50);
+    void requestMessageHistory(int limit = 50, qint64 beforeId = 0);
 
     /**
      * @brief Запрашивает список онлайн-пользователей.
      */
     void requestOnlineUsers();
 
+    /**
+     * @brief Ищет сообщения общей комнаты по словам.
+     * @param query Слова запроса; "слово*" — поиск по префиксу.
+     * @param offset Курсор offset из предыдущего ответа.
+     * @param untilId Снимок until_id из предыдущего ответа (0 — первая страница).
+     */
+    void searchMessages(const QString& query, int offset = 0, qint64 untilId = 0);
+
+    /**
+     * @brief Отправляет личное сообщение одному пользователю.
+     * @param recipient Имя получателя.
+     * @param message Текст сообщения.
+     */
+    void sendDirectMessage(const QString& recipient, const QString& message);
+
+    /**
+     * @brief Входит в комнату; сервер пришлёт её историю.
+     * @param room Имя комнаты.
+     */
+    void joinRoom(const QString& room);
+
+    /**
+     * @brief Выходит из комнаты.
+     * @param room Имя комнаты.
+     */
+    void leaveRoom(const QString& room);
+
+    /**
+     * @brief Забывает токен сессии: следующий обрыв связи уже не переподключает.
+     */
+    void clearSession();
+
     /**
      * @brief Проверяет, установлено ли соединение с сервером.
      * @return true если подключено, иначе false.
@@ -109,6 +144,17 @@ signals:
      */
     void connected();
 
+    /**
+     * @brief Связь потеряна, идёт переподключение с токеном сессии.
+     * @param attempt Номер попытки, начиная с 1.
+     */
+    void reconnecting(int attempt);
+
+    /**
+     * @brief Сессия возобновлена: пропущенные сообщения уже пришли.
+     */
+    void sessionResumed();
+
     // --- Сигналы, связанные с чатом ---
     /**
      * @brief Получено новое сообщение от пользователя.
@@ -118,6 +164,14 @@ signals:
      */
     void messageReceived(const QString& sender, const QString& content, const QString& timestamp);
 
+    /**
+     * @brief Получено личное сообщение (в том числе накопленное, пока пользователь был офлайн).
+     * @param sender Отправитель.
+     * @param content Содержание.
+     * @param timestamp Метка времени.
+     */
+    void directMessageReceived(const QString& sender, const QString& content, const QString& timestamp);
+
     /**
      * @brief Получено системное сообщение.
      * @param content Содержание.
@@ -137,6 +191,20 @@ signals:
      */
     void onlineUsersReceived(const QStringList& users);
 
+    /**
+     * @brief Пользователь вошёл в чат или вышел из него (presence_delta).
+     * @param user Имя пользователя.
+     * @param joined true — вошёл, false — вышел.
+     */
+    void presenceChanged(const QString& user, bool joined);
+
+    /**
+     * @brief Получены результаты поиска.
+     * @param results Найденные сообщения (id, sender, snippet, timestamp, rank), лучшие первыми.
+     * @param hasMore Есть следующая страница (курсор — rank и id последнего результата).
+     */
+    void searchResultsReceived(const QJsonArray& results, bool hasMore);
+
     /**
      * @brief Ошибка при отправке сообщения.
      * @param error Описание ошибки.
@@ -166,6 +234,9 @@ private slots:
     void handleReadyRead();
 
 private:
+    /// Бенчмарки вызывают processResponse напрямую, без сокета
+    friend class BenchController;
+
     /// Приватный конструктор для реализации синглтона
     explicit ApiService(QObject *parent = nullptr);
 
@@ -176,6 +247,48 @@ private:
     static QMutex mutex;         ///< Мьютекс для потокобезопасности
 
     QTcpSocket* socket;          ///< TCP-сокет клиента
+    bool cborMode = false;       ///< Сервер согласился на CBOR-кадры (после hello)
+    bool helloPending = false;   ///< Ответ на hello ещё не получен
+
+    // --- Возобновление сессии ---
+    static constexpr int MaxReconnectAttempts = 8;   ///< После них сессия считается потерянной
+    static constexpr int MaxReconnectDelayMs = 30000; ///< Потолок экспоненциальной задержки
+
+    QString host;                ///< Адрес последнего connectToServer
+    quint16 port = 0;            ///< Порт последнего connectToServer
+    QString sessionToken;        ///< Токен из ответа session; пусто — не авторизован
+    QHash<QString, qint64> lastSeenIds; ///< Комната -> наибольший id полученного из неё сообщения
+    bool resuming = false;       ///< Соединение восстанавливается командой resume
+    int reconnectAttempts = 0;   ///< Попыток с момента обрыва
+    QTimer *reconnectTimer;      ///< Задержка перед следующей попыткой
+
+    /**
+     * @brief Планирует переподключение после обрыва, если есть сессия.
+     *
+     * Задержка растёт как 1, 2, 4... с, но не больше MaxReconnectDelayMs.
+     * Повторный вызов, пока попытка уже запланирована, ничего не делает.
+     * @param reason Текст для connectionError, если переподключаться нечем.
+     */
+    void scheduleReconnect(const QString& reason);
+
+    /**
+     * @brief Отправляет токен сессии и последние полученные id по комнатам (команда resume).
+     */
+    void sendResumeRequest();
+
+    /**
+     * @brief Запоминает id сообщения, если он больше уже полученных из его комнаты.
+     */
+    void noteSeen(const QJsonObject& message);
+
+    /**
+     * @brief Отправляет серверу список поддерживаемых форматов кадров.
+     *
+     * Запросы продолжают уходить в JSON, пока сервер не ответит "hello" с
+     * протоколом "cbor". Старый сервер ответит ошибкой "unknown command" —
+     * тогда клиент просто остаётся на JSON.
+     */
+    void sendHello();
 
     /**
      * @brief Отправляет JSON-запрос на сервер.
@@ -0,0 +1,325 @@
+#include "benchcontroller.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QXmlStreamReader>
+
+namespace {
+
+// --- Корпуса сообщений ---
+
+QString shortMessage(int i)
+{
+    return QString("привет, как дела? %1").arg(i);
+}
+
+QString longMessage(int i)
+{
+    QString text;
+    for (int j = 0; j < 40; ++j) {
+        text += QString("это длинное сообщение номер %1, строка %2 без разметки. ").arg(i).arg(j);
+    }
+    return text;
+}
+
+QString emojiMessage(int i)
+{
+    static const QStringList names = {"smile", "heart", "laugh", "wink", "sad", "fire", "ok", "party", "cat", "dog"};
+    QString text;
+    for (int j = 0; j < 20; ++j) {
+        text += ":" + names[(i + j) % names.size()] + ": ";
+    }
+    return text;
+}
+
+QString markdownMessage(int i)
+{
+    QString text;
+    for (int j = 0; j < 20; ++j) {
+        text += QString("**важно %1** и *курсив %2* ").arg(i).arg(j);
+    }
+    return text;
+}
+
+QString corpusMessage(const QString &corpus, int i)
+{
+    if (corpus == "short") return shortMessage(i);
+    if (corpus == "long") return longMessage(i);
+    if (corpus == "emoji") return emojiMessage(i);
+    if (corpus == "markdown") return markdownMessage(i);
+    // смешанный: как в живом чате, в основном короткие
+    switch (i % 10) {
+    case 0: return longMessage(i);
+    case 1: case 2: return emojiMessage(i);
+    case 3: return markdownMessage(i);
+    default: return shortMessage(i);
+    }
+}
+
+void addCorpusRows()
+{
+    QTest::addColumn<QString>("corpus");
+    for (const char *corpus : {"short", "long", "emoji", "markdown", "mixed"}) {
+        QTest::newRow(corpus) << QString(corpus);
+    }
+}
+
+QJsonObject messageObject(const QString &corpus, int i)
+{
+    QJsonObject message;
+    message["type"] = "message";
+    message["sender"] = QString("user%1").arg(i % 17);
+    message["content"] = corpusMessage(corpus, i);
+    message["timestamp"] = "2025-01-01T12:00:00";
+    return message;
+}
+
+void addHistoryRows()
+{
+    QTest::addColumn<QString>("corpus");
+    QTest::addColumn<int>("size");
+    for (int size : {50, 200}) {
+        for (const char *corpus : {"short", "mixed"}) {
+            QTest::addRow("%s-%d", corpus, size) << QString(corpus) << size;
+        }
+    }
+}
+
+// Кадр истории в том виде, в каком он приходит с сервера
+QJsonDocument historyDocument(const QString &corpus, int size)
+{
+    QJsonArray messages;
+    for (int i = 0; i < size; ++i) {
+        messages.append(messageObject(corpus, i));
+    }
+    QJsonObject history;
+    history["type"] = "history";
+    history["messages"] = messages;
+    return QJsonDocument(history);
+}
+
+} // namespace
+
+void BenchController::benchFormatMessage_data()
+{
+    addCorpusRows();
+}
+
+void BenchController::benchFormatMessage()
+{
+    QFETCH(QString, corpus);
+    const QString message = corpusMessage(corpus, 1);
+
+    QBENCHMARK {
+        MessageFormatter::formatMessage(message);
+    }
+}
+
+void BenchController::benchConvertEmojis_data()
+{
+    addCorpusRows();
+}
+
+void BenchController::benchConvertEmojis()
+{
+    QFETCH(QString, corpus);
+    const QString message = corpusMessage(corpus, 1);
+
+    QBENCHMARK {
+        EmojiConverter::convertEmojis(message);
+    }
+}
+
+void BenchController::benchProcessMessage_data()
+{
+    addCorpusRows();
+}
+
+void BenchController::benchProcessMessage()
+{
+    QFETCH(QString, corpus);
+    // разбор кадра тоже часть работы клиента, поэтому меряем от байтов
+    const QByteArray frame = QJsonDocument(messageObject(corpus, 1)).toJson(QJsonDocument::Compact);
+    ApiService *api = ApiService::getInstance();
+
+    QBENCHMARK {
+        api->processResponse(QJsonDocument::fromJson(frame));
+    }
+}
+
+void BenchController::benchProcessHistory_data()
+{
+    addHistoryRows();
+}
+
+void BenchController::benchProcessHistory()
+{
+    QFETCH(QString, corpus);
+    QFETCH(int, size);
+    const QByteArray frame = historyDocument(corpus, size).toJson(QJsonDocument::Compact);
+    ApiService *api = ApiService::getInstance();
+
+    QBENCHMARK {
+        api->processResponse(QJsonDocument::fromJson(frame));
+    }
+}
+
+void BenchController::benchRenderHistory_data()
+{
+    addHistoryRows();
+}
+
+void BenchController::benchRenderHistory()
+{
+    QFETCH(QString, corpus);
+    QFETCH(int, size);
+    const QByteArray frame = historyDocument(corpus, size).toJson(QJsonDocument::Compact);
+    ApiService *api = ApiService::getInstance();
+
+    // то же, что делает Dialog::onHistoryLoaded, но без виджета
+    QStringList rendered;
+    QMetaObject::Connection connection =
+        connect(api, &ApiService::historyReceived, this, [&rendered](const QJsonArray &messages) {
+            rendered.clear();
+            for (const QJsonValue &value : messages) {
+                QJsonObject message = value.toObject();
+                rendered.append(QString("<b>[%1] %2:</b> %3").arg(message["timestamp"].toString(),
+                                                                  message["sender"].toString(),
+                                                                  MessageFormatter::formatMessage(
+                                                                      message["content"].toString())));
+            }
+        });
+
+    QBENCHMARK {
+        api->processResponse(QJsonDocument::fromJson(frame));
+    }
+
+    disconnect(connection);
+    QCOMPARE(rendered.size(), size);
+}
+
+// --- Базовые результаты ---
+
+namespace {
+
+// Результаты из XML-отчёта QtTest: "функция/тег" -> значение метрики
+QHash<QString, double> readResults(const QString &xmlPath)
+{
+    QHash<QString, double> results;
+    QFile file(xmlPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return results;
+    }
+
+    QXmlStreamReader xml(&file);
+    QString function;
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        if (xml.name() == QLatin1String("TestFunction")) {
+            function = xml.attributes().value("name").toString();
+        } else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            const QString tag = xml.attributes().value("tag").toString();
+            results[function + "/" + tag] = xml.attributes().value("value").toDouble();
+        }
+    }
+    return results;
+}
+
+bool saveBaseline(const QHash<QString, double> &results, const QString &path)
+{
+    QJsonObject baseline;
+    for (auto it = results.cbegin(); it != results.cend(); ++it) {
+        baseline[it.key()] = it.value();
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(QJsonDocument(baseline).toJson());
+    return true;
+}
+
+// Печатает сравнение; возвращает число регрессий сверх порога (в процентах)
+int compareBaseline(const QHash<QString, double> &results, const QString &path, double threshold)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QTextStream(stderr) << "cannot read baseline " << path << "\n";
+        return 1;
+    }
+    const QJsonObject baseline = QJsonDocument::fromJson(file.readAll()).object();
+
+    QStringList keys = results.keys();
+    keys.sort();
+
+    QTextStream out(stdout);
+    int regressions = 0;
+    for (const QString &key : keys) {
+        if (!baseline.contains(key) || baseline[key].toDouble() <= 0) {
+            out << qSetFieldWidth(40) << Qt::left << key << qSetFieldWidth(0) << " new\n";
+            continue;
+        }
+        const double before = baseline[key].toDouble();
+        const double change = (results[key] - before) / before * 100.0;
+        const bool regressed = change > threshold;
+        regressions += regressed;
+        out << qSetFieldWidth(40) << Qt::left << key << qSetFieldWidth(0)
+            << QString(" %1 -> %2 (%3%4%)").arg(before).arg(results[key])
+                   .arg(change >= 0 ? "+" : "").arg(change, 0, 'f', 1)
+            << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    return regressions;
+}
+
+} // namespace
+
+// Запуск: timp_bench [--save-baseline file] [--baseline file] [--threshold pct] [аргументы QtTest]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QString savePath;
+    QString comparePath;
+    double threshold = 10.0;
+    QStringList testArgs = {app.arguments().first()};
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--save-baseline" && i + 1 < args.size()) {
+            savePath = args[++i];
+        } else if (args[i] == "--baseline" && i + 1 < args.size()) {
+            comparePath = args[++i];
+        } else if (args[i] == "--threshold" && i + 1 < args.size()) {
+            threshold = args[++i].toDouble();
+        } else {
+            testArgs.append(args[i]);
+        }
+    }
+
+    BenchController bench;
+    if (savePath.isEmpty() && comparePath.isEmpty()) {
+        return QTest::qExec(&bench, testArgs);
+    }
+
+    // для сравнения нужен машиночитаемый отчёт; на консоль по-прежнему идёт обычный вывод
+    QTemporaryFile report;
+    if (!report.open()) {
+        return 1;
+    }
+    report.close();
+    testArgs << "-o" << report.fileName() + ",xml" << "-o" << "-,txt";
+
+    int result = QTest::qExec(&bench, testArgs);
+    const QHash<QString, double> results = readResults(report.fileName());
+
+    if (!savePath.isEmpty() && !saveBaseline(results, savePath)) {
+        QTextStream(stderr) << "cannot write baseline " << savePath << "\n";
+        result = 1;
+    }
+    if (!comparePath.isEmpty() && compareBaseline(results, comparePath, threshold) > 0) {
+        result = 1;
+    }
+    return result;
+}
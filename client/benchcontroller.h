@@ -0,0 +1,43 @@
+#ifndef BENCHCONTROLLER_H
+#define BENCHCONTROLLER_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include "messageformatter.h"
+#include "emojiconverter.h"
+#include "apiservice.h"
+
+/**
+ * @brief Класс BenchController — микробенчмарки клиента (QBENCHMARK).
+ *
+ * Корпуса сообщений: короткие, длинные, с эмодзи, с разметкой. История —
+ * 50 и 200 записей, как её присылает сервер. Запуск с --save-baseline /
+ * --baseline сохраняет результаты или сравнивает их с сохранёнными.
+ */
+class BenchController : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // форматтер сообщений на разных корпусах
+    void benchFormatMessage_data();
+    void benchFormatMessage();
+
+    // только замена эмодзи
+    void benchConvertEmojis_data();
+    void benchConvertEmojis();
+
+    // разбор одного входящего сообщения
+    void benchProcessMessage_data();
+    void benchProcessMessage();
+
+    // разбор истории (50 и 200 записей)
+    void benchProcessHistory_data();
+    void benchProcessHistory();
+
+    // разбор истории и форматирование каждой записи, как в Dialog::onHistoryLoaded
+    void benchRenderHistory_data();
+    void benchRenderHistory();
+};
+
+#endif // BENCHCONTROLLER_H
@@ -1,4 +1,5 @@
 #include "chatcontroller.h"
+#include <QDateTime>
 #include <QDebug>
 
 ChatController::ChatController(QObject *parent)
@@ -25,10 +26,15 @@ void ChatController::connectApiSignals() {
     connect(apiService, &ApiService::registerSuccess, this, &ChatController::onApiRegisterSuccess);
     connect(apiService, &ApiService::registerError, this, &ChatController::onApiRegisterError);
     connect(apiService, &ApiService::messageReceived, this, &ChatController::onApiMessageReceived);
+    connect(apiService, &ApiService::directMessageReceived, this, &ChatController::onApiDirectMessageReceived);
     connect(apiService, &ApiService::systemMessageReceived, this, &ChatController::onApiSystemMessageReceived);
     connect(apiService, &ApiService::historyReceived, this, &ChatController::onApiHistoryReceived);
     connect(apiService, &ApiService::onlineUsersReceived, this, &ChatController::onApiOnlineUsersReceived);
+    connect(apiService, &ApiService::presenceChanged, this, &ChatController::onApiPresenceChanged);
     connect(apiService, &ApiService::messageSendError, this, &ChatController::onApiMessageSendError);
+    connect(apiService, &ApiService::searchResultsReceived, this, &ChatController::onApiSearchResultsReceived);
+    connect(apiService, &ApiService::reconnecting, this, &ChatController::onApiReconnecting);
+    connect(apiService, &ApiService::sessionResumed, this, &ChatController::onApiSessionResumed);
 }
 
 // Методы для взаимодействия с сервером через ApiService
@@ -59,9 +65,19 @@ void ChatController::sendMessage(const QString& message) {
     apiService->sendMessage(message);
 }
 
-void ChatController::requestHistory(int limit) {
+void ChatController::sendDirectMessage(const QString& recipient, const QString& message) {
+    qDebug() << "ChatController: Отправка личного сообщения для" << recipient;
+    if (!isLoggedIn()) {
+        emit messageFailedToSend("Вы не авторизованы");
+        return;
+    }
+
+    apiService->sendDirectMessage(recipient, message);
+}
+
+void ChatController::requestHistory(int limit, qint64 beforeId) {
     qDebug() << "ChatController: Запрос истории сообщений, лимит:" << limit;
-    apiService->requestMessageHistory(limit);
+    apiService->requestMessageHistory(limit, beforeId);
 }
 
 void ChatController::requestOnlineUsers() {
@@ -69,6 +85,16 @@ void ChatController::requestOnlineUsers() {
     apiService->requestOnlineUsers();
 }
 
+void ChatController::search(const QString& query) {
+    qDebug() << "ChatController: Поиск сообщений:" << query;
+    if (!isLoggedIn()) {
+        emit messageFailedToSend("Вы не авторизованы");
+        return;
+    }
+
+    apiService->searchMessages(query);
+}
+
 bool ChatController::isConnected() const {
     return apiService->isConnected();
 }
@@ -90,6 +116,7 @@ void ChatController::onApiConnected() {
 
 void ChatController::onApiConnectionError(const QString& error) {
     qDebug() << "ChatController: Ошибка соединения:" << error;
+    // Сюда доходят только ошибки, после которых сессию возобновить не удалось
     loggedIn = false; // Сбрасываем флаг авторизации при ошибке соединения
     emit connectionFailed(error);
 }
@@ -123,6 +150,11 @@ void ChatController::onApiMessageReceived(const QString& sender, const QString&
     emit messageReceived(sender, content, timestamp);
 }
 
+void ChatController::onApiDirectMessageReceived(const QString& sender, const QString& content, const QString& timestamp) {
+    qDebug() << "ChatController: Получено личное сообщение от" << sender;
+    emit directMessageReceived(sender, content, timestamp);
+}
+
 void ChatController::onApiSystemMessageReceived(const QString& content, const QString& timestamp) {
     qDebug() << "ChatController: Получено системное сообщение:" << content;
     emit systemMessageReceived(content, timestamp);
@@ -138,7 +170,31 @@ void ChatController::onApiOnlineUsersReceived(const QStringList& users) {
     emit onlineUsersUpdated(users);
 }
 
+void ChatController::onApiPresenceChanged(const QString& user, bool joined) {
+    qDebug() << "ChatController: Изменение присутствия" << user << joined;
+    emit presenceChanged(user, joined);
+}
+
 void ChatController::onApiMessageSendError(const QString& error) {
     qDebug() << "ChatController: Ошибка отправки сообщения:" << error;
     emit messageFailedToSend(error);
 }
+
+void ChatController::onApiSearchResultsReceived(const QJsonArray& results, bool hasMore) {
+    qDebug() << "ChatController: Найдено сообщений:" << results.size();
+    emit searchResultsReceived(results, hasMore);
+}
+
+void ChatController::onApiReconnecting(int attempt) {
+    qDebug() << "ChatController: Переподключение, попытка" << attempt;
+    // loggedIn не сбрасываем: после resume сервер вернёт ту же сессию
+    emit systemMessageReceived(QString("Связь потеряна, переподключение (попытка %1)…").arg(attempt),
+                               QDateTime::currentDateTime().toString(Qt::ISODate));
+}
+
+void ChatController::onApiSessionResumed() {
+    qDebug() << "ChatController: Сессия возобновлена для" << currentUser;
+    loggedIn = true;
+    emit systemMessageReceived("Соединение восстановлено",
+                               QDateTime::currentDateTime().toString(Qt::ISODate));
+}
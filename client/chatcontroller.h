@@ -53,17 +53,31 @@ public:
      */
     void sendMessage(const QString& message);
 
+    /**
+     * @brief Отправляет личное сообщение.
+     * @param recipient Имя получателя.
+     * @param message Текст сообщения.
+     */
+    void sendDirectMessage(const QString& recipient, const QString& message);
+
     /**
      * @brief Запрашивает историю сообщений.
      * @param limit Количество сообщений (по умолчанию 50).
+     * @param beforeId Курсор для более старой страницы (0 — последние сообщения).
      */
-    void requestHistory(int limit = 50);
+    void requestHistory(int limit = 50, qint64 beforeId = 0);
 
     /**
      * @brief Запрашивает список онлайн-пользователей.
      */
     void requestOnlineUsers();
 
+    /**
+     * @brief Ищет сообщения по словам.
+     * @param query Текст запроса.
+     */
+    void search(const QString& query);
+
     /**
      * @brief Проверяет, установлено ли соединение с сервером.
      * @return true если подключено.
@@ -134,6 +148,11 @@ signals:
      */
     void messageReceived(const QString& sender, const QString& content, const QString& timestamp);
 
+    /**
+     * @brief Получено личное сообщение.
+     */
+    void directMessageReceived(const QString& sender, const QString& content, const QString& timestamp);
+
     /**
      * @brief Получено системное сообщение.
      */
@@ -149,6 +168,16 @@ signals:
      */
     void onlineUsersUpdated(const QStringList& users);
 
+    /**
+     * @brief Пользователь вошёл или вышел.
+     */
+    void presenceChanged(const QString& user, bool joined);
+
+    /**
+     * @brief Получены результаты поиска.
+     */
+    void searchResultsReceived(const QJsonArray& results, bool hasMore);
+
 private slots:
     // --- Слоты для приёма сигналов от ApiService ---
     void onApiConnected();
@@ -158,10 +187,15 @@ private slots:
     void onApiRegisterSuccess(const QString& message);
     void onApiRegisterError(const QString& error);
     void onApiMessageReceived(const QString& sender, const QString& content, const QString& timestamp);
+    void onApiDirectMessageReceived(const QString& sender, const QString& content, const QString& timestamp);
     void onApiSystemMessageReceived(const QString& content, const QString& timestamp);
     void onApiHistoryReceived(const QJsonArray& messages);
     void onApiOnlineUsersReceived(const QStringList& users);
+    void onApiPresenceChanged(const QString& user, bool joined);
     void onApiMessageSendError(const QString& error);
+    void onApiSearchResultsReceived(const QJsonArray& results, bool hasMore);
+    void onApiReconnecting(int attempt);
+    void onApiSessionResumed();
 
 private:
     ApiService* apiService; ///< Указатель на экземпляр ApiService
@@ -1,6 +1,7 @@
 #include "dialog.h"
 #include <QMessageBox>
 #include <QScrollBar>
+#include <algorithm>
 #include "ui_dialog.h"
 #include "messageformatter.h"
 
@@ -52,12 +53,18 @@ void Dialog::connectControllerSignals() {
     // Подключаем сигналы ChatController к слотам Dialog
     connect(chatController, &ChatController::messageReceived,
             this, &Dialog::onMessageReceived);
+    connect(chatController, &ChatController::directMessageReceived,
+            this, &Dialog::onDirectMessageReceived);
     connect(chatController, &ChatController::systemMessageReceived,
             this, &Dialog::onSystemMessageReceived);
     connect(chatController, &ChatController::historyLoaded,
             this, &Dialog::onHistoryLoaded);
     connect(chatController, &ChatController::onlineUsersUpdated,
             this, &Dialog::onOnlineUsersUpdated);
+    connect(chatController, &ChatController::presenceChanged,
+            this, &Dialog::onPresenceChanged);
+    connect(chatController, &ChatController::searchResultsReceived,
+            this, &Dialog::onSearchResults);
     connect(chatController, &ChatController::messageFailedToSend,
             this, &Dialog::onMessageFailedToSend);
     connect(chatController, &ChatController::connectionFailed,
@@ -73,7 +80,25 @@ void Dialog::onSendButtonClicked()
 
     // Отправляем сообщение через контроллер
     if (chatController && chatController->isConnected()) {
-        chatController->sendMessage(message);
+        // "/msg имя текст" — личное сообщение
+        // "/search слова" — поиск по истории комнаты
+        if (message.startsWith("/search ")) {
+            QString query = message.section(' ', 1).trimmed();
+            if (query.isEmpty()) {
+                return;
+            }
+            chatController->search(query);
+        } else if (message.startsWith("/msg ")) {
+            QString recipient = message.section(' ', 1, 1);
+            QString text = message.section(' ', 2).trimmed();
+            if (recipient.isEmpty() || text.isEmpty()) {
+                return;
+            }
+            chatController->sendDirectMessage(recipient, text);
+            displayMessage("вы → " + recipient, text, QDateTime::currentDateTime().toString(Qt::ISODate));
+        } else {
+            chatController->sendMessage(message);
+        }
         ui->messageEdit->clear();
         ui->messageEdit->setFocus();
     } else {
@@ -94,6 +119,14 @@ void Dialog::onMessageReceived(const QString &sender,
     displayMessage(sender, content, timestamp);
 }
 
+void Dialog::onDirectMessageReceived(const QString &sender,
+                                     const QString &content,
+                                     const QString &timestamp)
+{
+    qDebug() << "ДИАЛОГ: получил личное сообщение от" << sender;
+    displayMessage(sender + " → вам", content, timestamp);
+}
+
 void Dialog::onSystemMessageReceived(const QString &content, const QString &timestamp)
 {
     qDebug() << "ДИАЛОГ: получил системное сообщение:" << content;
@@ -131,6 +164,29 @@ void Dialog::onOnlineUsersUpdated(const QStringList &users)
     updateOnlineUsers(users);
 }
 
+void Dialog::onPresenceChanged(const QString &user, bool joined)
+{
+    updateOnlineUsers(user, joined);
+}
+
+void Dialog::onSearchResults(const QJsonArray &results, bool hasMore)
+{
+    QString now = QDateTime::currentDateTime().toString(Qt::ISODate);
+    displaySystemMessage(QString("Найдено: %1%2").arg(results.size()).arg(hasMore ? "+" : ""), now);
+
+    for (const QJsonValue &value : results) {
+        QJsonObject result = value.toObject();
+        // Сервер обрамляет совпадения символами STX/ETX; текст экранируется до подстановки тегов
+        QString snippet = result["snippet"].toString().toHtmlEscaped();
+        snippet.replace(QChar(0x02), "<span style=\"background-color:#fff3a0\">");
+        snippet.replace(QChar(0x03), "</span>");
+
+        QString time = formatTimestamp(result["timestamp"].toString());
+        ui->messageHistory->append(QString("<i>[%1] %2:</i> %3")
+                                       .arg(time, result["sender"].toString().toHtmlEscaped(), snippet));
+    }
+}
+
 void Dialog::onMessageFailedToSend(const QString &error)
 {
     QMessageBox::warning(this, "Ошибка отправки", error);
@@ -169,12 +225,36 @@ void Dialog::displaySystemMessage(const QString &content, const QString &timesta
 
 void Dialog::updateOnlineUsers(const QStringList &users)
 {
-    ui->onlineUser->clear();
-    ui->onlineUser->append("<b>Пользователи онлайн:</b>");
+    // Сервер присылает список уже отсортированным
+    onlineUsers = users;
+    renderOnlineUsers();
+}
 
-    for (const QString &user : users) {
-        ui->onlineUser->append(user);
+void Dialog::updateOnlineUsers(const QString &user, bool joined)
+{
+    // Держим список отсортированным: ищем место бинарным поиском
+    auto it = std::lower_bound(onlineUsers.begin(), onlineUsers.end(), user);
+    bool present = it != onlineUsers.end() && *it == user;
+
+    if (joined && !present) {
+        onlineUsers.insert(it, user);
+    } else if (!joined && present) {
+        onlineUsers.erase(it);
+    } else {
+        return; // ничего не изменилось
+    }
+
+    renderOnlineUsers();
+}
+
+void Dialog::renderOnlineUsers()
+{
+    // Один setHtml вместо append на каждого пользователя
+    QString html = "<b>Пользователи онлайн:</b>";
+    for (const QString &user : onlineUsers) {
+        html += "<br>" + user.toHtmlEscaped();
     }
+    ui->onlineUser->setHtml(html);
 }
 
 QString Dialog::formatTimestamp(const QString &isoTimestamp)
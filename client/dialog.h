@@ -54,6 +54,14 @@ private slots:
      */
     void onMessageReceived(const QString &sender, const QString &content, const QString &timestamp);
 
+    /**
+     * @brief Обработка входящего личного сообщения.
+     * @param sender Отправитель.
+     * @param content Содержимое.
+     * @param timestamp Метка времени.
+     */
+    void onDirectMessageReceived(const QString &sender, const QString &content, const QString &timestamp);
+
     /**
      * @brief Обработка входящего системного сообщения.
      * @param content Содержимое.
@@ -73,6 +81,20 @@ private slots:
      */
     void onOnlineUsersUpdated(const QStringList &users);
 
+    /**
+     * @brief Обработка входа/выхода одного пользователя.
+     * @param user Имя пользователя.
+     * @param joined true — вошёл, false — вышел.
+     */
+    void onPresenceChanged(const QString &user, bool joined);
+
+    /**
+     * @brief Показывает результаты поиска (/search) с подсветкой совпадений.
+     * @param results Найденные сообщения.
+     * @param hasMore Есть ещё результаты.
+     */
+    void onSearchResults(const QJsonArray &results, bool hasMore);
+
     /**
      * @brief Обработка ошибки при отправке сообщения.
      * @param error Описание ошибки.
@@ -88,6 +110,7 @@ private slots:
 private:
     Ui::Dialog *ui; ///< Сгенерированный UI-интерфейс
     ChatController *chatController; ///< Контроллер бизнес-логики
+    QStringList onlineUsers;        ///< Отсортированный список онлайн-пользователей
 
     // --- Вспомогательные методы ---
 
@@ -102,10 +125,20 @@ private:
     void displaySystemMessage(const QString &content, const QString &timestamp);
 
     /**
-     * @brief Обновляет список онлайн-пользователей.
+     * @brief Заменяет список онлайн-пользователей полным снимком.
      */
     void updateOnlineUsers(const QStringList &users);
 
+    /**
+     * @brief Применяет к списку онлайн-пользователей одно изменение (presence_delta).
+     */
+    void updateOnlineUsers(const QString &user, bool joined);
+
+    /**
+     * @brief Перерисовывает список онлайн-пользователей одним setHtml.
+     */
+    void renderOnlineUsers();
+
     /**
      * @brief Преобразует ISO-дату во формат для отображения.
      * @param isoTimestamp Метка времени ISO 8601.
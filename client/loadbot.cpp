@@ -0,0 +1,177 @@
+#include "loadbot.h"
+#include "protocol.h"
+#include <QJsonArray>
+#include <QNetworkProxy>
+#include <QRandomGenerator>
+
+// Маркер сообщений генератора: "lg <бот> <номер> <время отправки, нс> <заполнитель>"
+static const QString MessageTag = QStringLiteral("lg");
+
+LoadBot::LoadBot(int index, const LoadConfig& config, LoadStats& stats, const QElapsedTimer& clock,
+                 QObject* parent)
+    : QObject(parent), index(index), config(config), stats(stats), clock(clock),
+      socket(new QTcpSocket(this)), sendTimer(new QTimer(this)),
+      username(config.userPrefix + QString::number(index)),
+      filler(qMax(0, config.messageSize - 32), QLatin1Char('x')) {
+
+    connect(socket, &QTcpSocket::connected, this, &LoadBot::handleConnected);
+    connect(socket, &QTcpSocket::readyRead, this, &LoadBot::handleReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &LoadBot::handleDisconnected);
+    connect(socket, &QTcpSocket::errorOccurred, this, &LoadBot::handleDisconnected);
+    connect(sendTimer, &QTimer::timeout, this, &LoadBot::tick);
+
+    sendTimer->setTimerType(Qt::PreciseTimer);
+}
+
+void LoadBot::start() {
+    socket->setProxy(QNetworkProxy::NoProxy);
+    socket->connectToHost(config.host, config.port);
+}
+
+void LoadBot::startSending() {
+    if (!loggedIn || config.rate <= 0) {
+        return;
+    }
+
+    // случайная фаза, чтобы боты не отправляли сообщения одновременно
+    const int interval = qMax(1, int(1000.0 / config.rate));
+    sendTimer->setInterval(interval);
+    QTimer::singleShot(QRandomGenerator::global()->bounded(interval), sendTimer, qOverload<>(&QTimer::start));
+}
+
+void LoadBot::stopSending() {
+    sendTimer->stop();
+}
+
+void LoadBot::abortLogin() {
+    if (loginDone) {
+        return;
+    }
+    ++stats.loginFailures;
+    loginDone = true;
+    socket->abort();
+    emit loginFinished(false);
+}
+
+bool LoadBot::isLoggedIn() const {
+    return loggedIn;
+}
+
+void LoadBot::handleConnected() {
+    if (config.cbor) {
+        QJsonObject hello;
+        hello["command"] = "hello";
+        hello["protocols"] = QJsonArray{"cbor"};
+        send(hello);
+    }
+
+    if (config.registerUsers) {
+        QJsonObject request;
+        request["command"] = "register";
+        request["username"] = username;
+        request["password"] = config.password;
+        registering = true;
+        send(request);
+        return;
+    }
+    sendLogin();
+}
+
+void LoadBot::sendLogin() {
+    QJsonObject request;
+    request["command"] = "login";
+    request["username"] = username;
+    request["password"] = config.password;
+    loginStartedNs = clock.nsecsElapsed();
+    send(request);
+}
+
+void LoadBot::send(const QJsonObject& request) {
+    socket->write(Protocol::encodeFrame(request, cborMode));
+}
+
+void LoadBot::tick() {
+    if (QRandomGenerator::global()->generateDouble() < config.historyRatio) {
+        QJsonObject request;
+        request["command"] = "get_history";
+        request["limit"] = 50;
+        send(request);
+        ++stats.historyRequests;
+        return;
+    }
+
+    QJsonObject request;
+    request["command"] = "send_message";
+    request["message"] = QString("%1 %2 %3 %4 %5").arg(MessageTag).arg(index).arg(++sequence)
+                                                  .arg(clock.nsecsElapsed()).arg(filler);
+    send(request);
+    ++stats.sent;
+}
+
+void LoadBot::handleReadyRead() {
+    QJsonDocument response;
+    bool ok = false;
+    while (Protocol::readFrame(socket, response, ok)) {
+        if (!ok) {
+            ++stats.errors;
+            socket->abort();
+            return;
+        }
+        ++stats.received;
+        processResponse(response.object());
+    }
+}
+
+void LoadBot::processResponse(const QJsonObject& obj) {
+    if (obj.contains("status")) {
+        const QString status = obj["status"].toString();
+        const QString message = obj["message"].toString();
+
+        if (status == "error" && message == "unknown command") {
+            // старый сервер не знает hello
+        } else if (registering) {
+            // пользователь мог остаться с прошлого запуска, а занятый сервер мог отказать — всё равно пробуем войти
+            registering = false;
+            sendLogin();
+        } else if (message == "success login") {
+            stats.loginLatencyUs.append((clock.nsecsElapsed() - loginStartedNs) / 1000);
+            loggedIn = true;
+            loginDone = true;
+            emit loginFinished(true);
+        } else if (status == "error" && !loginDone) {
+            // любой отказ на login (неверный пароль, уже онлайн, сервер занят) завершает вход
+            ++stats.loginFailures;
+            loginDone = true;
+            emit loginFinished(false);
+        } else if (status == "error") {
+            ++stats.errors;
+        }
+        return;
+    }
+
+    const QString type = obj["type"].toString();
+    if (type == "hello") {
+        cborMode = obj["protocol"].toString() == "cbor";
+    } else if (type == "message") {
+        // задержку считает каждый получатель: это и есть время рассылки
+        const QStringList parts = obj["content"].toString().split(' ');
+        if (parts.size() >= 4 && parts[0] == MessageTag) {
+            const qint64 sentNs = parts[3].toLongLong();
+            stats.broadcastLatencyUs.append((clock.nsecsElapsed() - sentNs) / 1000);
+        }
+    }
+}
+
+void LoadBot::handleDisconnected() {
+    sendTimer->stop();
+    if (!loginDone) {
+        ++stats.loginFailures;
+        loginDone = true;
+        emit loginFinished(false);
+        return;
+    }
+    if (loggedIn) {
+        loggedIn = false;
+        ++stats.errors;
+    }
+}
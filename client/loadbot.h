@@ -0,0 +1,125 @@
+#ifndef LOADBOT_H
+#define LOADBOT_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+
+/**
+ * @brief Параметры нагрузки, общие для всех ботов.
+ */
+struct LoadConfig {
+    QString host = "127.0.0.1";   ///< Адрес сервера
+    quint16 port = 1234;          ///< Порт сервера
+    int bots = 100;               ///< Число ботов
+    double rate = 1.0;            ///< Сообщений в секунду на одного бота
+    int durationSec = 30;         ///< Длительность фазы отправки
+    int loginTimeoutSec = 60;     ///< Сколько ждать входа после подключения последнего бота
+    int rampMs = 5;               ///< Пауза между подключениями ботов
+    int messageSize = 64;         ///< Размер текста сообщения, байт
+    double historyRatio = 0.0;    ///< Доля запросов get_history среди действий бота
+    bool registerUsers = true;    ///< Регистрировать пользователей перед входом
+    bool cbor = true;             ///< Предлагать серверу CBOR-кадры
+    QString userPrefix = "bot";   ///< Префикс имён ботов
+    QString password = "loadgen"; ///< Пароль ботов
+};
+
+/**
+ * @brief Общие результаты всех ботов (генератор однопоточный, блокировки не нужны).
+ */
+struct LoadStats {
+    QList<qint64> loginLatencyUs;     ///< Время от запроса login до ответа "success login"
+    QList<qint64> broadcastLatencyUs; ///< Время от отправки сообщения до его получения каждым ботом
+    qint64 loginFailures = 0;         ///< Неудачные входы
+    qint64 sent = 0;                  ///< Отправлено сообщений
+    qint64 historyRequests = 0;       ///< Отправлено запросов истории
+    qint64 received = 0;              ///< Получено кадров всех типов
+    qint64 errors = 0;                ///< Ответы с ошибкой и разрывы соединения
+};
+
+/**
+ * @brief Класс LoadBot — один безголовый клиент чата для генератора нагрузки.
+ *
+ * Использует тот же протокол, что и ApiService (Protocol::encodeFrame/readFrame),
+ * но без синглтона и виджетов, поэтому в одном процессе живут тысячи ботов.
+ * В текст каждого сообщения вшиты номер бота и время отправки, так что любой
+ * получатель может посчитать сквозную задержку рассылки.
+ */
+class LoadBot : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * @brief Конструктор.
+     * @param index Номер бота (часть имени пользователя).
+     * @param config Параметры нагрузки.
+     * @param stats Общие результаты.
+     * @param clock Общие часы процесса, от которых считаются метки времени.
+     * @param parent Родительский объект.
+     */
+    LoadBot(int index, const LoadConfig& config, LoadStats& stats, const QElapsedTimer& clock,
+            QObject* parent = nullptr);
+
+    /**
+     * @brief Подключается к серверу и входит в чат.
+     */
+    void start();
+
+    /**
+     * @brief Начинает отправлять сообщения с заданной частотой.
+     */
+    void startSending();
+
+    /**
+     * @brief Прекращает отправку (соединение остаётся, чтобы дослушать рассылки).
+     */
+    void stopSending();
+
+    /**
+     * @brief Прерывает незавершённый вход: он засчитывается как неудачный.
+     */
+    void abortLogin();
+
+    /**
+     * @brief Вошёл ли бот в чат.
+     */
+    bool isLoggedIn() const;
+
+signals:
+    /**
+     * @brief Бот завершил вход (успешно или нет).
+     * @param ok true если вход удался.
+     */
+    void loginFinished(bool ok);
+
+private slots:
+    void handleConnected();
+    void handleReadyRead();
+    void handleDisconnected();
+    void tick();
+
+private:
+    void send(const QJsonObject& request);
+    void sendLogin();
+    void processResponse(const QJsonObject& obj);
+
+    int index;
+    const LoadConfig& config;
+    LoadStats& stats;
+    const QElapsedTimer& clock;
+
+    QTcpSocket* socket;
+    QTimer* sendTimer;
+    QString username;
+    QString filler;               ///< Заполнитель до messageSize
+    bool cborMode = false;
+    bool loggedIn = false;
+    bool registering = false;     ///< Ждёт ответа на register
+    bool loginDone = false;
+    qint64 loginStartedNs = 0;
+    qint64 sequence = 0;
+};
+
+#endif // LOADBOT_H
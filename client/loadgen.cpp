@@ -0,0 +1,190 @@
+#include "loadbot.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QDebug>
+#include <QTextStream>
+#include <algorithm>
+
+// Генератор нагрузки: N ботов входят в чат и пишут сообщения с заданной частотой.
+// Результат — JSON с задержками входа и рассылки (p50/p99/p999) и пропускной способностью.
+
+namespace {
+
+// Перцентили по отсортированной выборке, микросекунды
+QJsonObject summarize(QList<qint64> samples) {
+    QJsonObject result;
+    result["count"] = samples.size();
+    if (samples.isEmpty()) {
+        return result;
+    }
+
+    std::ranges::sort(samples);
+    auto at = [&samples](double q) {
+        return samples[qMin(samples.size() - 1, qsizetype(q * samples.size()))];
+    };
+    result["p50_us"] = at(0.5);
+    result["p99_us"] = at(0.99);
+    result["p999_us"] = at(0.999);
+    result["max_us"] = samples.last();
+    return result;
+}
+
+LoadConfig parseConfig(const QCoreApplication& app, QString& outputPath) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("timp load generator");
+    parser.addHelpOption();
+
+    const QCommandLineOption hostOption("host", "server address", "host", "127.0.0.1");
+    const QCommandLineOption portOption("port", "server port", "port", "1234");
+    const QCommandLineOption botsOption("bots", "number of simulated users", "count", "100");
+    const QCommandLineOption rateOption("rate", "messages per second per bot", "rate", "1");
+    const QCommandLineOption durationOption("duration", "length of the sending phase, seconds", "sec", "30");
+    const QCommandLineOption rampOption("ramp", "delay between bot connections, ms", "ms", "5");
+    const QCommandLineOption loginTimeoutOption("login-timeout", "how long to wait for logins after the last bot "
+                                                "connected, seconds", "sec", "60");
+    const QCommandLineOption sizeOption("message-size", "message text size, bytes", "bytes", "64");
+    const QCommandLineOption historyOption("history-ratio", "share of actions that are get_history (0..1)",
+                                           "ratio", "0");
+    const QCommandLineOption noRegisterOption("no-register", "log in existing users without registering them");
+    const QCommandLineOption jsonOnlyOption("json-only", "do not offer cbor frames to the server");
+    const QCommandLineOption prefixOption("user-prefix", "bot username prefix", "prefix", "bot");
+    const QCommandLineOption passwordOption("password", "bot password", "password", "loadgen");
+    const QCommandLineOption outputOption("output", "write the JSON report to a file instead of stdout", "path");
+    parser.addOptions({hostOption, portOption, botsOption, rateOption, durationOption, rampOption, sizeOption,
+                       loginTimeoutOption, historyOption, noRegisterOption, jsonOnlyOption, prefixOption,
+                       passwordOption, outputOption});
+    parser.process(app);
+
+    LoadConfig config;
+    config.host = parser.value(hostOption);
+    config.port = parser.value(portOption).toUShort();
+    config.bots = parser.value(botsOption).toInt();
+    config.rate = parser.value(rateOption).toDouble();
+    config.durationSec = parser.value(durationOption).toInt();
+    config.rampMs = parser.value(rampOption).toInt();
+    config.loginTimeoutSec = parser.value(loginTimeoutOption).toInt();
+    config.messageSize = parser.value(sizeOption).toInt();
+    config.historyRatio = parser.value(historyOption).toDouble();
+    config.registerUsers = !parser.isSet(noRegisterOption);
+    config.cbor = !parser.isSet(jsonOnlyOption);
+    config.userPrefix = parser.value(prefixOption);
+    config.password = parser.value(passwordOption);
+    outputPath = parser.value(outputOption);
+    return config;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QString outputPath;
+    const LoadConfig config = parseConfig(app, outputPath);
+
+    LoadStats stats;
+    QElapsedTimer clock;
+    clock.start();
+
+    QList<LoadBot*> bots;
+    int loginsFinished = 0;
+    qint64 loginPhaseNs = 0;
+    qint64 sendPhaseStartNs = 0;
+    qint64 sendPhaseNs = 0;
+    qint64 sentBefore = 0;
+    qint64 receivedBefore = 0;
+
+    auto writeReport = [&] {
+        QJsonObject configJson;
+        configJson["host"] = config.host;
+        configJson["port"] = config.port;
+        configJson["bots"] = config.bots;
+        configJson["rate"] = config.rate;
+        configJson["duration_s"] = config.durationSec;
+        configJson["message_size"] = config.messageSize;
+        configJson["history_ratio"] = config.historyRatio;
+        configJson["cbor"] = config.cbor;
+
+        QJsonObject login = summarize(stats.loginLatencyUs);
+        login["failed"] = stats.loginFailures;
+        login["phase_s"] = loginPhaseNs / 1e9;
+        login["per_sec"] = loginPhaseNs > 0 ? stats.loginLatencyUs.size() / (loginPhaseNs / 1e9) : 0.0;
+
+        const double sendSeconds = sendPhaseNs / 1e9;
+        QJsonObject throughput;
+        throughput["sent"] = stats.sent - sentBefore;
+        throughput["received"] = stats.received - receivedBefore;
+        throughput["sent_per_sec"] = sendSeconds > 0 ? (stats.sent - sentBefore) / sendSeconds : 0.0;
+        throughput["received_per_sec"] = sendSeconds > 0 ? (stats.received - receivedBefore) / sendSeconds : 0.0;
+        throughput["history_requests"] = stats.historyRequests;
+
+        QJsonObject report;
+        report["config"] = configJson;
+        report["login"] = login;
+        report["broadcast"] = summarize(stats.broadcastLatencyUs);
+        report["throughput"] = throughput;
+        report["errors"] = stats.errors;
+
+        const QByteArray json = QJsonDocument(report).toJson();
+        if (outputPath.isEmpty()) {
+            QTextStream(stdout) << json;
+            return;
+        }
+        QFile file(outputPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            file.write(json);
+        }
+    };
+
+    auto startSendPhase = [&] {
+        loginPhaseNs = clock.nsecsElapsed();
+        sendPhaseStartNs = loginPhaseNs;
+        sentBefore = stats.sent;
+        receivedBefore = stats.received;
+        for (LoadBot* bot : bots) {
+            bot->startSending();
+        }
+
+        QTimer::singleShot(config.durationSec * 1000, &app, [&] {
+            for (LoadBot* bot : bots) {
+                bot->stopSending();
+            }
+            sendPhaseNs = clock.nsecsElapsed() - sendPhaseStartNs;
+            // даём рассылкам дойти до получателей
+            QTimer::singleShot(2000, &app, [&] {
+                writeReport();
+                QCoreApplication::quit();
+            });
+        });
+    };
+
+    if (config.bots <= 0) {
+        qWarning() << "nothing to do: --bots must be positive";
+        return 1;
+    }
+
+    for (int i = 0; i < config.bots; ++i) {
+        auto* bot = new LoadBot(i, config, stats, clock, &app);
+        bots.append(bot);
+        QObject::connect(bot, &LoadBot::loginFinished, &app, [&] {
+            if (++loginsFinished == config.bots) {
+                startSendPhase();
+            }
+        });
+        QTimer::singleShot(i * config.rampMs, bot, &LoadBot::start);
+    }
+
+    // бот, которому сервер так и не ответил, не должен держать всю фазу входа
+    const qint64 loginDeadlineMs = qint64(config.bots) * config.rampMs + qint64(config.loginTimeoutSec) * 1000;
+    QTimer::singleShot(std::chrono::milliseconds(loginDeadlineMs), &app, [&] {
+        if (loginsFinished == config.bots) {
+            return;
+        }
+        qWarning() << "login timeout:" << config.bots - loginsFinished << "bots did not finish logging in";
+        for (LoadBot* bot : bots) {
+            bot->abortLogin();
+        }
+    });
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,53 @@
+#include "protocol.h"
+#include <QCborMap>
+#include <QCborValue>
+#include <QtEndian>
+
+QByteArray Protocol::encodeFrame(const QJsonObject& request, bool cbor) {
+    if (!cbor) {
+        return QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n";
+    }
+
+    // CBOR-кадр: 4 байта длины + CBOR-словарь
+    QByteArray payload = QCborValue(QCborMap::fromJsonObject(request)).toCbor();
+    QByteArray frame(4, Qt::Uninitialized);
+    qToBigEndian<quint32>(payload.size(), frame.data());
+    return frame + payload;
+}
+
+bool Protocol::readFrame(QIODevice* device, QJsonDocument& document, bool& ok) {
+    char first;
+    if (device->peek(&first, 1) != 1) {
+        return false;
+    }
+
+    // JSON-строка никогда не начинается с нулевого байта
+    if (first != 0) {
+        if (!device->canReadLine()) {
+            return false;
+        }
+        QByteArray line = device->readLine().trimmed();
+
+        QJsonParseError parseError;
+        document = QJsonDocument::fromJson(line, &parseError);
+        ok = parseError.error == QJsonParseError::NoError;
+        return true;
+    }
+
+    char prefix[4];
+    if (device->peek(prefix, sizeof prefix) != sizeof prefix) {
+        return false;
+    }
+    qint64 length = qFromBigEndian<quint32>(prefix);
+    if (device->bytesAvailable() < qint64(sizeof prefix) + length) {
+        return false;
+    }
+
+    device->skip(sizeof prefix);
+    QCborValue cbor = QCborValue::fromCbor(device->read(length));
+    ok = cbor.isMap();
+    if (ok) {
+        document = QJsonDocument(cbor.toMap().toJsonObject());
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+/**
+ * @brief Кадрирование протокола чата, общее для клиента и генератора нагрузки.
+ *
+ * JSON-кадр — компактная JSON-строка с переводом строки в конце.
+ * CBOR-кадр — 4 байта длины (big-endian, старший байт 0) и CBOR-словарь.
+ * Формат входящего кадра определяется по первому байту.
+ */
+namespace Protocol {
+    /**
+     * @brief Кодирует запрос в кадр.
+     * @param request JSON-объект запроса.
+     * @param cbor true — CBOR-кадр, false — JSON-строка.
+     * @return Готовый к записи в сокет кадр.
+     */
+    QByteArray encodeFrame(const QJsonObject& request, bool cbor);
+
+    /**
+     * @brief Извлекает из устройства следующий полный кадр.
+     * @param device Сокет или другой QIODevice.
+     * @param document Разобранный кадр.
+     * @param ok false если кадр не удалось разобрать.
+     * @return false если полного кадра в буфере ещё нет.
+     */
+    bool readFrame(QIODevice* device, QJsonDocument& document, bool& ok);
+}
+
+#endif // PROTOCOL_H
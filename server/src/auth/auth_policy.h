@@ -0,0 +1,18 @@
+#ifndef AUTH_POLICY_H
+#define AUTH_POLICY_H
+
+/**
+ * @brief Параметры хэширования паролей и пула, в котором оно выполняется.
+ *
+ * PBKDF2 намеренно медленный (десятки миллисекунд на вход), поэтому он
+ * выполняется вне циклов событий в отдельном ограниченном пуле потоков
+ * с пониженным приоритетом: шторм входов или перебор паролей не может
+ * отнять процессор у доставки сообщений.
+ */
+struct AuthPolicy {
+    int iterations = 100000; ///< Итераций PBKDF2-HMAC-SHA256; хэши с меньшим числом пересчитываются при входе
+    int threads = 2;         ///< Потоков хэширования
+    int maxPending = 64;     ///< Заданий в пуле (в очереди и в работе), сверх которых вход и регистрация отклоняются
+};
+
+#endif // AUTH_POLICY_H
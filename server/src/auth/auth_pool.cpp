@@ -0,0 +1,52 @@
+#include "auth_pool.h"
+
+#include <algorithm>
+
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+AuthPool &AuthPool::instance() {
+    static AuthPool authPool;
+    return authPool;
+}
+
+void AuthPool::start(const AuthPolicy &policy) {
+    authPolicy = policy;
+    authPolicy.threads = std::max(authPolicy.threads, 1);
+    authPolicy.maxPending = std::max(authPolicy.maxPending, authPolicy.threads);
+
+    pendingGauge = &Metrics::instance().gauge("timp_auth_pending", "password hashing jobs queued or running");
+    rejected = &Metrics::instance().counter("timp_auth_rejected_total",
+                                            "logins and registrations refused because the auth pool was full");
+
+    pool.setMaxThreadCount(authPolicy.threads);
+    // message delivery wins any contention for a core
+    pool.setThreadPriority(QThread::LowPriority);
+    qCInfo(lcServer) << "auth pool:" << authPolicy.threads << "threads," << authPolicy.iterations
+                     << "PBKDF2 iterations";
+}
+
+void AuthPool::stop() {
+    pool.waitForDone();
+}
+
+const AuthPolicy &AuthPool::policy() const {
+    return authPolicy;
+}
+
+bool AuthPool::reserve() {
+    int current = pending.load(std::memory_order_relaxed);
+    do {
+        if (current >= authPolicy.maxPending) {
+            rejected->add();
+            return false;
+        }
+    } while (!pending.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+
+    pendingGauge->set(current + 1);
+    return true;
+}
+
+void AuthPool::release() {
+    pendingGauge->set(pending.fetch_sub(1, std::memory_order_relaxed) - 1);
+}
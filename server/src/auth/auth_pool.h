@@ -0,0 +1,89 @@
+#ifndef AUTH_POOL_H
+#define AUTH_POOL_H
+
+#include <QPointer>
+#include <QThreadPool>
+
+#include <atomic>
+#include <type_traits>
+
+#include "auth_policy.h"
+#include "util/caller_thread.h"
+
+class Counter;
+class Gauge;
+
+/**
+ * @brief Класс AuthPool — ограниченный пул потоков для хэширования паролей.
+ *
+ * В отличие от StorageExecutor, задания независимы и выполняются параллельно.
+ * Число заданий в пуле ограничено AuthPolicy::maxPending: лишние отклоняются
+ * сразу, а не копятся в очереди, так что всплеск входов получает быстрый
+ * отказ, а циклы событий и поток хранилища — свои ядра.
+ */
+class AuthPool {
+public:
+    /**
+     * @brief Возвращает единственный экземпляр.
+     */
+    static AuthPool &instance();
+
+    /**
+     * @brief Настраивает пул.
+     */
+    void start(const AuthPolicy &policy);
+
+    /**
+     * @brief Дожидается выполнения начатых заданий.
+     */
+    void stop();
+
+    /**
+     * @brief Текущие параметры хэширования.
+     */
+    [[nodiscard]] const AuthPolicy &policy() const;
+
+    /**
+     * @brief Выполняет job в пуле и передаёт результат в completion.
+     *
+     * completion вызывается в потоке, который вызвал submit(), и только если
+     * context к тому моменту ещё существует.
+     * @return false если пул переполнен и задание не принято.
+     */
+    template<typename Job, typename Completion>
+    bool submit(QObject *context, Job job, Completion completion) {
+        if (!reserve()) {
+            return false;
+        }
+
+        QPointer<QObject> guard(context);
+        QObject *sink = CallerThread::sink();
+        pool.start([this, guard, sink, job = std::move(job), completion = std::move(completion)]() mutable {
+            auto result = job();
+            release();
+            CallerThread::complete(guard, sink, std::move(completion), std::move(result));
+        });
+        return true;
+    }
+
+    /// Удаляем копирование
+    AuthPool(const AuthPool &) = delete;
+    /// Удаляем присваивание
+    AuthPool &operator=(const AuthPool &) = delete;
+
+private:
+    AuthPool() = default;
+
+    /// Занимает место под задание; false если мест нет
+    bool reserve();
+    /// Освобождает место после выполнения задания
+    void release();
+
+    AuthPolicy authPolicy;
+    QThreadPool pool;
+    std::atomic<int> pending{0};    ///< Заданий в очереди и в работе
+    Gauge *pendingGauge = nullptr;  ///< timp_auth_pending
+    Counter *rejected = nullptr;    ///< timp_auth_rejected_total
+};
+
+#endif // AUTH_POOL_H
@@ -0,0 +1,58 @@
+#include "password_hasher.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QPasswordDigestor>
+#include <QRandomGenerator>
+
+namespace {
+    constexpr QLatin1StringView Scheme("pbkdf2-sha256");
+    constexpr qsizetype SaltBytes = 16;
+    constexpr qsizetype KeyBytes = 32;
+
+    QByteArray derive(const QString &password, const QByteArray &salt, const int iterations) {
+        return QPasswordDigestor::deriveKeyPbkdf2(QCryptographicHash::Sha256, password.toUtf8(), salt, iterations,
+                                                  KeyBytes);
+    }
+
+    /// Сравнение без раннего выхода: время не зависит от того, где ключи расходятся
+    bool constantTimeEquals(const QByteArray &a, const QByteArray &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        unsigned char difference = 0;
+        for (qsizetype i = 0; i < a.size(); ++i) {
+            difference |= static_cast<unsigned char>(a[i] ^ b[i]);
+        }
+        return difference == 0;
+    }
+}
+
+QString PasswordHasher::hash(const QString &password, const int iterations) {
+    QByteArray salt(SaltBytes, Qt::Uninitialized);
+    QRandomGenerator::system()->generate(salt.begin(), salt.end());
+
+    return QString("%1$%2$%3$%4").arg(Scheme).arg(iterations)
+            .arg(QString::fromLatin1(salt.toBase64()), QString::fromLatin1(derive(password, salt, iterations).toBase64()));
+}
+
+PasswordHasher::Verification PasswordHasher::verify(const QString &password, const QString &stored,
+                                                    const int iterations) {
+    const QStringList parts = stored.split('$');
+    if (parts.size() != 4 || parts[0] != Scheme) {
+        // stored before hashing existed: compare as is and rehash on success
+        const bool valid = constantTimeEquals(password.toUtf8(), stored.toUtf8());
+        return {valid, valid};
+    }
+
+    bool ok = false;
+    const int storedIterations = parts[1].toInt(&ok);
+    if (!ok || storedIterations <= 0) {
+        return {};
+    }
+
+    const QByteArray salt = QByteArray::fromBase64(parts[2].toLatin1());
+    const QByteArray key = QByteArray::fromBase64(parts[3].toLatin1());
+    const bool valid = constantTimeEquals(derive(password, salt, storedIterations), key);
+    return {valid, valid && storedIterations < iterations};
+}
@@ -0,0 +1,41 @@
+#ifndef PASSWORD_HASHER_H
+#define PASSWORD_HASHER_H
+
+#include <QString>
+
+/**
+ * @brief Класс PasswordHasher хэширует и проверяет пароли (PBKDF2-HMAC-SHA256).
+ *
+ * Хэш хранится строкой "pbkdf2-sha256$<итерации>$<соль base64>$<ключ base64>",
+ * поэтому число итераций можно увеличивать без миграции: старые хэши
+ * проверяются со своим числом итераций и помечаются для пересчёта.
+ * Строка без префикса — пароль, сохранённый до появления хэширования.
+ *
+ * Все методы медленные по замыслу и вызываются только из AuthPool.
+ */
+class PasswordHasher {
+public:
+    /// Результат проверки пароля
+    struct Verification {
+        bool valid = false;        ///< Пароль верный
+        bool needsUpgrade = false; ///< Хэш слабее текущих параметров (или пароль хранится открыто)
+    };
+
+    /**
+     * @brief Хэширует пароль со случайной солью.
+     * @param password Пароль.
+     * @param iterations Число итераций PBKDF2.
+     * @return Строка для хранения в БД.
+     */
+    static QString hash(const QString &password, int iterations);
+
+    /**
+     * @brief Проверяет пароль по сохранённой строке.
+     * @param password Введённый пароль.
+     * @param stored Строка из БД.
+     * @param iterations Текущее число итераций (для решения о пересчёте).
+     */
+    static Verification verify(const QString &password, const QString &stored, int iterations);
+};
+
+#endif // PASSWORD_HASHER_H
@@ -0,0 +1,190 @@
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include "database/database.h"
+#include "database/memory_store.h"
+
+/**
+ * @brief Микробенчмарки слоя БД (QBENCHMARK).
+ *
+ * Каждый запрос измеряется дважды: "prepare per call" повторяет прежний код
+ * (новый QSqlQuery, prepare() и чтение по имени столбца на каждый вызов),
+ * "cached statement" — вызов Database с подготовленным один раз запросом.
+ * Разница — цена разбора и планирования SQL на один вызов.
+ *
+ * Те же вставка и чтение истории на MemoryStore показывают, сколько из
+ * этого времени приходится на SQLite вообще.
+ */
+class DatabaseBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    // чтение хэша пароля при входе
+    void benchPasswordHash_data();
+    void benchPasswordHash();
+
+    // последняя страница истории комнаты
+    void benchHistoryPage_data();
+    void benchHistoryPage();
+
+    // вставка одного сообщения (пакет из одного, без группового сохранения)
+    void benchInsertMessage_data();
+    void benchInsertMessage();
+
+    // полнотекстовый поиск (FTS5) по комнате, первая страница
+    void benchSearch();
+
+    // хранилище в памяти: вставка пакета из одного сообщения и последняя страница истории
+    void benchMemoryInsert();
+    void benchMemoryHistoryPage();
+
+private:
+    QTemporaryDir directory;
+    MemoryStore memory;
+};
+
+namespace {
+    constexpr int HistoryRows = 10000;
+    constexpr int PageSize = 50;
+
+    void addModeRows() {
+        QTest::addColumn<bool>("cached");
+        QTest::newRow("prepare per call") << false;
+        QTest::newRow("cached statement") << true;
+    }
+}
+
+void DatabaseBench::initTestCase() {
+    QVERIFY(directory.isValid());
+    // relaxed: the insert benchmark measures statement overhead, not the disk's fsync
+    QVERIFY(Database::instance().init(directory.filePath("bench.sqlite"), Durability::Relaxed));
+    // the stored value is opaque to Database; hashing cost is not what is measured here
+    QVERIFY(Database::registerUser("bench", "secret"));
+
+    QList<Database::NewMessage> messages;
+    messages.reserve(HistoryRows);
+    for (int i = 0; i < HistoryRows; ++i) {
+        messages.append({"general", "bench", QString("message %1").arg(i)});
+    }
+    QVERIFY(Database::saveMessages(messages));
+}
+
+void DatabaseBench::benchPasswordHash_data() {
+    addModeRows();
+}
+
+void DatabaseBench::benchPasswordHash() {
+    QFETCH(bool, cached);
+
+    if (cached) {
+        QBENCHMARK {
+            QCOMPARE(Database::passwordHash("bench").value_or(QString()), QString("secret"));
+        }
+        return;
+    }
+
+    QBENCHMARK {
+        QSqlQuery query(Database::connection());
+        query.prepare("SELECT password FROM users WHERE username = ?");
+        query.addBindValue("bench");
+        QVERIFY(query.exec() && query.next());
+        QCOMPARE(query.value("password").toString(), QString("secret"));
+    }
+}
+
+void DatabaseBench::benchHistoryPage_data() {
+    addModeRows();
+}
+
+void DatabaseBench::benchHistoryPage() {
+    QFETCH(bool, cached);
+
+    if (cached) {
+        QBENCHMARK {
+            QCOMPARE(Database::getMessages("general", PageSize).messages.size(), PageSize);
+        }
+        return;
+    }
+
+    QBENCHMARK {
+        QSqlQuery query(Database::connection());
+        query.prepare("SELECT id, sender, content, timestamp FROM messages WHERE room = ? ORDER BY id DESC LIMIT ?");
+        query.addBindValue("general");
+        query.addBindValue(PageSize + 1);
+        QVERIFY(query.exec());
+
+        QList<Database::StoredMessage> messages;
+        while (query.next() && messages.size() < PageSize) {
+            messages.append({query.value("id").toLongLong(), query.value("sender").toString(),
+                             query.value("content").toString(),
+                             query.value("timestamp").toDateTime().toString(Qt::ISODate)});
+        }
+        QCOMPARE(messages.size(), PageSize);
+    }
+}
+
+void DatabaseBench::benchInsertMessage_data() {
+    addModeRows();
+}
+
+void DatabaseBench::benchInsertMessage() {
+    QFETCH(bool, cached);
+
+    if (cached) {
+        QBENCHMARK {
+            QList<Database::NewMessage> messages{{"bench", "bench", "cached insert"}};
+            QVERIFY(Database::saveMessages(messages));
+        }
+        return;
+    }
+
+    // far above the ids Database hands out, so the cached run that follows never collides with these rows
+    qint64 id = 1'000'000'000;
+    QBENCHMARK {
+        QSqlQuery query(Database::connection());
+        query.prepare("INSERT INTO messages (id, room, sender, content) VALUES (?, ?, ?, ?)");
+        query.addBindValue(++id);
+        query.addBindValue("bench");
+        query.addBindValue("bench");
+        query.addBindValue("prepared insert");
+        QVERIFY(query.exec());
+    }
+}
+
+void DatabaseBench::benchSearch() {
+    // one exact word and one prefix: every row matches "message", a handful start with "4242"
+    QBENCHMARK {
+        const std::optional<Database::SearchPage> page = Database::searchMessages("general", "message 4242*", 20);
+        QVERIFY(page.has_value());
+        QVERIFY(!page->hits.isEmpty());
+    }
+}
+
+void DatabaseBench::benchMemoryInsert() {
+    // ids normally come from Database; the store only needs them to grow
+    qint64 id = 0;
+    QBENCHMARK {
+        QList<Database::NewMessage> messages{{"bench", "bench", "memory insert", ++id}};
+        QVERIFY(memory.saveMessages(messages));
+    }
+}
+
+void DatabaseBench::benchMemoryHistoryPage() {
+    QList<Database::NewMessage> messages;
+    messages.reserve(HistoryRows);
+    for (int i = 0; i < HistoryRows; ++i) {
+        messages.append({"general", "bench", QString("message %1").arg(i), i + 1});
+    }
+    QVERIFY(memory.saveMessages(messages));
+
+    QBENCHMARK {
+        QCOMPARE(memory.messages("general", PageSize, {}).messages.size(), PageSize);
+    }
+}
+
+QTEST_GUILESS_MAIN(DatabaseBench)
+
+#include "database_bench.moc"
@@ -0,0 +1,83 @@
+#include "archive_segment.h"
+
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+    constexpr qsizetype MagicSize = sizeof(ArchiveSegment::Magic) - 1;
+
+    /// One column of the segment: a field of every message, in id order
+    template<typename Field>
+    QCborArray column(const QList<ArchivedMessage> &messages, Field field) {
+        QCborArray values;
+        for (const ArchivedMessage &message: messages) {
+            values.append(field(message));
+        }
+        return values;
+    }
+}
+
+QString ArchiveSegment::timestamp(const QDateTime &time) {
+    return time.toString("yyyy-MM-dd'T'HH:mm:ss");
+}
+
+QByteArray ArchiveSegment::encode(const QList<ArchivedMessage> &messages) {
+    QCborArray ids;
+    qint64 previous = 0;
+    for (const ArchivedMessage &message: messages) {
+        ids.append(message.id - previous);
+        previous = message.id;
+    }
+
+    QCborMap columns;
+    columns["id"_L1] = ids;
+    columns["room"_L1] = column(messages, [](const ArchivedMessage &m) { return QCborValue(m.room); });
+    columns["sender"_L1] = column(messages, [](const ArchivedMessage &m) { return QCborValue(m.sender); });
+    // null rather than "" keeps the room messages' column a run of one byte each
+    columns["recipient"_L1] = column(messages, [](const ArchivedMessage &m) {
+        return m.recipient.isEmpty() ? QCborValue(nullptr) : QCborValue(m.recipient);
+    });
+    columns["content"_L1] = column(messages, [](const ArchivedMessage &m) { return QCborValue(m.content); });
+    columns["timestamp"_L1] = column(messages, [](const ArchivedMessage &m) { return QCborValue(m.timestamp); });
+
+    return QByteArray(Magic, MagicSize) + qCompress(columns.toCborValue().toCbor(), 9);
+}
+
+std::optional<QList<ArchivedMessage>> ArchiveSegment::decode(const QByteArray &data) {
+    if (!data.startsWith(QByteArrayView(Magic, MagicSize))) {
+        return std::nullopt;
+    }
+
+    const QByteArray cbor = qUncompress(data.mid(MagicSize));
+    QCborParserError error;
+    const QCborValue value = QCborValue::fromCbor(cbor, &error);
+    if (cbor.isEmpty() || error.error != QCborError::NoError || !value.isMap()) {
+        return std::nullopt;
+    }
+
+    const QCborMap columns = value.toMap();
+    const QCborArray ids = columns["id"_L1].toArray();
+    const QCborArray rooms = columns["room"_L1].toArray();
+    const QCborArray senders = columns["sender"_L1].toArray();
+    const QCborArray recipients = columns["recipient"_L1].toArray();
+    const QCborArray contents = columns["content"_L1].toArray();
+    const QCborArray timestamps = columns["timestamp"_L1].toArray();
+    const qsizetype count = ids.size();
+    if (rooms.size() != count || senders.size() != count || recipients.size() != count
+        || contents.size() != count || timestamps.size() != count) {
+        return std::nullopt;
+    }
+
+    QList<ArchivedMessage> messages;
+    messages.reserve(count);
+    qint64 id = 0;
+    for (qsizetype i = 0; i < count; ++i) {
+        id += ids[i].toInteger();
+        messages.append({id, rooms[i].toString(), senders[i].toString(), recipients[i].toString(),
+                         contents[i].toString(), timestamps[i].toString()});
+    }
+    return messages;
+}
@@ -0,0 +1,51 @@
+#ifndef ARCHIVE_SEGMENT_H
+#define ARCHIVE_SEGMENT_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+#include <optional>
+
+/// Сообщение, перенесённое в архив
+struct ArchivedMessage {
+    qint64 id = 0;
+    QString room;
+    QString sender;
+    QString recipient; ///< Пусто у сообщений комнат
+    QString content;
+    QString timestamp; ///< ISO 8601
+};
+
+/**
+ * @brief Формат файла архивного сегмента.
+ *
+ * Сегмент — неизменяемый файл с сообщениями из непрерывного диапазона id:
+ * 8 байт сигнатуры и сжатый (qCompress) CBOR-словарь столбцов. Каждое поле
+ * хранится отдельным массивом, id — разностями с предыдущим: однотипные
+ * значения рядом сжимаются заметно лучше, чем построчная запись.
+ */
+namespace ArchiveSegment {
+    /// Сигнатура и версия формата
+    inline constexpr char Magic[] = "TIMPARC1";
+
+    /**
+     * @brief Текст времени сообщения для архива: "yyyy-MM-ddTHH:mm:ss", как его
+     * отдают страницы истории из таблицы, чтобы на одной странице не было двух форматов.
+     */
+    QString timestamp(const QDateTime &time);
+
+    /**
+     * @brief Кодирует сообщения (по возрастанию id) в содержимое файла сегмента.
+     */
+    QByteArray encode(const QList<ArchivedMessage> &messages);
+
+    /**
+     * @brief Разбирает содержимое файла сегмента.
+     * @return Сообщения по возрастанию id или std::nullopt, если файл повреждён.
+     */
+    std::optional<QList<ArchivedMessage>> decode(const QByteArray &data);
+}
+
+#endif // ARCHIVE_SEGMENT_H
@@ -0,0 +1,27 @@
+#ifndef COMMIT_POLICY_H
+#define COMMIT_POLICY_H
+
+#include <chrono>
+
+/**
+ * @brief Когда сообщение считается сохранённым.
+ */
+enum class Durability {
+    Strict,  ///< Рассылка после фиксации пакета; SQLite синхронизирует диск на каждой фиксации
+    Relaxed  ///< Рассылка сразу; запись в БД догоняет, а при сбое питания теряется последний пакет
+};
+
+/**
+ * @brief Параметры группового сохранения сообщений.
+ *
+ * Сообщения чата копятся в потоке хранилища не дольше window и не больше
+ * maxBatch штук, затем записываются одной транзакцией — одна синхронизация
+ * диска на весь пакет вместо одной на сообщение.
+ */
+struct GroupCommitPolicy {
+    std::chrono::microseconds window{2000};     ///< Сколько первое сообщение пакета может ждать фиксации
+    int maxBatch = 256;                         ///< Пакет фиксируется сразу по достижении этого размера
+    Durability durability = Durability::Strict; ///< Режим надёжности
+};
+
+#endif // COMMIT_POLICY_H
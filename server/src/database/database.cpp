@@ -1,129 +1,224 @@
 #include "database.h"
 
-#include <QDateTime>
-#include <QObject>
-#include <QSqlDatabase>
-#include <QSqlQuery>
-#include <QSqlError>
-#include <QDebug>
+#include "memory_store.h"
+#include "message_archive.h"
+#include "sqlite_store.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+namespace {
+    Histogram &queryLatency(const char *query) {
+        return Metrics::instance().histogram("timp_db_query_duration_us", "database query time, microseconds",
+                                             Metrics::label("query", query));
+    }
+}
 
 Database::Database(QObject *parent) : QObject(parent) {
-    db = QSqlDatabase::addDatabase("QSQLITE");
 }
 
-Database::~Database() {
-    if (db.isOpen()) {
-        db.close();
+Database::~Database() = default;
+
+bool Database::init(const QString &dbPath, const Durability durability, const StoragePolicy &storage) {
+    if (storage.backend == StorageBackend::Memory) {
+        primary = std::make_unique<MemoryStore>(storage.memoryRoomLimit);
+        qCInfo(lcDatabase) << "storage: memory only, nothing is written to disk";
+    } else {
+        auto store = std::make_unique<SqliteStore>();
+        if (!store->open(dbPath, durability)) {
+            return false;
+        }
+        sqlite = store.get();
+        primary = std::move(store);
     }
-}
 
-bool Database::init(const QString &dbPath) {
-    db.setDatabaseName(dbPath);
+    // a memory-only primary already keeps every room off the disk
+    if (storage.backend != StorageBackend::Memory && !storage.ephemeralRooms.isEmpty()) {
+        ephemeral = std::make_unique<MemoryStore>(storage.memoryRoomLimit);
+        ephemeralRooms = QSet<QString>(storage.ephemeralRooms.cbegin(), storage.ephemeralRooms.cend());
+        qCInfo(lcDatabase) << "ephemeral rooms:" << storage.ephemeralRooms;
+    }
 
-    if (!db.open()) {
-        qDebug() << "failed to open database" << db.lastError().text();
+    const std::optional<qint64> last = primary->lastMessageId();
+    if (!last) {
         return false;
     }
+    lastId = *last;
+    return true;
+}
 
-    return createTables();
+MessageStore &Database::storeFor(const QString &room) const {
+    return ephemeral && ephemeralRooms.contains(room) ? *ephemeral : *primary;
 }
 
-bool Database::createTables() {
-    QSqlQuery usersQuery;
-    if (!usersQuery.exec(
-        "CREATE TABLE IF NOT EXISTS users ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "username TEXT UNIQUE NOT NULL, "
-        "password TEXT NOT NULL, "
-        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP)")) {
-        qDebug() << "failed to create users table" << usersQuery.lastError().text();
-        return false;
-    }
+namespace {
+    thread_local int readLeases = 0;
+}
 
-    QSqlQuery messagesQuery;
-    if (!messagesQuery.exec(
-        "CREATE TABLE IF NOT EXISTS messages ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "sender TEXT NOT NULL, "
-        "content TEXT NOT NULL, "
-        "timestamp DATETIME DEFAULT CURRENT_TIMESTAMP, "
-        "FOREIGN KEY (sender) REFERENCES users(username))")) {
-        qDebug() << "failed to create messages table" << messagesQuery.lastError().text();
-        return false;
-    }
+Database::ReadLease::ReadLease() {
+    ++readLeases;
+}
 
-    return true;
+Database::ReadLease::~ReadLease() {
+    --readLeases;
 }
 
-bool Database::registerUser(const QString &username, const QString &password) {
-    if (username.isEmpty() || password.isEmpty()) {
-        qDebug() << "invalid username or password";
-        return false;
-    }
+bool Database::ReadLease::held() {
+    return readLeases > 0;
+}
+
+QSqlDatabase Database::connection() {
+    SqliteStore *store = instance().sqlite;
+    return store ? store->connection() : QSqlDatabase();
+}
 
-    QSqlQuery query;
-    query.prepare("INSERT INTO users (username, password) VALUES (?, ?)");
-    query.addBindValue(username);
-    query.addBindValue(password);
+bool Database::registerUser(const QString &username, const QString &passwordHash) {
+    static Histogram &latency = queryLatency("register_user");
+    ScopedTimer timer(latency);
 
-    if (!query.exec()) {
-        qDebug() << "failed to register users" << query.lastError().text();
+    if (username.isEmpty() || passwordHash.isEmpty()) {
+        qCDebug(lcDatabase) << "invalid username or password";
         return false;
     }
 
-    return true;
+    return instance().primary->registerUser(username, passwordHash);
 }
 
-bool Database::checkCredentials(const QString &username, const QString &password) {
-    QSqlQuery query;
-    query.prepare("SELECT password FROM users WHERE username = ?");
-    query.addBindValue(username);
+std::optional<QString> Database::passwordHash(const QString &username) {
+    static Histogram &latency = queryLatency("password_hash");
+    ScopedTimer timer(latency);
 
-    if (!query.exec() || !query.next()) {
-        qDebug() << "user not found";
-        return false;
+    return instance().primary->passwordHash(username);
+}
+
+void Database::updatePasswordHash(const QString &username, const QString &passwordHash) {
+    instance().primary->updatePasswordHash(username, passwordHash);
+}
+
+bool Database::saveMessages(QList<NewMessage> &messages) {
+    static Histogram &latency = queryLatency("save_messages");
+    ScopedTimer timer(latency);
+
+    if (messages.isEmpty()) {
+        return true;
     }
 
-    const QString correctPassword = query.value(0).toString();
+    // ids of a batch that fails are skipped, never reused
+    Database &self = instance();
+    for (NewMessage &message: messages) {
+        message.id = ++self.lastId;
+    }
 
-    return correctPassword == password;
-}
+    if (!self.ephemeral) {
+        return self.primary->saveMessages(messages);
+    }
 
-bool Database::saveMessage(const QString &sender, const QString &content) {
-    QSqlQuery query;
-    query.prepare("INSERT INTO messages (sender, content) VALUES (?, ?)");
-    query.addBindValue(sender);
-    query.addBindValue(content);
+    QList<NewMessage> durable;
+    QList<NewMessage> transient;
+    for (const NewMessage &message: messages) {
+        (self.ephemeralRooms.contains(message.room) ? transient : durable).append(message);
+    }
 
-    if (!query.exec()) {
-        qDebug() << "failed to save message" << query.lastError().text();
+    // only the disk can fail, so memory is written once the disk has committed and the batch stays all-or-nothing
+    if (!self.primary->saveMessages(durable)) {
         return false;
     }
+    self.ephemeral->saveMessages(transient);
 
+    auto saved = durable.cbegin();
+    auto kept = transient.cbegin();
+    for (NewMessage &message: messages) {
+        message.timestamp = (self.ephemeralRooms.contains(message.room) ? kept++ : saved++)->timestamp;
+    }
     return true;
 }
 
-QList<QVariantMap> Database::getRecentMessages(const int limit) {
-    QList<QVariantMap> messages;
+bool Database::userExists(const QString &username) {
+    static Histogram &latency = queryLatency("user_exists");
+    ScopedTimer timer(latency);
+
+    return instance().primary->userExists(username);
+}
+
+qint64 Database::saveDirectMessage(const QString &sender, const QString &recipient, const QString &content,
+                                   const bool delivered) {
+    static Histogram &latency = queryLatency("save_direct");
+    ScopedTimer timer(latency);
+
+    Database &self = instance();
+    const qint64 id = ++self.lastId;
+    return self.primary->saveDirectMessage(id, sender, recipient, content, delivered) ? id : -1;
+}
+
+void Database::markUndelivered(const qint64 messageId) {
+    instance().primary->markUndelivered(messageId);
+}
+
+QList<QVariantMap> Database::takeUndeliveredMessages(const QString &recipient) {
+    static Histogram &latency = queryLatency("take_undelivered");
+    ScopedTimer timer(latency);
+
+    return instance().primary->takeUndeliveredMessages(recipient);
+}
 
-    QSqlQuery query;
-    query.prepare("SELECT id, sender, content, timestamp FROM messages ORDER BY timestamp DESC LIMIT ?");
-    query.addBindValue(limit);
+Database::HistoryPage Database::getMessages(const QString &room, const int limit, const HistoryCursor cursor) {
+    static Histogram &latency = queryLatency("history_page");
+    ScopedTimer timer(latency);
+
+    MessageStore &store = instance().storeFor(room);
+
+    // archived messages are all older than the ones left in the table
+    if (cursor.afterId > 0) {
+        HistoryPage archived = MessageArchive::instance().page(room, limit, cursor);
+        if (archived.hasMore) {
+            return archived;
+        }
+        HistoryPage recent = store.messages(room, limit - static_cast<int>(archived.messages.size()), cursor);
+        archived.messages.append(recent.messages);
+        archived.hasMore = recent.hasMore;
+        return archived;
+    }
 
-    if (!query.exec()) {
-        qDebug() << "failed to get recent messages" << query.lastError().text();
-        return messages;
+    HistoryPage page = store.messages(room, limit, cursor);
+    if (page.hasMore) {
+        return page;
     }
 
-    while (query.next()) {
-        QVariantMap message;
-        message["id"] = query.value("id").toInt();
-        message["sender"] = query.value("sender").toString();
-        message["content"] = query.value("content").toString();
-        message["timestamp"] = query.value("timestamp").toDateTime().toString(Qt::ISODate);
+    // the table ran out going back: the rest of the page, or just "is there more", comes from the archive
+    const HistoryCursor older{page.messages.isEmpty() ? cursor.beforeId : page.messages.constFirst().id, 0};
+    HistoryPage archived = MessageArchive::instance().page(room, limit - static_cast<int>(page.messages.size()), older);
+    archived.messages.append(page.messages);
+    return archived;
+}
+
+std::optional<Database::SearchPage> Database::searchMessages(const QString &room, const QString &text,
+                                                             const int limit, const SearchCursor cursor) {
+    static Histogram &latency = queryLatency("search_messages");
+    ScopedTimer timer(latency);
 
-        messages.append(message);
+    // the snapshot: messages saved after the first page never shift the later ones
+    Database &self = instance();
+    SearchCursor snapshot = cursor;
+    if (snapshot.untilId <= 0) {
+        snapshot.untilId = self.lastId.load();
+    }
+    std::optional<SearchPage> page = self.storeFor(room).searchMessages(room, text, limit, snapshot);
+    if (page) {
+        page->untilId = snapshot.untilId;
     }
+    return page;
+}
 
-    return messages;
-}
\ No newline at end of file
+QStringList Database::rooms() {
+    Database &self = instance();
+    QStringList rooms = self.primary->rooms();
+    if (self.ephemeral) {
+        rooms.append(self.ephemeral->rooms());
+    }
+    // a room whose every message is archived still has history
+    for (const QString &room: MessageArchive::instance().rooms()) {
+        if (!rooms.contains(room)) {
+            rooms.append(room);
+        }
+    }
+    return rooms;
+}
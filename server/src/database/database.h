@@ -1,16 +1,33 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
-#include <QSqlQuery>
+#include <QObject>
+#include <QSet>
+#include <QSqlDatabase>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+#include "commit_policy.h"
+#include "message_store.h"
+#include "storage_policy.h"
+
+class SqliteStore;
 
 /**
  * @brief Класс Database управляет подключением к базе данных и выполняет основные запросы.
  *
  * Этот класс реализован в виде синглтона и обеспечивает:
- * - Инициализацию и подключение к базе данных SQLite
- * - Создание таблиц при первом запуске
+ * - Выбор хранилища (MessageStore): SQLite или только память
  * - Регистрацию пользователей и проверку их данных
  * - Сохранение и получение сообщений
+ * - Хранение личных сообщений до входа получателя
+ *
+ * Сообщения эфемерных комнат (StoragePolicy::ephemeralRooms) уходят в
+ * отдельное хранилище в памяти. Id всех сообщений выдаются из одной
+ * последовательности, поэтому id не повторяются между комнатами
+ * независимо от того, где они хранятся.
  */
 class Database final : public QObject {
     Q_OBJECT
@@ -33,50 +50,168 @@ public:
     /**
          * @brief Инициализация базы данных.
          *
-         * Открывает соединение с базой данных SQLite.
+         * Создаёт хранилища по storage. Для SQLite открывает соединение с базой
+         * данных, переводит её в режим WAL и создаёт таблицы.
          * @param dbPath Путь к файлу базы данных. По умолчанию "database.sqlite".
+         * @param durability Режим надёжности: определяет PRAGMA synchronous всех соединений.
+         * @param storage Бэкенд и эфемерные комнаты.
          * @return true если инициализация прошла успешно, иначе false.
          */
-    bool init(const QString &dbPath = "database.sqlite");
-    /**
-         * @brief Создаёт таблицы в базе данных (если они ещё не существуют).
-         * @return true если успешно, иначе false.
-         */
-    static bool createTables();
+    bool init(const QString &dbPath = "database.sqlite", Durability durability = Durability::Strict,
+              const StoragePolicy &storage = {});
     /**
          * @brief Регистрирует нового пользователя.
          *
-         * Хэширует пароль перед сохранением.
+         * Пароль хэшируется заранее (PasswordHasher) — в БД открытый пароль не попадает.
          * @param username Имя пользователя.
-         * @param password Пароль (в незашифрованном виде).
+         * @param passwordHash Хэш пароля.
          * @return true если регистрация успешна, иначе false.
          */
     // db queries
-    static bool registerUser(const QString &username, const QString &password);
+    static bool registerUser(const QString &username, const QString &passwordHash);
     /**
-        * @brief Проверяет логин и пароль пользователя.
+        * @brief Возвращает сохранённый хэш пароля пользователя.
         *
-        * Сравнивает имя и хэш пароля с данными в БД.
+        * Сама проверка пароля выполняется вне БД (PasswordHasher::verify).
         * @param username Имя пользователя.
-        * @param password Пароль (в незашифрованном виде).
-        * @return true если логин и пароль корректны, иначе false.
+        * @return Хэш или std::nullopt, если пользователя нет.
         */
-    static bool checkCredentials(const QString &username, const QString &password);
+    static std::optional<QString> passwordHash(const QString &username);
+    /**
+        * @brief Заменяет хэш пароля (пересчёт с новыми параметрами при входе).
+        * @param username Имя пользователя.
+        * @param passwordHash Новый хэш.
+        */
+    static void updatePasswordHash(const QString &username, const QString &passwordHash);
+
+    /// Типы сообщений и страниц — общие для всех хранилищ (MessageStore)
+    using NewMessage = MessageStore::NewMessage;
+    using StoredMessage = MessageStore::StoredMessage;
+    using HistoryCursor = MessageStore::HistoryCursor;
+    using HistoryPage = MessageStore::HistoryPage;
+    using SearchHit = MessageStore::SearchHit;
+    using SearchCursor = MessageStore::SearchCursor;
+    using SearchPage = MessageStore::SearchPage;
+    static constexpr QChar SnippetOpen = MessageStore::SnippetOpen;
+    static constexpr QChar SnippetClose = MessageStore::SnippetClose;
+
     /**
-         * @brief Сохраняет новое сообщение от пользователя.
-         * @param sender Имя отправителя.
-         * @param content Текст сообщения.
-         * @return true если успешно сохранено, иначе false.
+         * @brief Сохраняет пакет сообщений одной транзакцией.
+         *
+         * Либо сохраняются все сообщения пакета, либо ни одного. Сохранённым
+         * сообщениям проставляются id и timestamp. Сообщения эфемерных комнат
+         * записываются в память только после фиксации остальных.
+         * @param messages Сообщения в порядке поступления.
+         * @return true если пакет зафиксирован, иначе false.
          */
-    static bool saveMessage(const QString &sender, const QString &content);
+    static bool saveMessages(QList<NewMessage> &messages);
     /**
-        * @brief Получает список последних сообщений.
-        * @param limit Количество сообщений, по умолчанию 50.
-        * @return Список сообщений в виде QVariantMap (ключи: sender, content, timestamp).
+        * @brief Получает страницу истории комнаты.
+        *
+        * Страница читается по индексу (room, id) от границы курсора, поэтому
+        * стоимость запроса зависит от размера страницы, а не от размера таблицы.
+        * С after_id возвращаются ближайшие к нему более новые сообщения,
+        * иначе — самые новые сообщения до before_id (или последние вообще).
+        * Сообщения, перенесённые в архив (MessageArchive), дочитываются из
+        * него, когда в таблице в нужном направлении их не осталось.
+        * @param room Имя комнаты.
+        * @param limit Размер страницы.
+        * @param cursor Границы страницы.
+        * @return Страница сообщений.
         */
-    static QList<QVariantMap> getRecentMessages(int limit = 50);
+    static HistoryPage getMessages(const QString &room, int limit, HistoryCursor cursor = {});
+
+    /**
+     * @brief Ищет сообщения комнаты по словам (полнотекстовый индекс FTS5).
+     *
+     * Каждое слово запроса ищется как отдельная фраза, все слова обязательны;
+     * слово со звёздочкой на конце ищется как префикс. Синтаксис FTS5 в
+     * запросе не интерпретируется. Результаты упорядочены по (rank, id);
+     * первая страница фиксирует снимок (последний выданный id), следующие
+     * ищут только в нём и пропускают cursor.offset результатов. Порядок внутри
+     * снимка может немного сдвинуться, если меняется статистика индекса, так
+     * что страницы не гарантированно стабильны.
+     * @param room Имя комнаты.
+     * @param text Текст запроса.
+     * @param limit Размер страницы.
+     * @param cursor Снимок и смещение в нём (по умолчанию — первая страница).
+     * @return Страница (пустая, если в запросе нет слов) или std::nullopt, если индекс недоступен
+     *         (в том числе для комнат в памяти).
+     */
+    static std::optional<SearchPage> searchMessages(const QString &room, const QString &text, int limit,
+                                                    SearchCursor cursor = {});
+
+    /**
+     * @brief Возвращает имена всех комнат, в которых есть сообщения (включая архив).
+     */
+    static QStringList rooms();
+
+    /**
+     * @brief Проверяет, зарегистрирован ли пользователь.
+     */
+    static bool userExists(const QString &username);
+
+    /**
+     * @brief Сохраняет личное сообщение.
+     * @param sender Имя отправителя.
+     * @param recipient Имя получателя.
+     * @param content Текст сообщения.
+     * @param delivered false если получатель офлайн и сообщение ждёт его входа.
+     * @return Идентификатор сообщения или -1 при ошибке.
+     */
+    static qint64 saveDirectMessage(const QString &sender, const QString &recipient, const QString &content,
+                                    bool delivered);
+
+    /**
+     * @brief Возвращает личное сообщение в очередь недоставленных.
+     * @param messageId Идентификатор сообщения.
+     */
+    static void markUndelivered(qint64 messageId);
+
+    /**
+     * @brief Забирает недоставленные личные сообщения пользователя и помечает их доставленными.
+     * @param recipient Имя получателя.
+     * @return Сообщения от старых к новым (ключи: id, sender, content, timestamp).
+     */
+    static QList<QVariantMap> takeUndeliveredMessages(const QString &recipient);
+
+    /**
+     * @brief Возвращает соединение с БД для текущего потока.
+     *
+     * QSqlDatabase нельзя использовать из потока, который его не создавал,
+     * поэтому каждый рабочий поток получает собственный клон основного соединения.
+     * @return Открытое соединение текущего потока; невалидное, если бэкенд не SQLite.
+     */
+    static QSqlDatabase connection();
+
+    /**
+     * @brief RAII-аренда соединения только для чтения.
+     *
+     * Пока аренда жива, connection() в этом потоке возвращает отдельное
+     * соединение, открытое с QSQLITE_OPEN_READONLY (создаётся при первой
+     * аренде и дальше принадлежит потоку). Запись через него завершится
+     * ошибкой SQLite. Поток должен либо всегда читать под арендой, либо
+     * никогда: подготовленные запросы SqliteStore привязаны к первому
+     * соединению потока.
+     */
+    class ReadLease {
+    public:
+        ReadLease();
+        ~ReadLease();
+
+        ReadLease(const ReadLease &) = delete;
+        ReadLease &operator=(const ReadLease &) = delete;
+
+        /**
+         * @brief Держит ли текущий поток аренду.
+         */
+        [[nodiscard]] static bool held();
+    };
 
 private:
+    /// Хранилище, в котором живут сообщения комнаты
+    [[nodiscard]] MessageStore &storeFor(const QString &room) const;
+
     /**
      * @brief Приватный конструктор (Singleton).
      * @param parent Родительский QObject.
@@ -84,8 +219,16 @@ private:
     explicit Database(QObject *parent = nullptr);
     /// Деструктор
     ~Database() override;
-    /// Объект базы данных SQLite
-    QSqlDatabase db;
+    /// Основное хранилище: пользователи, личные сообщения, обычные комнаты
+    std::unique_ptr<MessageStore> primary;
+    /// primary, если это SQLite (для connection())
+    SqliteStore *sqlite = nullptr;
+    /// Хранилище в памяти для эфемерных комнат (nullptr — их нет)
+    std::unique_ptr<MessageStore> ephemeral;
+    /// Имена эфемерных комнат
+    QSet<QString> ephemeralRooms;
+    /// Последний выданный id сообщения; новые id выдаёт только поток хранилища
+    std::atomic<qint64> lastId{0};
 };
 
 
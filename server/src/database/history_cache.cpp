@@ -0,0 +1,174 @@
+#include "history_cache.h"
+
+#include <algorithm>
+
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+HistoryCache &HistoryCache::instance() {
+    static HistoryCache cache;
+    return cache;
+}
+
+void HistoryCache::warm(const qsizetype size, const qsizetype roomLimit) {
+    QWriteLocker locker(&lock);
+    capacity = std::max<qsizetype>(size, 0);
+    maxRooms = std::max<qsizetype>(roomLimit, 0);
+    rooms.clear();
+    partial = false;
+    if (capacity == 0) return;
+
+    qsizetype total = 0;
+    for (const QString &room: Database::rooms()) {
+        // the rest start out as misses, just like rooms evicted later
+        if (maxRooms > 0 && rooms.size() == maxRooms) {
+            partial = true;
+            break;
+        }
+        Database::HistoryPage page = Database::getMessages(room, static_cast<int>(capacity));
+        Ring &ring = rooms[room];
+        ring.slots = std::move(page.messages);
+        ring.slots.reserve(capacity);
+        ring.complete = !page.hasMore;
+        // never 0: that is what a room without a ring reports
+        ring.generation = ++appends;
+        total += ring.size();
+    }
+    qCInfo(lcDatabase) << "history cache warmed:" << total << "messages in" << rooms.size() << "rooms";
+}
+
+void HistoryCache::append(const QString &room, const Database::StoredMessage &message) {
+    QWriteLocker locker(&lock);
+    if (capacity == 0) return;
+
+    QString evicted;
+    auto it = rooms.find(room);
+    if (it == rooms.end()) {
+        // before the insert: erasing moves other entries of the hash
+        evicted = evict();
+        it = rooms.insert(room, Ring());
+        // older messages of a room that lost its ring are somewhere in the database
+        it->complete = !partial;
+    }
+    Ring &ring = *it;
+    // global, so a ring created again after an eviction never repeats an old generation
+    ring.generation = ++appends;
+    if (ring.size() < capacity) {
+        ring.slots.append(message);
+    } else {
+        // full: the newest message takes the slot of the oldest
+        ring.slots[ring.first] = message;
+        ring.first = (ring.first + 1) % capacity;
+        ring.complete = false;
+    }
+
+    if (evicted.isEmpty() || !evictionListener) return;
+    // outside the lock: the listener may take locks of its own
+    const auto listener = evictionListener;
+    locker.unlock();
+    listener(evicted);
+}
+
+void HistoryCache::setEvictionListener(std::function<void(const QString &room)> listener) {
+    QWriteLocker locker(&lock);
+    evictionListener = std::move(listener);
+}
+
+QString HistoryCache::evict() {
+    static Counter &evictions = Metrics::instance().counter("timp_history_cache_evictions_total",
+                                                            "room buffers dropped to keep the cache bounded");
+    if (maxRooms == 0 || rooms.size() < maxRooms) return {};
+
+    // a scan, but only when a new room finds the cache full
+    const auto oldest = std::ranges::min_element(rooms.begin(), rooms.end(), {},
+                                                 [](const Ring &ring) { return ring.generation; });
+    QString room = oldest.key();
+    rooms.erase(oldest);
+    partial = true;
+    evictions.add();
+    return room;
+}
+
+qsizetype HistoryCache::Ring::lowerBound(const qint64 id) const {
+    qsizetype low = 0;
+    qsizetype high = size();
+    while (low < high) {
+        const qsizetype middle = low + (high - low) / 2;
+        if (at(middle).id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+quint64 HistoryCache::generation(const QString &room) const {
+    QReadLocker locker(&lock);
+    const auto it = rooms.constFind(room);
+    return it == rooms.cend() ? 0 : it->generation;
+}
+
+std::optional<Database::HistoryPage> HistoryCache::page(const QString &room, const int limit,
+                                                        const Database::HistoryCursor cursor,
+                                                        quint64 *generation) const {
+    static Counter &hits = Metrics::instance().counter("timp_history_cache_hits_total",
+                                                       "history requests served from memory");
+    static Counter &misses = Metrics::instance().counter("timp_history_cache_misses_total",
+                                                         "history requests that had to read the database");
+
+    QReadLocker locker(&lock);
+    if (capacity == 0) {
+        return std::nullopt;
+    }
+
+    Database::HistoryPage page;
+    const auto it = rooms.constFind(room);
+    if (it == rooms.cend()) {
+        // until the first eviction every room with messages was loaded by warm() or got a ring on its first append
+        if (partial) {
+            misses.add();
+            return std::nullopt;
+        }
+        hits.add();
+        return page;
+    }
+
+    const Ring &ring = *it;
+    if (generation) {
+        *generation = ring.generation;
+    }
+    // [low, high) — the cached messages inside the cursor bounds
+    const qsizetype low = cursor.afterId > 0 ? ring.lowerBound(cursor.afterId + 1) : 0;
+    const qsizetype high = cursor.beforeId > 0 ? ring.lowerBound(cursor.beforeId) : ring.size();
+
+    if (cursor.afterId > 0) {
+        // paging forward needs every message after after_id, i.e. none of them evicted
+        if (!ring.complete && (ring.size() == 0 || cursor.afterId + 1 < ring.at(0).id)) {
+            misses.add();
+            return std::nullopt;
+        }
+
+        const qsizetype end = std::min(high, low + limit);
+        for (qsizetype i = low; i < end; ++i) {
+            page.messages.append(ring.at(i));
+        }
+        page.hasMore = end < high;
+        hits.add();
+        return page;
+    }
+
+    // paging back needs a full page in memory unless the ring holds the whole room
+    if (high - low < limit && !ring.complete) {
+        misses.add();
+        return std::nullopt;
+    }
+
+    const qsizetype begin = std::max(low, high - limit);
+    for (qsizetype i = begin; i < high; ++i) {
+        page.messages.append(ring.at(i));
+    }
+    page.hasMore = begin > low || !ring.complete;
+    hits.add();
+    return page;
+}
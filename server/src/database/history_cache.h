@@ -0,0 +1,121 @@
+#ifndef HISTORY_CACHE_H
+#define HISTORY_CACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QString>
+
+#include <functional>
+#include <optional>
+
+#include "database.h"
+
+/**
+ * @brief Класс HistoryCache хранит последние сообщения каждой комнаты в памяти.
+ *
+ * Для каждой комнаты держится кольцевой буфер из последних capacity сообщений.
+ * Буферы заполняются из БД при запуске (warm()) и дополняются потоком хранилища
+ * сразу после фиксации каждого пакета, поэтому идут строго по возрастанию id.
+ *
+ * Запрос истории, целиком попадающий в окно буфера, отдаётся без обращения
+ * к SQLite; остальные (например, листание глубоко назад) — промах, их
+ * обслуживает Database::getMessages().
+ *
+ * Буферов не больше maxRooms: при переполнении вытесняется комната, в которую
+ * дольше всех не писали. После первого вытеснения комната без буфера — промах,
+ * а не пустая история.
+ *
+ * Методы потокобезопасны: читают воркеры, пишет поток хранилища.
+ */
+class HistoryCache {
+public:
+    /**
+     * @brief Возвращает единственный экземпляр.
+     */
+    static HistoryCache &instance();
+
+    /**
+     * @brief Заполняет буферы последними сообщениями всех комнат.
+     *
+     * Вызывается после Database::init() и до запуска StorageExecutor.
+     * @param capacity Сообщений на комнату; 0 — кэш выключен.
+     * @param maxRooms Сколько комнат держать в памяти (0 — без ограничения).
+     */
+    void warm(qsizetype capacity, qsizetype maxRooms = 0);
+
+    /**
+     * @brief Добавляет только что сохранённое сообщение в буфер его комнаты.
+     */
+    void append(const QString &room, const Database::StoredMessage &message);
+
+    /**
+     * @brief Отвечает на запрос истории из памяти.
+     * @param room Имя комнаты.
+     * @param limit Размер страницы.
+     * @param cursor Границы страницы (как у Database::getMessages()).
+     * @param generation Если задан, сюда записывается поколение комнаты, которому соответствует страница.
+     * @return Страница или std::nullopt, если её нельзя собрать без БД.
+     */
+    [[nodiscard]] std::optional<Database::HistoryPage> page(const QString &room, int limit,
+                                                            Database::HistoryCursor cursor,
+                                                            quint64 *generation = nullptr) const;
+
+    /**
+     * @brief Поколение комнаты: растёт с каждым добавленным сообщением и не
+     * повторяется, даже если буфер комнаты был вытеснен и создан заново.
+     * 0 — у комнаты нет буфера.
+     *
+     * Позволяет хранить производные от истории данные (например, готовые кадры)
+     * и проверять их актуальность без сравнения содержимого.
+     */
+    [[nodiscard]] quint64 generation(const QString &room) const;
+
+    /**
+     * @brief Задаёт, кого известить о вытеснении комнаты из кэша.
+     *
+     * Вызывается в потоке хранилища после снятия блокировки кэша; пустая
+     * функция отключает извещения.
+     */
+    void setEvictionListener(std::function<void(const QString &room)> listener);
+
+    /// Удаляем копирование
+    HistoryCache(const HistoryCache &) = delete;
+    /// Удаляем присваивание
+    HistoryCache &operator=(const HistoryCache &) = delete;
+
+private:
+    HistoryCache() = default;
+
+    /// Последние сообщения одной комнаты
+    struct Ring {
+        QList<Database::StoredMessage> slots; ///< Растёт до capacity, дальше перезаписывается по кругу
+        qsizetype first = 0;                  ///< Индекс самого старого сообщения в slots
+        bool complete = true;                 ///< Более старых сообщений, чем в буфере, в комнате нет
+        quint64 generation = 0;               ///< Номер последнего добавления (общий счёт по всем комнатам)
+
+        [[nodiscard]] qsizetype size() const { return slots.size(); }
+
+        /// i-е сообщение от самого старого
+        [[nodiscard]] const Database::StoredMessage &at(const qsizetype i) const {
+            return slots[(first + i) % slots.size()];
+        }
+
+        /// Первая позиция с id не меньше заданного (бинарный поиск)
+        [[nodiscard]] qsizetype lowerBound(qint64 id) const;
+    };
+
+    /// Освобождает место под новую комнату: вытесняет ту, в которую дольше всех не писали
+    /// @return Имя вытесненной комнаты или пустая строка
+    QString evict();
+
+    mutable QReadWriteLock lock;
+    QHash<QString, Ring> rooms;
+    qsizetype capacity = 0;
+    qsizetype maxRooms = 0;
+    quint64 appends = 0;  ///< Источник поколений
+    bool partial = false; ///< Не у каждой комнаты с сообщениями есть буфер
+    std::function<void(const QString &)> evictionListener;
+};
+
+#endif // HISTORY_CACHE_H
@@ -0,0 +1,221 @@
+#include "memory_store.h"
+
+#include <QDateTime>
+#include <QReadLocker>
+#include <QTimeZone>
+#include <QWriteLocker>
+
+#include <algorithm>
+#include <limits>
+#include <ranges>
+
+namespace {
+    /// Messages per arena block: a room gives memory back a block at a time
+    constexpr qsizetype BlockMessages = 1024;
+    /// Delivered direct messages remembered so a failed delivery can still be put back
+    constexpr qsizetype DeliveredKept = 1024;
+
+    QStringView copyText(std::pmr::memory_resource &arena, const QString &text) {
+        auto *data = static_cast<QChar *>(arena.allocate(text.size() * sizeof(QChar), alignof(QChar)));
+        std::ranges::copy(text, data);
+        return {data, text.size()};
+    }
+
+    /// The same text SqliteStore returns for its "yyyy-MM-dd HH:mm:ss" column
+    QString isoTimestamp(const qint64 seconds) {
+        return QDateTime::fromSecsSinceEpoch(seconds, QTimeZone::UTC).toString("yyyy-MM-dd'T'HH:mm:ss");
+    }
+}
+
+MemoryStore::Block::Block() {
+    // reserved up front: the entries never reallocate, which a monotonic arena could not reclaim
+    entries.reserve(BlockMessages);
+}
+
+MemoryStore::MemoryStore(const qsizetype roomLimit) : roomLimit(roomLimit) {
+}
+
+MemoryStore::~MemoryStore() = default;
+
+bool MemoryStore::registerUser(const QString &username, const QString &passwordHash) {
+    QWriteLocker locker(&lock);
+    if (users.contains(username)) {
+        return false;
+    }
+    users.insert(username, passwordHash);
+    return true;
+}
+
+std::optional<QString> MemoryStore::passwordHash(const QString &username) {
+    QReadLocker locker(&lock);
+    const auto it = users.constFind(username);
+    if (it == users.cend()) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+void MemoryStore::updatePasswordHash(const QString &username, const QString &passwordHash) {
+    QWriteLocker locker(&lock);
+    if (const auto it = users.find(username); it != users.end()) {
+        *it = passwordHash;
+    }
+}
+
+bool MemoryStore::userExists(const QString &username) {
+    QReadLocker locker(&lock);
+    return users.contains(username);
+}
+
+std::optional<qint64> MemoryStore::lastMessageId() {
+    QReadLocker locker(&lock);
+    return lastId;
+}
+
+bool MemoryStore::saveMessages(QList<NewMessage> &messages) {
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const QString timestamp = isoTimestamp(now);
+
+    QWriteLocker locker(&lock);
+    for (NewMessage &message: messages) {
+        append(roomMessages[message.room], message, now);
+        message.timestamp = timestamp;
+        lastId = std::max(lastId, message.id);
+    }
+    return true;
+}
+
+void MemoryStore::append(Room &room, const NewMessage &message, const qint64 timestamp) {
+    if (room.blocks.empty() || static_cast<qsizetype>(room.blocks.back()->entries.size()) == BlockMessages) {
+        room.blocks.push_back(std::make_unique<Block>());
+    }
+
+    Block &block = *room.blocks.back();
+    block.entries.push_back({message.id, timestamp, copyText(block.arena, message.sender),
+                             copyText(block.arena, message.content)});
+    ++room.size;
+
+    // whole blocks only, so at least roomLimit messages are always kept
+    while (roomLimit > 0 && room.blocks.size() > 1
+           && room.size - static_cast<qsizetype>(room.blocks.front()->entries.size()) >= roomLimit) {
+        room.size -= static_cast<qsizetype>(room.blocks.front()->entries.size());
+        room.blocks.pop_front();
+    }
+}
+
+MessageStore::HistoryPage MemoryStore::messages(const QString &room, const int limit, const HistoryCursor cursor) {
+    HistoryPage page;
+
+    QReadLocker locker(&lock);
+    const auto it = roomMessages.find(room);
+    if (it == roomMessages.end()) {
+        return page;
+    }
+
+    // same bounds as the table query: (after_id, before_id), an unset bound is open
+    const bool forward = cursor.afterId > 0;
+    const qint64 above = cursor.afterId;
+    const qint64 below = cursor.beforeId > 0 ? cursor.beforeId : std::numeric_limits<qint64>::max();
+    const qsizetype wanted = static_cast<qsizetype>(std::max(limit, 0)) + 1;
+
+    auto take = [&page](const Entry &entry) {
+        page.messages.append({entry.id, entry.sender.toString(), entry.content.toString(),
+                              isoTimestamp(entry.timestamp)});
+    };
+    auto byId = [](const Entry &entry) { return entry.id; };
+
+    // ids grow across the blocks as well as within one, so each bound is a binary search
+    if (forward) {
+        for (const std::unique_ptr<Block> &block: it->second.blocks) {
+            if (block->entries.back().id <= above) continue;
+            for (auto entry = std::ranges::upper_bound(block->entries, above, {}, byId);
+                 entry != block->entries.end() && entry->id < below && page.messages.size() < wanted; ++entry) {
+                take(*entry);
+            }
+            if (page.messages.size() == wanted) break;
+        }
+    } else {
+        for (const std::unique_ptr<Block> &block: it->second.blocks | std::views::reverse) {
+            if (block->entries.front().id >= below) continue;
+            const auto end = std::ranges::lower_bound(block->entries, below, {}, byId);
+            for (auto entry = std::make_reverse_iterator(end);
+                 entry != block->entries.rend() && entry->id > above && page.messages.size() < wanted; ++entry) {
+                take(*entry);
+            }
+            if (page.messages.size() == wanted) break;
+        }
+    }
+
+    // the extra message only says there is more in this direction
+    if (page.messages.size() == wanted) {
+        page.hasMore = true;
+        page.messages.removeLast();
+    }
+    if (!forward) {
+        std::ranges::reverse(page.messages);
+    }
+    return page;
+}
+
+std::optional<MessageStore::SearchPage> MemoryStore::searchMessages(const QString &, const QString &, int,
+                                                                    SearchCursor) {
+    return std::nullopt;
+}
+
+QStringList MemoryStore::rooms() {
+    QReadLocker locker(&lock);
+    QStringList result;
+    for (const auto &[name, room]: roomMessages) {
+        if (room.size > 0) {
+            result.append(name);
+        }
+    }
+    return result;
+}
+
+bool MemoryStore::saveDirectMessage(const qint64 id, const QString &sender, const QString &recipient,
+                                    const QString &content, const bool delivered) {
+    const QString timestamp = isoTimestamp(QDateTime::currentSecsSinceEpoch());
+
+    QWriteLocker locker(&lock);
+    direct.insert_or_assign(id, DirectMessage{sender, recipient, content, timestamp, delivered});
+    lastId = std::max(lastId, id);
+    if (delivered) {
+        deliveredIds.enqueue(id);
+        trimDelivered();
+    }
+    return true;
+}
+
+void MemoryStore::markUndelivered(const qint64 messageId) {
+    QWriteLocker locker(&lock);
+    if (const auto it = direct.find(messageId); it != direct.end()) {
+        it->second.delivered = false;
+    }
+}
+
+QList<QVariantMap> MemoryStore::takeUndeliveredMessages(const QString &recipient) {
+    QList<QVariantMap> messages;
+
+    QWriteLocker locker(&lock);
+    for (auto &[id, message]: direct) {
+        if (message.delivered || message.recipient != recipient) continue;
+
+        messages.append(QVariantMap{{"id", id}, {"sender", message.sender}, {"content", message.content},
+                                    {"timestamp", message.timestamp}});
+        message.delivered = true;
+        deliveredIds.enqueue(id);
+    }
+    trimDelivered();
+    return messages;
+}
+
+void MemoryStore::trimDelivered() {
+    while (deliveredIds.size() > DeliveredKept) {
+        const auto it = direct.find(deliveredIds.dequeue());
+        // put back by markUndelivered meanwhile: it waits for its recipient again
+        if (it != direct.end() && it->second.delivered) {
+            direct.erase(it);
+        }
+    }
+}
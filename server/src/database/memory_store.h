@@ -0,0 +1,105 @@
+#ifndef MEMORY_STORE_H
+#define MEMORY_STORE_H
+
+#include <QHash>
+#include <QQueue>
+#include <QReadWriteLock>
+#include <QStringView>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "message_store.h"
+
+/**
+ * @brief Класс MemoryStore — хранилище только в памяти процесса.
+ *
+ * Сообщения комнаты лежат блоками: у каждого блока своя арена
+ * (std::pmr::monotonic_buffer_resource), в которую копируются записи и
+ * текст, так что сохранение сообщения — это запись в заранее выделенный
+ * буфер, а не отдельные выделения памяти под каждую строку. Когда у
+ * комнаты больше roomLimit сообщений, самый старый блок освобождается
+ * целиком. Пользователи хранятся в хэш-таблице по имени.
+ *
+ * Полнотекстового поиска нет. Всё хранимое теряется при остановке сервера.
+ */
+class MemoryStore final : public MessageStore {
+public:
+    /**
+     * @brief Конструктор.
+     * @param roomLimit Сколько последних сообщений каждой комнаты хранить не меньше (0 — без ограничения).
+     */
+    explicit MemoryStore(qsizetype roomLimit = 0);
+    ~MemoryStore() override;
+
+    MemoryStore(const MemoryStore &) = delete;
+    MemoryStore &operator=(const MemoryStore &) = delete;
+
+    bool registerUser(const QString &username, const QString &passwordHash) override;
+    std::optional<QString> passwordHash(const QString &username) override;
+    void updatePasswordHash(const QString &username, const QString &passwordHash) override;
+    bool userExists(const QString &username) override;
+    std::optional<qint64> lastMessageId() override;
+    bool saveMessages(QList<NewMessage> &messages) override;
+    HistoryPage messages(const QString &room, int limit, HistoryCursor cursor) override;
+    std::optional<SearchPage> searchMessages(const QString &room, const QString &text, int limit,
+                                             SearchCursor cursor) override;
+    QStringList rooms() override;
+    bool saveDirectMessage(qint64 id, const QString &sender, const QString &recipient, const QString &content,
+                           bool delivered) override;
+    void markUndelivered(qint64 messageId) override;
+    QList<QVariantMap> takeUndeliveredMessages(const QString &recipient) override;
+
+private:
+    /// Сообщение в арене блока; строки указывают в ту же арену
+    struct Entry {
+        qint64 id = 0;
+        qint64 timestamp = 0; ///< Секунды с начала эпохи (UTC)
+        QStringView sender;
+        QStringView content;
+    };
+
+    /// Блок сообщений комнаты с собственной ареной; освобождается целиком
+    struct Block {
+        Block();
+
+        std::pmr::monotonic_buffer_resource arena;
+        std::pmr::vector<Entry> entries{&arena}; ///< По возрастанию id, ёмкость выделена заранее
+    };
+
+    /// Сообщения комнаты: блоки от старых к новым
+    struct Room {
+        std::deque<std::unique_ptr<Block>> blocks;
+        qsizetype size = 0;
+    };
+
+    /// Личное сообщение
+    struct DirectMessage {
+        QString sender;
+        QString recipient;
+        QString content;
+        QString timestamp; ///< ISO 8601
+        bool delivered = false;
+    };
+
+    /// Добавляет сообщение в последний блок комнаты, при необходимости открывая новый
+    void append(Room &room, const NewMessage &message, qint64 timestamp);
+
+    /// Забывает доставленные личные сообщения сверх DeliveredKept
+    void trimDelivered();
+
+    mutable QReadWriteLock lock;
+    const qsizetype roomLimit;
+    qint64 lastId = 0;
+
+    QHash<QString, QString> users;                   ///< Имя -> хэш пароля
+    std::unordered_map<QString, Room> roomMessages;  ///< Комната -> сообщения
+    std::map<qint64, DirectMessage> direct;          ///< Личные сообщения по id
+    QQueue<qint64> deliveredIds;                     ///< Доставленные личные сообщения, от старых к новым
+};
+
+#endif // MEMORY_STORE_H
@@ -0,0 +1,287 @@
+#include "message_archive.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QMap>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <algorithm>
+#include <limits>
+#include <ranges>
+
+#include "storage_executor.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+MessageArchive &MessageArchive::instance() {
+    static MessageArchive archive;
+    return archive;
+}
+
+bool MessageArchive::open(const QString &path) {
+    QMutexLocker locker(&lock);
+    if (!QDir().mkpath(path)) {
+        qCCritical(lcDatabase) << "failed to create archive directory" << path;
+        return false;
+    }
+    directory = QDir(path);
+    files.clear();
+    ranges.clear();
+    decoded.clear();
+
+    QSqlQuery segments(Database::connection());
+    segments.setForwardOnly(true);
+    if (!segments.exec("SELECT id, file FROM archive_segments")) {
+        qCCritical(lcDatabase) << "failed to read archive directory" << segments.lastError().text();
+        return false;
+    }
+    while (segments.next()) {
+        files.insert(segments.value(0).toLongLong(), segments.value(1).toString());
+    }
+
+    QSqlQuery rooms(Database::connection());
+    rooms.setForwardOnly(true);
+    if (!rooms.exec("SELECT segment, room, first_id, last_id FROM archive_rooms ORDER BY first_id")) {
+        qCCritical(lcDatabase) << "failed to read archive directory" << rooms.lastError().text();
+        return false;
+    }
+    while (rooms.next()) {
+        ranges[rooms.value(1).toString()].append({rooms.value(0).toLongLong(), rooms.value(2).toLongLong(),
+                                                 rooms.value(3).toLongLong()});
+    }
+
+    qCInfo(lcDatabase) << "archive opened:" << files.size() << "segments in" << directory.absolutePath();
+    return true;
+}
+
+void MessageArchive::archiveExpired(const RetentionPolicy &policy) {
+    static Counter &archived = Metrics::instance().counter("timp_archived_messages_total",
+                                                           "messages moved from the messages table to the archive");
+    if (policy.maxAge.count() <= 0) return;
+
+    // the same text format the timestamp column stores, so the comparison is a plain string one
+    const qint64 age = std::chrono::duration_cast<std::chrono::seconds>(policy.maxAge).count();
+    const QString cutoff = QDateTime::currentDateTimeUtc().addSecs(-age).toString("yyyy-MM-dd HH:mm:ss");
+    const int segmentSize = std::max(policy.segmentSize, 1);
+
+    // undelivered direct messages wait in the table for their recipient whatever their age
+    QSqlQuery query(Database::connection());
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, room, sender, recipient, content, timestamp FROM messages "
+                  "WHERE timestamp < ? AND (recipient IS NULL OR delivered = 1) ORDER BY id LIMIT ?");
+    query.addBindValue(cutoff);
+    query.addBindValue(segmentSize);
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to select messages to archive" << query.lastError().text();
+        return;
+    }
+
+    QList<ArchivedMessage> messages;
+    while (query.next()) {
+        messages.append({query.value(0).toLongLong(), query.value(1).toString(), query.value(2).toString(),
+                         query.value(3).toString(), query.value(4).toString(),
+                         ArchiveSegment::timestamp(query.value(5).toDateTime())});
+    }
+    query.finish();
+
+    if (messages.isEmpty() || !writeSegment(messages, cutoff)) {
+        return;
+    }
+    archived.add(messages.size());
+    qCInfo(lcDatabase) << "archived" << messages.size() << "messages up to id" << messages.constLast().id;
+
+    if (messages.size() == segmentSize) {
+        StorageExecutor::instance().post([this, policy] { archiveExpired(policy); });
+    }
+}
+
+bool MessageArchive::writeSegment(const QList<ArchivedMessage> &messages, const QString &cutoff) {
+    const qint64 firstId = messages.constFirst().id;
+    const qint64 lastId = messages.constLast().id;
+    const QString fileName = QString("segment-%1-%2.tarc").arg(firstId).arg(lastId);
+    const QString filePath = directory.filePath(fileName);
+
+    // the file is complete on disk before any row leaves the table
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(ArchiveSegment::encode(messages)) < 0 || !file.commit()) {
+        qCWarning(lcDatabase) << "failed to write archive segment" << fileName << file.errorString();
+        return false;
+    }
+
+    struct RoomSummary {
+        qint64 firstId = 0;
+        qint64 lastId = 0;
+        int count = 0;
+    };
+    QMap<QString, RoomSummary> rooms;
+    for (const ArchivedMessage &message: messages) {
+        RoomSummary &summary = rooms[message.room];
+        if (summary.count++ == 0) {
+            summary.firstId = message.id;
+        }
+        summary.lastId = message.id;
+    }
+
+    QSqlDatabase db = Database::connection();
+    auto fail = [&db, &filePath](const QSqlQuery &query) {
+        qCWarning(lcDatabase) << "failed to register archive segment" << query.lastError().text();
+        db.rollback();
+        QFile::remove(filePath);
+        return false;
+    };
+    if (!db.transaction()) {
+        qCWarning(lcDatabase) << "failed to begin transaction" << db.lastError().text();
+        QFile::remove(filePath);
+        return false;
+    }
+
+    QSqlQuery segmentQuery(db);
+    segmentQuery.prepare("INSERT INTO archive_segments (file, first_id, last_id, first_timestamp, last_timestamp, "
+                         "message_count) VALUES (?, ?, ?, ?, ?, ?)");
+    segmentQuery.addBindValue(fileName);
+    segmentQuery.addBindValue(firstId);
+    segmentQuery.addBindValue(lastId);
+    segmentQuery.addBindValue(messages.constFirst().timestamp);
+    segmentQuery.addBindValue(messages.constLast().timestamp);
+    segmentQuery.addBindValue(messages.size());
+    if (!segmentQuery.exec()) {
+        return fail(segmentQuery);
+    }
+    const qint64 segment = segmentQuery.lastInsertId().toLongLong();
+
+    QSqlQuery roomQuery(db);
+    roomQuery.prepare("INSERT INTO archive_rooms (segment, room, first_id, last_id, message_count) "
+                      "VALUES (?, ?, ?, ?, ?)");
+    for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
+        roomQuery.bindValue(0, segment);
+        roomQuery.bindValue(1, it.key());
+        roomQuery.bindValue(2, it->firstId);
+        roomQuery.bindValue(3, it->lastId);
+        roomQuery.bindValue(4, it->count);
+        if (!roomQuery.exec()) {
+            return fail(roomQuery);
+        }
+    }
+
+    // exactly the selected rows: the first ones in id order that match the same filter
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare("DELETE FROM messages WHERE id BETWEEN ? AND ? "
+                        "AND timestamp < ? AND (recipient IS NULL OR delivered = 1)");
+    deleteQuery.addBindValue(firstId);
+    deleteQuery.addBindValue(lastId);
+    deleteQuery.addBindValue(cutoff);
+    if (!deleteQuery.exec()) {
+        return fail(deleteQuery);
+    }
+    if (deleteQuery.numRowsAffected() != messages.size()) {
+        qCWarning(lcDatabase) << "archive segment does not match the table, rolled back";
+        db.rollback();
+        QFile::remove(filePath);
+        return false;
+    }
+
+    if (!db.commit()) {
+        qCWarning(lcDatabase) << "failed to commit archive segment" << db.lastError().text();
+        db.rollback();
+        QFile::remove(filePath);
+        return false;
+    }
+
+    QMutexLocker locker(&lock);
+    files.insert(segment, fileName);
+    for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
+        // segments are written in id order, so appending keeps every room's list sorted
+        ranges[it.key()].append({segment, it->firstId, it->lastId});
+    }
+    return true;
+}
+
+std::optional<QList<ArchivedMessage>> MessageArchive::load(const qint64 segment) {
+    static Counter &loads = Metrics::instance().counter("timp_archive_segment_loads_total",
+                                                        "archive segments read from disk");
+    if (const QList<ArchivedMessage> *cached = decoded.object(segment)) {
+        return *cached;
+    }
+
+    QFile file(directory.filePath(files.value(segment)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(lcDatabase) << "failed to open archive segment" << file.fileName() << file.errorString();
+        return std::nullopt;
+    }
+    std::optional<QList<ArchivedMessage>> messages = ArchiveSegment::decode(file.readAll());
+    if (!messages) {
+        qCWarning(lcDatabase) << "archive segment is corrupt" << file.fileName();
+        return std::nullopt;
+    }
+
+    loads.add();
+    decoded.insert(segment, new QList<ArchivedMessage>(*messages));
+    return messages;
+}
+
+Database::HistoryPage MessageArchive::page(const QString &room, const int limit, const Database::HistoryCursor cursor) {
+    Database::HistoryPage page;
+
+    QMutexLocker locker(&lock);
+    const auto it = ranges.constFind(room);
+    if (it == ranges.cend()) {
+        return page;
+    }
+
+    // same bounds as the table query: (after_id, before_id), an unset bound is open
+    const bool forward = cursor.afterId > 0;
+    const qint64 above = cursor.afterId;
+    const qint64 below = cursor.beforeId > 0 ? cursor.beforeId : std::numeric_limits<qint64>::max();
+    const qsizetype wanted = static_cast<qsizetype>(std::max(limit, 0)) + 1;
+
+    auto collect = [&](const RoomRange &range) {
+        if (range.lastId <= above || range.firstId >= below) return;
+
+        const std::optional<QList<ArchivedMessage>> messages = load(range.segment);
+        if (!messages) return;
+
+        auto take = [&](const ArchivedMessage &message) {
+            if (message.room == room && message.id > above && message.id < below
+                && page.messages.size() < wanted) {
+                page.messages.append({message.id, message.sender, message.content, message.timestamp});
+            }
+        };
+        if (forward) {
+            std::ranges::for_each(*messages, take);
+        } else {
+            std::ranges::for_each(*messages | std::views::reverse, take);
+        }
+    };
+
+    if (forward) {
+        for (const RoomRange &range: *it) {
+            if (page.messages.size() == wanted) break;
+            collect(range);
+        }
+    } else {
+        for (const RoomRange &range: *it | std::views::reverse) {
+            if (page.messages.size() == wanted) break;
+            collect(range);
+        }
+    }
+
+    // the extra message only says there is more in this direction
+    if (page.messages.size() == wanted) {
+        page.hasMore = true;
+        page.messages.removeLast();
+    }
+    if (!forward) {
+        std::ranges::reverse(page.messages);
+    }
+    return page;
+}
+
+QStringList MessageArchive::rooms() const {
+    QMutexLocker locker(&lock);
+    QStringList result = ranges.keys();
+    result.removeAll(QString(DirectRoom));
+    return result;
+}
@@ -0,0 +1,100 @@
+#ifndef MESSAGE_ARCHIVE_H
+#define MESSAGE_ARCHIVE_H
+
+#include <QCache>
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include "archive_segment.h"
+#include "database.h"
+#include "retention_policy.h"
+
+/**
+ * @brief Класс MessageArchive — холодный уровень хранения сообщений.
+ *
+ * Сообщения старше RetentionPolicy::maxAge переносятся из таблицы messages в
+ * сжатые неизменяемые файлы-сегменты (ArchiveSegment). Справочник сегментов
+ * (таблицы archive_segments и archive_rooms: диапазоны id и времени, комнаты)
+ * хранится в основной БД и целиком держится в памяти, поэтому чтобы найти
+ * нужные сегменты, к SQLite обращаться не нужно.
+ *
+ * Database::getMessages() дочитывает из архива, когда в таблице messages
+ * сообщений в нужном направлении не осталось, так что для клиента история
+ * непрерывна. Несколько последних прочитанных сегментов хранятся
+ * разобранными. Полнотекстовый поиск покрывает только таблицу messages.
+ *
+ * Перенос выполняется в потоке хранилища; чтение потокобезопасно.
+ */
+class MessageArchive {
+public:
+    /**
+     * @brief Возвращает единственный экземпляр.
+     */
+    static MessageArchive &instance();
+
+    /**
+     * @brief Загружает справочник сегментов.
+     *
+     * Вызывается после Database::init(): уже перенесённые сообщения остаются
+     * доступными, даже если архивирование затем выключено.
+     * @param directory Каталог файлов сегментов (создаётся при необходимости).
+     * @return false если каталог недоступен или справочник не читается.
+     */
+    bool open(const QString &directory);
+
+    /**
+     * @brief Переносит в архив один сегмент сообщений старше policy.maxAge.
+     *
+     * Если после этого остались сообщения для переноса, следующий сегмент
+     * ставится в очередь хранилища отдельным заданием: остальные запросы
+     * выполняются между сегментами, а не ждут окончания всего переноса.
+     * Вызывается только в потоке хранилища.
+     */
+    void archiveExpired(const RetentionPolicy &policy);
+
+    /**
+     * @brief Страница архивных сообщений комнаты (семантика как у Database::getMessages()).
+     *
+     * С limit 0 возвращает пустую страницу, hasMore которой говорит, есть ли
+     * в архиве сообщения в этом направлении.
+     */
+    [[nodiscard]] Database::HistoryPage page(const QString &room, int limit, Database::HistoryCursor cursor);
+
+    /**
+     * @brief Комнаты, у которых есть сообщения в архиве.
+     */
+    [[nodiscard]] QStringList rooms() const;
+
+    /// Удаляем копирование
+    MessageArchive(const MessageArchive &) = delete;
+    /// Удаляем присваивание
+    MessageArchive &operator=(const MessageArchive &) = delete;
+
+private:
+    MessageArchive() = default;
+
+    /// Сообщения одной комнаты в одном сегменте
+    struct RoomRange {
+        qint64 segment = 0;
+        qint64 firstId = 0;
+        qint64 lastId = 0;
+    };
+
+    /// Разобранный сегмент: из кэша или прочитанный с диска
+    std::optional<QList<ArchivedMessage>> load(qint64 segment);
+
+    /// Пишет файл сегмента и регистрирует его, удаляя сообщения из messages
+    bool writeSegment(const QList<ArchivedMessage> &messages, const QString &cutoff);
+
+    mutable QMutex lock;
+    QDir directory;
+    QHash<qint64, QString> files;              ///< Сегмент -> имя файла
+    QHash<QString, QList<RoomRange>> ranges;   ///< Комната -> диапазоны по возрастанию id
+    QCache<qint64, QList<ArchivedMessage>> decoded{4}; ///< Последние прочитанные сегменты
+};
+
+#endif // MESSAGE_ARCHIVE_H
@@ -0,0 +1,165 @@
+#ifndef MESSAGE_STORE_H
+#define MESSAGE_STORE_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <optional>
+
+/// Значение room у личных сообщений: '@' недопустим в именах комнат, поэтому
+/// история комнат их никогда не видит
+inline constexpr QLatin1StringView DirectRoom("@direct");
+
+/**
+ * @brief Интерфейс MessageStore — бэкенд хранения пользователей и сообщений.
+ *
+ * Остальной сервер работает только со статическим фасадом Database, который
+ * выбирает бэкенд (SqliteStore или MemoryStore), выдаёт id сообщений из
+ * общей последовательности, снимает метрики и дочитывает архив. Бэкенд
+ * только хранит: id приходят к нему уже назначенными.
+ *
+ * Запись выполняется в одном потоке (потоке хранилища), чтение — также из
+ * потоков ReadPool, одновременно с записью.
+ */
+class MessageStore {
+public:
+    /// Новое сообщение комнаты
+    struct NewMessage {
+        QString room;      ///< Комната, в которую отправлено сообщение
+        QString sender;    ///< Имя отправителя
+        QString content;   ///< Текст сообщения
+        qint64 id = 0;     ///< Заполняется при сохранении
+        QString timestamp; ///< Заполняется при сохранении (ISO 8601, как при чтении из БД)
+    };
+
+    /// Сохранённое сообщение комнаты
+    struct StoredMessage {
+        qint64 id = 0;
+        QString sender;
+        QString content;
+        QString timestamp; ///< ISO 8601
+    };
+
+    /// Курсор постраничного чтения истории (0 — граница не задана)
+    struct HistoryCursor {
+        qint64 beforeId = 0; ///< Только сообщения с id меньше этого (листание назад)
+        qint64 afterId = 0;  ///< Только сообщения с id больше этого (листание вперёд)
+    };
+
+    /// Страница истории
+    struct HistoryPage {
+        QList<StoredMessage> messages; ///< От старых к новым
+        bool hasMore = false;        ///< За страницей в направлении листания есть ещё сообщения
+    };
+
+    /// Найденное сообщение
+    struct SearchHit {
+        qint64 id = 0;
+        QString sender;
+        QString snippet;   ///< Фрагмент текста; совпадения обрамлены SnippetOpen/SnippetClose
+        QString timestamp; ///< ISO 8601
+        double rank = 0;   ///< bm25: чем меньше, тем релевантнее
+    };
+
+    /// Начало и конец подсветки совпадения в SearchHit::snippet (STX/ETX не встречаются в обычном тексте)
+    static constexpr QChar SnippetOpen = u'\x02';
+    static constexpr QChar SnippetClose = u'\x03';
+
+    /**
+     * Курсор выдачи поиска: снимок и число уже показанных результатов.
+     *
+     * Снимок — наибольший id, который ищется, так что новые сообщения не сдвигают
+     * страницы. Ключом (rank, id) листать нельзя: bm25 зависит от статистики
+     * всего индекса и меняется с каждым новым сообщением.
+     */
+    struct SearchCursor {
+        qint64 untilId = 0; ///< Искать среди id не больше этого (0 — снимок берётся сейчас)
+        int offset = 0;     ///< Сколько результатов снимка уже показано
+    };
+
+    /// Страница результатов поиска
+    struct SearchPage {
+        QList<SearchHit> hits; ///< От более релевантных к менее
+        bool hasMore = false;
+        qint64 untilId = 0;    ///< Снимок, которым листать дальше
+    };
+
+    virtual ~MessageStore() = default;
+
+    /**
+     * @brief Регистрирует пользователя.
+     * @return false если имя занято или запись не удалась.
+     */
+    virtual bool registerUser(const QString &username, const QString &passwordHash) = 0;
+
+    /**
+     * @brief Сохранённый хэш пароля или std::nullopt, если пользователя нет.
+     */
+    virtual std::optional<QString> passwordHash(const QString &username) = 0;
+
+    /**
+     * @brief Заменяет хэш пароля.
+     */
+    virtual void updatePasswordHash(const QString &username, const QString &passwordHash) = 0;
+
+    /**
+     * @brief Проверяет, зарегистрирован ли пользователь.
+     */
+    virtual bool userExists(const QString &username) = 0;
+
+    /**
+     * @brief Наибольший id сообщения, когда-либо выданный этому хранилищу.
+     *
+     * С него Database продолжает последовательность id после перезапуска.
+     * @return nullopt, если его не удалось прочитать: продолжать с нуля нельзя, id бы повторились.
+     */
+    virtual std::optional<qint64> lastMessageId() = 0;
+
+    /**
+     * @brief Сохраняет пакет сообщений с уже назначенными id: все или ни одного.
+     *
+     * Сохранённым сообщениям проставляется timestamp.
+     */
+    virtual bool saveMessages(QList<NewMessage> &messages) = 0;
+
+    /**
+     * @brief Страница истории комнаты (семантика как у Database::getMessages(), без архива).
+     *
+     * С limit 0 возвращает пустую страницу, hasMore которой говорит, есть ли
+     * сообщения в этом направлении.
+     */
+    virtual HistoryPage messages(const QString &room, int limit, HistoryCursor cursor) = 0;
+
+    /**
+     * @brief Полнотекстовый поиск (семантика как у Database::searchMessages()).
+     * @return std::nullopt если бэкенд не умеет искать.
+     */
+    virtual std::optional<SearchPage> searchMessages(const QString &room, const QString &text, int limit,
+                                                     SearchCursor cursor) = 0;
+
+    /**
+     * @brief Комнаты, в которых есть сообщения.
+     */
+    virtual QStringList rooms() = 0;
+
+    /**
+     * @brief Сохраняет личное сообщение с уже назначенным id.
+     * @return false если запись не удалась.
+     */
+    virtual bool saveDirectMessage(qint64 id, const QString &sender, const QString &recipient,
+                                   const QString &content, bool delivered) = 0;
+
+    /**
+     * @brief Возвращает личное сообщение в очередь недоставленных.
+     */
+    virtual void markUndelivered(qint64 messageId) = 0;
+
+    /**
+     * @brief Забирает недоставленные личные сообщения пользователя (семантика как у Database).
+     */
+    virtual QList<QVariantMap> takeUndeliveredMessages(const QString &recipient) = 0;
+};
+
+#endif // MESSAGE_STORE_H
@@ -0,0 +1,34 @@
+#include "read_pool.h"
+
+#include <algorithm>
+
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+ReadPool &ReadPool::instance() {
+    static ReadPool readPool;
+    return readPool;
+}
+
+void ReadPool::start(const int readerThreads) {
+    readers = std::max(readerThreads, 0);
+    pendingGauge = &Metrics::instance().gauge("timp_read_pool_pending", "database reads queued or running");
+
+    pool.setMaxThreadCount(std::max(readers, 1));
+    // a thread owns its read-only connection and prepared statements, so it must not expire
+    pool.setExpiryTimeout(-1);
+    qCInfo(lcDatabase) << "read pool:" << readers << "read-only connections";
+}
+
+void ReadPool::stop() {
+    // also ends the pool threads, which closes their read-only connections
+    pool.waitForDone();
+}
+
+void ReadPool::enqueued() {
+    pendingGauge->set(pending.fetch_add(1, std::memory_order_relaxed) + 1);
+}
+
+void ReadPool::finished() {
+    pendingGauge->set(pending.fetch_sub(1, std::memory_order_relaxed) - 1);
+}
@@ -0,0 +1,96 @@
+#ifndef READ_POOL_H
+#define READ_POOL_H
+
+#include <QPointer>
+#include <QThreadPool>
+
+#include <atomic>
+#include <type_traits>
+
+#include "database.h"
+#include "storage_executor.h"
+#include "util/caller_thread.h"
+
+class Gauge;
+
+/**
+ * @brief Класс ReadPool — потоки с соединениями SQLite только для чтения.
+ *
+ * StorageExecutor остаётся единственным писателем, а чтения (история,
+ * хэш пароля при входе, поиск) выполняются параллельно с ним и друг с другом:
+ * в режиме WAL читатели не ждут писателя. У каждого потока пула своё
+ * соединение, открытое с QSQLITE_OPEN_READONLY; задание получает его на
+ * время выполнения через Database::ReadLease. Потоки пула не завершаются
+ * по простою, поэтому соединение и подготовленные запросы живут вместе
+ * с потоком.
+ *
+ * Читатель видит только зафиксированные данные: сообщение, ещё ждущее
+ * группового сохранения, в ответ не попадёт (как и в HistoryCache).
+ */
+class ReadPool {
+public:
+    /**
+     * @brief Возвращает единственный экземпляр.
+     */
+    static ReadPool &instance();
+
+    /**
+     * @brief Запускает пул.
+     * @param readers Число потоков-читателей; 0 — чтения выполняются в потоке хранилища.
+     */
+    void start(int readers);
+
+    /**
+     * @brief Дожидается выполнения начатых чтений и завершает потоки пула (с их соединениями).
+     */
+    void stop();
+
+    /**
+     * @brief Выполняет чтение job на соединении только для чтения и передаёт результат в completion.
+     *
+     * completion вызывается в потоке, который вызвал submit(), и только если
+     * context к тому моменту ещё существует. job не должен писать в БД.
+     * @param context Объект, с жизнью которого связано продолжение.
+     * @param job Функция без аргументов, выполняемая в потоке пула.
+     * @param completion Функция, принимающая результат job.
+     */
+    template<typename Job, typename Completion>
+    void submit(QObject *context, Job job, Completion completion) {
+        if (readers == 0) {
+            StorageExecutor::instance().submit(context, std::move(job), std::move(completion));
+            return;
+        }
+
+        QPointer<QObject> guard(context);
+        QObject *sink = CallerThread::sink();
+        enqueued();
+        pool.start([this, guard, sink, job = std::move(job), completion = std::move(completion)]() mutable {
+            auto result = [&job] {
+                Database::ReadLease lease;
+                return job();
+            }();
+            finished();
+            CallerThread::complete(guard, sink, std::move(completion), std::move(result));
+        });
+    }
+
+    /// Удаляем копирование
+    ReadPool(const ReadPool &) = delete;
+    /// Удаляем присваивание
+    ReadPool &operator=(const ReadPool &) = delete;
+
+private:
+    ReadPool() = default;
+
+    /// Учитывает задание в timp_read_pool_pending
+    void enqueued();
+    /// Снимает выполненное задание с учёта
+    void finished();
+
+    int readers = 0;
+    QThreadPool pool;
+    std::atomic<qint64> pending{0};  ///< Чтений в очереди и в работе
+    Gauge *pendingGauge = nullptr;   ///< timp_read_pool_pending
+};
+
+#endif // READ_POOL_H
@@ -0,0 +1,23 @@
+#ifndef RETENTION_POLICY_H
+#define RETENTION_POLICY_H
+
+#include <QString>
+
+#include <chrono>
+
+/**
+ * @brief Параметры переноса старых сообщений из таблицы messages в архив.
+ *
+ * Сообщения старше maxAge периодически переносятся в сжатые неизменяемые
+ * сегменты (MessageArchive), чтобы рабочая таблица оставалась маленькой и
+ * помещалась в кэш страниц SQLite. Недоставленные личные сообщения остаются
+ * в таблице до доставки.
+ */
+struct RetentionPolicy {
+    std::chrono::hours maxAge{0};           ///< Возраст, после которого сообщение уходит в архив (0 — не архивировать)
+    std::chrono::minutes interval{60};      ///< Как часто проверять, не пора ли архивировать
+    int segmentSize = 10000;                ///< Сообщений в одном сегменте (и в одной транзакции переноса)
+    QString archiveDirectory = "archive";   ///< Каталог файлов сегментов
+};
+
+#endif // RETENTION_POLICY_H
@@ -0,0 +1,576 @@
+#include "sqlite_store.h"
+
+#include <QDateTime>
+#include <QSqlError>
+#include <QThread>
+
+#include <algorithm>
+#include <limits>
+
+#include "database.h"
+#include "log/logging.h"
+
+SqliteStore::~SqliteStore() {
+    if (db.isOpen()) {
+        db.close();
+    }
+}
+
+bool SqliteStore::open(const QString &path, const Durability mode) {
+    owner = QThread::currentThread();
+    durability = mode;
+    db = QSqlDatabase::addDatabase("QSQLITE");
+    db.setDatabaseName(path);
+    // worker threads open their own connections to the same file
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+
+    if (!db.open()) {
+        qCCritical(lcDatabase) << "failed to open database" << db.lastError().text();
+        return false;
+    }
+
+    // WAL is a property of the file: set once, every later connection inherits it.
+    // Readers no longer block the writer and a commit appends to the log instead of
+    // rewriting pages through a rollback journal
+    QSqlQuery walQuery(db);
+    if (!walQuery.exec("PRAGMA journal_mode=WAL") || !walQuery.next()
+        || walQuery.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0) {
+        qCWarning(lcDatabase) << "WAL journal mode is not available, staying in rollback journal mode";
+    }
+    configure(db);
+
+    return createTables();
+}
+
+void SqliteStore::configure(QSqlDatabase &connection) const {
+    // in WAL mode NORMAL syncs only at checkpoints: a power loss may drop the last commits, never corrupts
+    QSqlQuery query(connection);
+    if (!query.exec(durability == Durability::Strict ? "PRAGMA synchronous=FULL" : "PRAGMA synchronous=NORMAL")) {
+        qCWarning(lcDatabase) << "failed to set synchronous mode" << query.lastError().text();
+    }
+}
+
+QSqlDatabase SqliteStore::connection() {
+    if (QThread::currentThread() == owner) {
+        return QSqlDatabase::database();
+    }
+
+    const bool readOnly = Database::ReadLease::held();
+    const QString name = QString(readOnly ? "timp_ro_%1" : "timp_%1")
+            .arg(reinterpret_cast<quintptr>(QThread::currentThread()));
+    if (QSqlDatabase::contains(name)) {
+        return QSqlDatabase::database(name);
+    }
+
+    QSqlDatabase threadDb = QSqlDatabase::cloneDatabase(QSqlDatabase::defaultConnection, name);
+    if (readOnly) {
+        // WAL readers never block the storage thread's writes, and a stray write fails instead of contending
+        threadDb.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    }
+    if (!threadDb.open()) {
+        qCCritical(lcDatabase) << "failed to open database for thread" << threadDb.lastError().text();
+        return threadDb;
+    }
+    configure(threadDb);
+
+    // finished is emitted on the exiting thread itself, while its statements are still alive
+    QObject::connect(QThread::currentThread(), &QThread::finished, [] { releaseThread(); });
+    return threadDb;
+}
+
+void SqliteStore::releaseThread() {
+    // a connection cannot be removed while queries on it exist
+    for (std::optional<QSqlQuery> &cached: statements) {
+        cached.reset();
+    }
+    unprepared = QSqlQuery();
+
+    const auto thread = reinterpret_cast<quintptr>(QThread::currentThread());
+    for (const char *pattern: {"timp_%1", "timp_ro_%1"}) {
+        const QString name = QString(pattern).arg(thread);
+        if (!QSqlDatabase::contains(name)) continue;
+        {
+            QSqlDatabase threadDb = QSqlDatabase::database(name, false);
+            threadDb.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    }
+}
+
+thread_local std::array<std::optional<QSqlQuery>, SqliteStore::StatementCount> SqliteStore::statements;
+thread_local QSqlQuery SqliteStore::unprepared;
+
+QSqlQuery &SqliteStore::statement(const Statement id) {
+    static constexpr std::array<const char *, StatementCount> sql = {
+        "INSERT INTO users (username, password) VALUES (?, ?)",
+        "SELECT password FROM users WHERE username = ?",
+        "UPDATE users SET password = ? WHERE username = ?",
+        "SELECT 1 FROM users WHERE username = ?",
+        // ids come from Database, which shares one sequence between the backends
+        "INSERT INTO messages (id, room, sender, content, timestamp) VALUES (?, ?, ?, ?, ?)",
+        "INSERT INTO messages (id, room, sender, recipient, content, delivered) VALUES (?, ?, ?, ?, ?, ?)",
+        "UPDATE messages SET delivered = 0 WHERE id = ?",
+        "SELECT id, sender, content, timestamp FROM messages WHERE recipient = ? AND delivered = 0 ORDER BY id",
+        "UPDATE messages SET delivered = 1 WHERE recipient = ? AND delivered = 0 AND id <= ?",
+        // ordered by id rather than timestamp so the (room, id) index answers the query without a sort
+        "SELECT id, sender, content, timestamp FROM messages WHERE room = ? AND id > ? AND id < ? "
+        "ORDER BY id DESC LIMIT ?",
+        "SELECT id, sender, content, timestamp FROM messages WHERE room = ? AND id > ? AND id < ? "
+        "ORDER BY id ASC LIMIT ?",
+        // the room is both a MATCH term (an index intersection) and an exact filter (tokens drop punctuation)
+        "SELECT id, sender, timestamp, snip, score FROM ("
+        "SELECT m.id AS id, m.sender AS sender, m.timestamp AS timestamp, "
+        "snippet(messages_fts, 0, char(2), char(3), '…', 16) AS snip, bm25(messages_fts) AS score "
+        "FROM messages_fts JOIN messages m ON m.id = messages_fts.rowid "
+        "WHERE messages_fts MATCH ? AND m.room = ? AND m.id <= ?) "
+        "ORDER BY score, id LIMIT ? OFFSET ?",
+    };
+
+    const auto index = static_cast<std::size_t>(id);
+    std::optional<QSqlQuery> &cached = statements[index];
+    if (!cached) {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        if (!query.prepare(sql[index])) {
+            // not cached: the next call tries again; this one fails on exec() with the same error
+            qCWarning(lcDatabase) << "failed to prepare statement" << query.lastError().text();
+            unprepared = std::move(query);
+            return unprepared;
+        }
+        cached = std::move(query);
+    }
+    return *cached;
+}
+
+bool SqliteStore::createTables() {
+    QSqlQuery usersQuery(connection());
+    if (!usersQuery.exec(
+        "CREATE TABLE IF NOT EXISTS users ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "username TEXT UNIQUE NOT NULL, "
+        "password TEXT NOT NULL, "
+        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP)")) {
+        qCCritical(lcDatabase) << "failed to create users table" << usersQuery.lastError().text();
+        return false;
+    }
+
+    QSqlQuery messagesQuery(connection());
+    if (!messagesQuery.exec(
+        "CREATE TABLE IF NOT EXISTS messages ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "sender TEXT NOT NULL, "
+        "content TEXT NOT NULL, "
+        "timestamp DATETIME DEFAULT CURRENT_TIMESTAMP, "
+        "room TEXT NOT NULL DEFAULT 'general', "
+        "recipient TEXT, "
+        "delivered INTEGER NOT NULL DEFAULT 1, "
+        "FOREIGN KEY (sender) REFERENCES users(username))")) {
+        qCCritical(lcDatabase) << "failed to create messages table" << messagesQuery.lastError().text();
+        return false;
+    }
+
+    // columns added after the first release; older databases get them in place
+    // (old messages all belong to the default room and were delivered)
+    const struct {
+        const char *name;
+        const char *definition;
+    } addedColumns[] = {
+        {"room", "TEXT NOT NULL DEFAULT 'general'"},
+        {"recipient", "TEXT"},
+        {"delivered", "INTEGER NOT NULL DEFAULT 1"},
+    };
+    for (const auto &column: addedColumns) {
+        if (hasColumn("messages", column.name)) continue;
+
+        QSqlQuery migrateQuery(connection());
+        if (!migrateQuery.exec(QString("ALTER TABLE messages ADD COLUMN %1 %2").arg(column.name, column.definition))) {
+            qCCritical(lcDatabase) << "failed to add column" << column.name << migrateQuery.lastError().text();
+            return false;
+        }
+        qCInfo(lcDatabase) << "messages table migrated: added" << column.name;
+    }
+
+    // the directory of archived segments (MessageArchive); the segments themselves are files
+    const char *archiveTables[] = {
+        "CREATE TABLE IF NOT EXISTS archive_segments ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "file TEXT NOT NULL, "
+        "first_id INTEGER NOT NULL, "
+        "last_id INTEGER NOT NULL, "
+        "first_timestamp TEXT NOT NULL, "
+        "last_timestamp TEXT NOT NULL, "
+        "message_count INTEGER NOT NULL)",
+        "CREATE TABLE IF NOT EXISTS archive_rooms ("
+        "segment INTEGER NOT NULL REFERENCES archive_segments(id), "
+        "room TEXT NOT NULL, "
+        "first_id INTEGER NOT NULL, "
+        "last_id INTEGER NOT NULL, "
+        "message_count INTEGER NOT NULL, "
+        "PRIMARY KEY (room, first_id))",
+    };
+    for (const char *table: archiveTables) {
+        QSqlQuery archiveQuery(connection());
+        if (!archiveQuery.exec(table)) {
+            qCCritical(lcDatabase) << "failed to create archive directory table" << archiveQuery.lastError().text();
+            return false;
+        }
+    }
+
+    const char *indexes[] = {
+        // per-room history reads walk this index backwards from the newest id
+        "CREATE INDEX IF NOT EXISTS idx_messages_room_id ON messages (room, id)",
+        // direct messages only: a recipient's pending backlog is a short range scan
+        "CREATE INDEX IF NOT EXISTS idx_messages_recipient ON messages (recipient, delivered, id) "
+        "WHERE recipient IS NOT NULL",
+    };
+    for (const char *index: indexes) {
+        QSqlQuery indexQuery(connection());
+        if (!indexQuery.exec(index)) {
+            qCCritical(lcDatabase) << "failed to create index" << indexQuery.lastError().text();
+            return false;
+        }
+    }
+
+    fullTextSearch = createSearchIndex();
+    return true;
+}
+
+bool SqliteStore::createSearchIndex() {
+    QSqlQuery existsQuery(connection());
+    const bool existed = existsQuery.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'messages_fts'")
+                         && existsQuery.next();
+    existsQuery.finish();
+
+    QSqlQuery tableQuery(connection());
+    if (!tableQuery.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5("
+                         "content, room, content='messages', content_rowid='id')")) {
+        qCWarning(lcDatabase) << "full-text search is not available" << tableQuery.lastError().text();
+        return false;
+    }
+
+    // an external-content index is not updated by SQLite itself; direct messages stay out of it
+    const char *triggers[] = {
+        "CREATE TRIGGER IF NOT EXISTS messages_fts_insert AFTER INSERT ON messages WHEN new.recipient IS NULL "
+        "BEGIN INSERT INTO messages_fts (rowid, content, room) VALUES (new.id, new.content, new.room); END",
+        "CREATE TRIGGER IF NOT EXISTS messages_fts_delete AFTER DELETE ON messages WHEN old.recipient IS NULL "
+        "BEGIN INSERT INTO messages_fts (messages_fts, rowid, content, room) "
+        "VALUES ('delete', old.id, old.content, old.room); END",
+        "CREATE TRIGGER IF NOT EXISTS messages_fts_update AFTER UPDATE OF content, room ON messages "
+        "WHEN old.recipient IS NULL "
+        "BEGIN INSERT INTO messages_fts (messages_fts, rowid, content, room) "
+        "VALUES ('delete', old.id, old.content, old.room); "
+        "INSERT INTO messages_fts (rowid, content, room) VALUES (new.id, new.content, new.room); END",
+    };
+    for (const char *trigger: triggers) {
+        QSqlQuery triggerQuery(connection());
+        if (!triggerQuery.exec(trigger)) {
+            qCCritical(lcDatabase) << "failed to create search trigger" << triggerQuery.lastError().text();
+            return false;
+        }
+    }
+
+    if (!existed) {
+        // not 'rebuild': that would index every row of messages, direct messages included
+        QSqlQuery fillQuery(connection());
+        if (!fillQuery.exec("INSERT INTO messages_fts (rowid, content, room) "
+                            "SELECT id, content, room FROM messages WHERE recipient IS NULL")) {
+            qCCritical(lcDatabase) << "failed to index existing messages" << fillQuery.lastError().text();
+            return false;
+        }
+        qCInfo(lcDatabase) << "search index built:" << fillQuery.numRowsAffected() << "messages";
+    }
+    return true;
+}
+
+bool SqliteStore::hasColumn(const QString &table, const QString &column) {
+    QSqlQuery query(connection());
+    if (!query.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+        return false;
+    }
+    while (query.next()) {
+        if (query.value(1).toString() == column) {
+            return true;
+        }
+    }
+    return false;
+}
+bool SqliteStore::registerUser(const QString &username, const QString &passwordHash) {
+    QSqlQuery &query = statement(Statement::RegisterUser);
+    query.bindValue(0, username);
+    query.bindValue(1, passwordHash);
+
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to register users" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<QString> SqliteStore::passwordHash(const QString &username) {
+    QSqlQuery &query = statement(Statement::SelectPassword);
+    query.bindValue(0, username);
+
+    if (!query.exec() || !query.next()) {
+        qCDebug(lcDatabase) << "user not found";
+        query.finish();
+        return std::nullopt;
+    }
+
+    QString hash = query.value(0).toString();
+    query.finish();
+    return hash;
+}
+
+void SqliteStore::updatePasswordHash(const QString &username, const QString &passwordHash) {
+    QSqlQuery &query = statement(Statement::UpdatePassword);
+    query.bindValue(0, passwordHash);
+    query.bindValue(1, username);
+
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to update password hash" << query.lastError().text();
+    }
+}
+
+bool SqliteStore::userExists(const QString &username) {
+    QSqlQuery &query = statement(Statement::UserExists);
+    query.bindValue(0, username);
+    const bool exists = query.exec() && query.next();
+    query.finish();
+    return exists;
+}
+
+std::optional<qint64> SqliteStore::lastMessageId() {
+    // AUTOINCREMENT keeps the high-water mark in sqlite_sequence, so ids of archived rows are never reused
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT MAX(COALESCE((SELECT seq FROM sqlite_sequence WHERE name = 'messages'), 0), "
+                    "COALESCE((SELECT MAX(id) FROM messages), 0))") || !query.next()) {
+        qCCritical(lcDatabase) << "failed to read the last message id" << query.lastError().text();
+        return std::nullopt;
+    }
+    return query.value(0).toLongLong();
+}
+
+bool SqliteStore::saveMessages(QList<NewMessage> &messages) {
+    if (messages.isEmpty()) {
+        return true;
+    }
+
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        qCWarning(lcDatabase) << "failed to begin transaction" << db.lastError().text();
+        return false;
+    }
+
+    // the same value CURRENT_TIMESTAMP would store, so callers can know it without reading the row back
+    const QString stored = QDateTime::currentDateTimeUtc().toString("yyyy-MM-dd HH:mm:ss");
+    const QString timestamp = QDateTime::fromString(stored, "yyyy-MM-dd HH:mm:ss").toString(Qt::ISODate);
+
+    // one prepared statement for the whole batch; only the bound values change
+    QSqlQuery &query = statement(Statement::InsertMessage);
+    for (NewMessage &message: messages) {
+        query.bindValue(0, message.id);
+        query.bindValue(1, message.room);
+        query.bindValue(2, message.sender);
+        query.bindValue(3, message.content);
+        query.bindValue(4, stored);
+
+        if (!query.exec()) {
+            qCWarning(lcDatabase) << "failed to save message" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+        message.timestamp = timestamp;
+    }
+
+    if (!db.commit()) {
+        qCWarning(lcDatabase) << "failed to commit messages" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool SqliteStore::saveDirectMessage(const qint64 id, const QString &sender, const QString &recipient,
+                                    const QString &content, const bool delivered) {
+    QSqlQuery &query = statement(Statement::InsertDirect);
+    query.bindValue(0, id);
+    query.bindValue(1, QString(DirectRoom));
+    query.bindValue(2, sender);
+    query.bindValue(3, recipient);
+    query.bindValue(4, content);
+    query.bindValue(5, delivered ? 1 : 0);
+
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to save direct message" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+void SqliteStore::markUndelivered(const qint64 messageId) {
+    QSqlQuery &query = statement(Statement::MarkUndelivered);
+    query.bindValue(0, messageId);
+
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to mark message undelivered" << query.lastError().text();
+    }
+}
+
+QList<QVariantMap> SqliteStore::takeUndeliveredMessages(const QString &recipient) {
+    QList<QVariantMap> messages;
+
+    QSqlQuery &query = statement(Statement::SelectUndelivered);
+    query.bindValue(0, recipient);
+
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to get undelivered messages" << query.lastError().text();
+        return messages;
+    }
+
+    qint64 lastId = 0;
+    while (query.next()) {
+        QVariantMap message;
+        lastId = query.value(0).toLongLong();
+        message["id"] = lastId;
+        message["sender"] = query.value(1).toString();
+        message["content"] = query.value(2).toString();
+        message["timestamp"] = query.value(3).toDateTime().toString(Qt::ISODate);
+        messages.append(message);
+    }
+    query.finish();
+
+    if (messages.isEmpty()) {
+        return messages;
+    }
+
+    // only what was read: a message queued meanwhile stays pending for the next login
+    QSqlQuery &update = statement(Statement::MarkDelivered);
+    update.bindValue(0, recipient);
+    update.bindValue(1, lastId);
+    if (!update.exec()) {
+        qCWarning(lcDatabase) << "failed to mark messages delivered" << update.lastError().text();
+    }
+
+    return messages;
+}
+
+MessageStore::HistoryPage SqliteStore::messages(const QString &room, const int limit, const HistoryCursor cursor) {
+    HistoryPage page;
+
+    // paging forward walks the (room, id) index up from after_id, otherwise down from before_id;
+    // an unset bound is open, so both statements serve every cursor combination
+    const bool forward = cursor.afterId > 0;
+    QSqlQuery &query = statement(forward ? Statement::HistoryForward : Statement::HistoryBackward);
+    query.bindValue(0, room);
+    query.bindValue(1, cursor.afterId);
+    query.bindValue(2, cursor.beforeId > 0 ? cursor.beforeId : std::numeric_limits<qint64>::max());
+    // one extra row tells whether another page exists
+    query.bindValue(3, limit + 1);
+
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to get messages" << query.lastError().text();
+        return page;
+    }
+
+    while (query.next()) {
+        if (page.messages.size() == limit) {
+            page.hasMore = true;
+            break;
+        }
+
+        page.messages.append({query.value(0).toLongLong(), query.value(1).toString(), query.value(2).toString(),
+                              query.value(3).toDateTime().toString(Qt::ISODate)});
+    }
+    query.finish();
+
+    if (!forward) {
+        std::ranges::reverse(page.messages);
+    }
+    return page;
+}
+
+namespace {
+    constexpr qsizetype MaxSearchTerms = 16;
+
+    /// FTS5 phrase for arbitrary text: quotes are doubled, nothing inside is syntax
+    QString ftsPhrase(QString text) {
+        return '"' + text.replace('"', "\"\"") + '"';
+    }
+
+    /**
+     * Turns user input into a MATCH expression: every word a required phrase, a trailing '*' a prefix.
+     * Empty when nothing searchable is left.
+     */
+    QString matchExpression(const QString &room, const QString &text) {
+        QStringList phrases;
+        for (QString term: text.simplified().split(u' ', Qt::SkipEmptyParts)) {
+            const bool prefix = term.endsWith(u'*');
+            term.remove(u'*');
+            if (term.isEmpty()) continue;
+
+            phrases.append(ftsPhrase(term) + (prefix ? "*" : ""));
+            if (phrases.size() == MaxSearchTerms) break;
+        }
+        if (phrases.isEmpty()) {
+            return {};
+        }
+        return QString("room : %1 AND content : (%2)").arg(ftsPhrase(room), phrases.join(u' '));
+    }
+}
+
+std::optional<MessageStore::SearchPage> SqliteStore::searchMessages(const QString &room, const QString &text,
+                                                                    const int limit, const SearchCursor cursor) {
+    if (!fullTextSearch) {
+        return std::nullopt;
+    }
+    const QString match = matchExpression(room, text);
+    if (match.isEmpty()) {
+        return SearchPage{};
+    }
+
+    QSqlQuery &query = statement(Statement::SearchMessages);
+    query.bindValue(0, match);
+    query.bindValue(1, room);
+    query.bindValue(2, cursor.untilId > 0 ? cursor.untilId : std::numeric_limits<qint64>::max());
+    query.bindValue(3, limit + 1);
+    query.bindValue(4, std::max(cursor.offset, 0));
+
+    SearchPage page;
+    if (!query.exec()) {
+        qCWarning(lcDatabase) << "failed to search messages" << query.lastError().text();
+        return page;
+    }
+
+    while (query.next()) {
+        if (page.hits.size() == limit) {
+            page.hasMore = true;
+            break;
+        }
+
+        page.hits.append({query.value(0).toLongLong(), query.value(1).toString(), query.value(3).toString(),
+                          query.value(2).toDateTime().toString(Qt::ISODate), query.value(4).toDouble()});
+    }
+    query.finish();
+    return page;
+}
+
+QStringList SqliteStore::rooms() {
+    QStringList rooms;
+
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    // answered from the (room, id) index without touching the table rows
+    if (!query.exec(QString("SELECT DISTINCT room FROM messages WHERE room != '%1'").arg(DirectRoom))) {
+        qCWarning(lcDatabase) << "failed to list rooms" << query.lastError().text();
+        return rooms;
+    }
+
+    while (query.next()) {
+        rooms.append(query.value(0).toString());
+    }
+    return rooms;
+}
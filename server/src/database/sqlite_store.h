@@ -0,0 +1,141 @@
+#ifndef SQLITE_STORE_H
+#define SQLITE_STORE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include <array>
+#include <optional>
+
+#include "commit_policy.h"
+#include "message_store.h"
+
+class QThread;
+
+/**
+ * @brief Класс SqliteStore — хранилище в файле SQLite (режим WAL).
+ *
+ * Каждый поток работает через собственное соединение (connection()),
+ * запросы подготавливаются один раз на соединение. Сообщения комнат
+ * индексируются FTS5 для поиска. Таблицы messages и archive_* также
+ * использует MessageArchive.
+ */
+class SqliteStore final : public MessageStore {
+public:
+    SqliteStore() = default;
+    ~SqliteStore() override;
+
+    SqliteStore(const SqliteStore &) = delete;
+    SqliteStore &operator=(const SqliteStore &) = delete;
+
+    /**
+     * @brief Открывает файл, переводит его в режим WAL и создаёт таблицы.
+     *
+     * Вызывающий поток становится владельцем основного соединения.
+     * @param path Путь к файлу базы данных.
+     * @param durability Режим надёжности: определяет PRAGMA synchronous всех соединений.
+     * @return true если инициализация прошла успешно, иначе false.
+     */
+    bool open(const QString &path, Durability durability);
+
+    /**
+     * @brief Возвращает соединение с БД для текущего потока.
+     *
+     * QSqlDatabase нельзя использовать из потока, который его не создавал,
+     * поэтому каждый рабочий поток получает собственный клон основного
+     * соединения (под Database::ReadLease — открытый только для чтения).
+     * Клон закрывается и удаляется, когда его поток завершается.
+     * @return Открытое соединение текущего потока.
+     */
+    QSqlDatabase connection();
+
+    bool registerUser(const QString &username, const QString &passwordHash) override;
+    std::optional<QString> passwordHash(const QString &username) override;
+    void updatePasswordHash(const QString &username, const QString &passwordHash) override;
+    bool userExists(const QString &username) override;
+    std::optional<qint64> lastMessageId() override;
+    bool saveMessages(QList<NewMessage> &messages) override;
+    HistoryPage messages(const QString &room, int limit, HistoryCursor cursor) override;
+    std::optional<SearchPage> searchMessages(const QString &room, const QString &text, int limit,
+                                             SearchCursor cursor) override;
+    QStringList rooms() override;
+    bool saveDirectMessage(qint64 id, const QString &sender, const QString &recipient, const QString &content,
+                           bool delivered) override;
+    void markUndelivered(qint64 messageId) override;
+    QList<QVariantMap> takeUndeliveredMessages(const QString &recipient) override;
+
+private:
+    /// Запросы, которые подготавливаются один раз на соединение
+    enum class Statement {
+        RegisterUser,
+        SelectPassword,
+        UpdatePassword,
+        UserExists,
+        InsertMessage,
+        InsertDirect,
+        MarkUndelivered,
+        SelectUndelivered,
+        MarkDelivered,
+        HistoryBackward,
+        HistoryForward,
+        SearchMessages,
+        Count
+    };
+    static constexpr std::size_t StatementCount = static_cast<std::size_t>(Statement::Count);
+
+    /**
+     * @brief Возвращает подготовленный запрос соединения текущего потока.
+     *
+     * SQL разбирается и планируется SQLite один раз при первом вызове в потоке,
+     * дальше запрос переиспользуется с новыми значениями параметров. После
+     * чтения SELECT вызывающий обязан вызвать finish(), чтобы сбросить запрос.
+     */
+    QSqlQuery &statement(Statement id);
+
+    /**
+     * @brief Закрывает и удаляет соединения текущего потока вместе с его подготовленными запросами.
+     *
+     * Вызывается по QThread::finished потока, которому connection() выдал клон.
+     */
+    static void releaseThread();
+
+    // statements belong to the connection of the thread that prepared them, like the connection itself
+    static thread_local std::array<std::optional<QSqlQuery>, StatementCount> statements;
+    static thread_local QSqlQuery unprepared; ///< Запрос, который не удалось подготовить
+
+    /**
+     * @brief Создаёт таблицы (если они ещё не существуют) и переносит старые схемы.
+     */
+    bool createTables();
+
+    /**
+     * @brief Создаёт индекс FTS5 для сообщений комнат и триггеры, которые поддерживают его.
+     *
+     * Индекс с внешним содержимым (content='messages'): текст хранится только
+     * в messages, индекс держит лишь термы. При первом создании индексируются
+     * уже сохранённые сообщения. Личные сообщения не индексируются.
+     * @return false если SQLite собран без FTS5; тогда поиск недоступен.
+     */
+    bool createSearchIndex();
+
+    /**
+     * @brief Проверяет наличие столбца в таблице (для миграций).
+     */
+    bool hasColumn(const QString &table, const QString &column);
+
+    /**
+     * @brief Настраивает только что открытое соединение (PRAGMA synchronous).
+     */
+    void configure(QSqlDatabase &connection) const;
+
+    /// Основное соединение (принадлежит потоку, вызвавшему open())
+    QSqlDatabase db;
+    /// Поток основного соединения
+    QThread *owner = nullptr;
+    /// Режим надёжности, заданный в open()
+    Durability durability = Durability::Strict;
+    /// Индекс FTS5 создан (SQLite собран с FTS5)
+    bool fullTextSearch = false;
+};
+
+#endif // SQLITE_STORE_H
@@ -0,0 +1,155 @@
+#include "storage_executor.h"
+
+#include "history_cache.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+#include <QDeadlineTimer>
+
+#include <algorithm>
+
+StorageExecutor &StorageExecutor::instance() {
+    static StorageExecutor executor;
+    return executor;
+}
+
+void StorageExecutor::start(const GroupCommitPolicy &commitPolicy) {
+    if (thread) return;
+
+    policy = commitPolicy;
+    policy.maxBatch = std::max(policy.maxBatch, 1);
+    const QString durability = Metrics::label("durability",
+                                              policy.durability == Durability::Strict ? "strict" : "relaxed");
+    commitTime = &Metrics::instance().histogram("timp_commit_duration_us", "message batch commit time, microseconds",
+                                                durability);
+    batchSize = &Metrics::instance().histogram("timp_commit_batch_size", "messages per committed batch", durability);
+
+    clock.start();
+    running.store(true, std::memory_order_release);
+    thread = QThread::create([this] { run(); });
+    thread->setObjectName("storage");
+    thread->start();
+}
+
+void StorageExecutor::stop() {
+    if (!thread) return;
+
+    running.store(false, std::memory_order_release);
+    wake();
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+}
+
+void StorageExecutor::post(std::function<void()> job) {
+    enqueue({std::move(job), 0, std::nullopt, {}});
+}
+
+void StorageExecutor::appendMessage(Database::NewMessage message, std::function<void(qint64)> stored) {
+    enqueue({{}, 0, std::move(message), std::move(stored)});
+}
+
+void StorageExecutor::enqueue(Task task) {
+    static Gauge &queueDepth = Metrics::instance().gauge("timp_storage_queue_depth", "database requests waiting");
+
+    task.enqueuedNs = clock.nsecsElapsed();
+    queue.push(std::move(task));
+    queueDepth.set(depth.fetch_add(1, std::memory_order_relaxed) + 1);
+    wake();
+}
+
+void StorageExecutor::wake() {
+    // sequentially consistent against timedWaiting: either this sees the waiter or the waiter sees the new count
+    pending.fetch_add(1);
+    pending.notify_one();
+    if (timedWaiting.load()) {
+        QMutexLocker locker(&wakeMutex);
+        wakeCondition.wakeOne();
+    }
+}
+
+void StorageExecutor::waitFor(const quint32 seen, const qint64 timeoutNs) {
+    QMutexLocker locker(&wakeMutex);
+    timedWaiting.store(true);
+    const QDeadlineTimer deadline(std::chrono::nanoseconds(timeoutNs), Qt::PreciseTimer);
+    while (pending.load() == seen && !deadline.hasExpired()) {
+        wakeCondition.wait(&wakeMutex, deadline);
+    }
+    timedWaiting.store(false);
+}
+
+void StorageExecutor::run() {
+    static Histogram &waitTime = Metrics::instance().histogram("timp_storage_wait_us",
+                                                               "time a database request spends queued, microseconds");
+    static Gauge &queueDepth = Metrics::instance().gauge("timp_storage_queue_depth", "database requests waiting");
+    const qint64 windowNs = std::chrono::nanoseconds(policy.window).count();
+
+    qCInfo(lcDatabase) << "storage thread started";
+    while (true) {
+        const quint32 seen = pending.load(std::memory_order_acquire);
+        while (std::optional<Task> task = queue.pop()) {
+            queueDepth.set(depth.fetch_sub(1, std::memory_order_relaxed) - 1);
+            waitTime.record((clock.nsecsElapsed() - task->enqueuedNs) / 1000);
+
+            if (task->message) {
+                if (batch.isEmpty()) {
+                    batchStartedNs = task->enqueuedNs;
+                }
+                batch.append(std::move(*task->message));
+                batchStored.append(std::move(task->stored));
+                if (batch.size() >= policy.maxBatch) {
+                    flushBatch();
+                }
+                continue;
+            }
+
+            // keep FIFO order visible: reads and other writes come after the messages queued before them
+            flushBatch();
+            task->job();
+        }
+
+        if (!batch.isEmpty()) {
+            // an open batch waits out the rest of its window for company, then commits; any new request
+            // ends the wait early: a message joins the batch, anything else commits it first
+            const qint64 remainingNs = windowNs - (clock.nsecsElapsed() - batchStartedNs);
+            if (remainingNs > 0 && running.load(std::memory_order_acquire)) {
+                waitFor(seen, remainingNs);
+                continue;
+            }
+            flushBatch();
+        }
+
+        if (!running.load(std::memory_order_acquire)) {
+            break;
+        }
+        pending.wait(seen, std::memory_order_acquire);
+    }
+    qCInfo(lcDatabase) << "storage thread stopped";
+}
+
+void StorageExecutor::flushBatch() {
+    if (batch.isEmpty()) return;
+
+    bool saved;
+    {
+        ScopedTimer timer(*commitTime);
+        saved = Database::saveMessages(batch);
+    }
+    batchSize->record(batch.size());
+
+    if (saved) {
+        // appended here, in commit order, so every room's cache stays sorted by id
+        for (const Database::NewMessage &message: batch) {
+            HistoryCache::instance().append(message.room, {message.id, message.sender, message.content,
+                                                           message.timestamp});
+        }
+    }
+
+    for (qsizetype i = 0; i < batch.size(); ++i) {
+        if (batchStored[i]) {
+            batchStored[i](saved ? batch[i].id : -1);
+        }
+    }
+    batch.clear();
+    batchStored.clear();
+}
@@ -0,0 +1,162 @@
+#ifndef STORAGE_EXECUTOR_H
+#define STORAGE_EXECUTOR_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+#include "commit_policy.h"
+#include "database.h"
+#include "util/caller_thread.h"
+#include "util/mpsc_queue.h"
+
+class Histogram;
+
+/**
+ * @brief Класс StorageExecutor — отдельный поток, через который идут все запросы к БД.
+ *
+ * Сетевые потоки никогда не ждут диск: они кладут задание в неблокирующую
+ * очередь (MpscQueue) и продолжают обслуживать клиентов. Поток хранилища
+ * выполняет задания по одному в порядке поступления, поэтому, например,
+ * сообщения одного клиента сохраняются и рассылаются в том порядке, в каком
+ * пришли. Результат возвращается в цикл событий вызвавшего потока.
+ *
+ * Все записи в БД после Database::init() должны выполняться здесь: поток
+ * хранилища — единственный писатель. Чистые чтения могут идти через ReadPool
+ * и тогда не стоят в этой очереди.
+ *
+ * Сообщения чата (appendMessage/submitMessage) не пишутся по одному: они
+ * копятся в пакет и фиксируются одной транзакцией по GroupCommitPolicy.
+ * Любое другое задание сначала фиксирует накопленный пакет, поэтому чтение
+ * истории видит все сообщения, поставленные в очередь раньше него.
+ */
+class StorageExecutor {
+public:
+    /**
+     * @brief Возвращает единственный экземпляр.
+     */
+    static StorageExecutor &instance();
+
+    /**
+     * @brief Запускает поток хранилища.
+     * @param policy Окно и размер пакета для сообщений чата.
+     */
+    void start(const GroupCommitPolicy &policy = {});
+
+    /**
+     * @brief Выполняет оставшиеся задания и останавливает поток.
+     *
+     * Продолжения после этого уже не вызываются: циклы событий к этому моменту остановлены.
+     */
+    void stop();
+
+    /**
+     * @brief Ставит задание без результата (например, пометку сообщения).
+     * @param job Функция, выполняемая в потоке хранилища.
+     */
+    void post(std::function<void()> job);
+
+    /**
+     * @brief Выполняет job в потоке хранилища и передаёт результат в completion.
+     *
+     * completion вызывается в потоке, который вызвал submit(), и только если
+     * context к тому моменту ещё существует (например, клиент не отключился).
+     * @param context Объект, с жизнью которого связано продолжение.
+     * @param job Функция без аргументов, выполняемая в потоке хранилища.
+     * @param completion Функция, принимающая результат job.
+     */
+    template<typename Job, typename Completion>
+    void submit(QObject *context, Job job, Completion completion) {
+        using Result = std::invoke_result_t<Job &>;
+
+        // both the guard and the sink are created here, on the caller's thread, and only used there
+        QPointer<QObject> guard(context);
+        QObject *sink = CallerThread::sink();
+        post([guard, sink, job = std::move(job), completion = std::move(completion)]() mutable {
+            CallerThread::complete(guard, sink, std::move(completion), job());
+        });
+    }
+
+    /**
+     * @brief Добавляет сообщение в текущий пакет группового сохранения.
+     * @param message Сообщение.
+     * @param stored Вызывается в потоке хранилища после фиксации пакета с id
+     *               сообщения или после его отката с -1; может быть пустым.
+     */
+    void appendMessage(Database::NewMessage message, std::function<void(qint64)> stored = {});
+
+    /**
+     * @brief Как appendMessage(), но результат фиксации передаётся в completion в потоке вызывающего.
+     * @param context Объект, с жизнью которого связано продолжение.
+     * @param message Сообщение.
+     * @param completion Функция, принимающая id сохранённого сообщения или -1, если пакет откатился.
+     */
+    template<typename Completion>
+    void submitMessage(QObject *context, Database::NewMessage message, Completion completion) {
+        QPointer<QObject> guard(context);
+        QObject *sink = CallerThread::sink();
+        appendMessage(std::move(message), [guard, sink, completion = std::move(completion)](const qint64 id) {
+            CallerThread::complete(guard, sink, completion, id);
+        });
+    }
+
+    /// Удаляем копирование
+    StorageExecutor(const StorageExecutor &) = delete;
+    /// Удаляем присваивание
+    StorageExecutor &operator=(const StorageExecutor &) = delete;
+
+private:
+    StorageExecutor() = default;
+
+    /// Задание вместе с моментом постановки в очередь (для метрики ожидания)
+    struct Task {
+        std::function<void()> job;
+        qint64 enqueuedNs = 0;
+        std::optional<Database::NewMessage> message; ///< Задано — это сообщение для пакета, а не job
+        std::function<void(qint64)> stored;          ///< Уведомление о фиксации сообщения
+    };
+
+    void run();
+
+    void enqueue(Task task);
+
+    /// Увеличивает pending и будит поток хранилища, как бы он ни ждал
+    void wake();
+
+    /**
+     * @brief Ждёт новых заданий не дольше timeoutNs.
+     * @param seen Значение pending, при котором новых заданий нет.
+     */
+    void waitFor(quint32 seen, qint64 timeoutNs);
+
+    /// Фиксирует накопленный пакет сообщений одной транзакцией
+    void flushBatch();
+
+    MpscQueue<Task> queue;                  ///< Задания от сетевых потоков
+    std::atomic<quint32> pending{0};        ///< Счётчик для ожидания (atomic wait/notify)
+    std::atomic<qint64> depth{0};           ///< Число заданий в очереди
+    std::atomic<bool> running{false};
+    std::atomic<bool> timedWaiting{false};  ///< Поток хранилища ждёт в waitFor()
+    QMutex wakeMutex;                       ///< Для ожидания с таймаутом, которого нет у atomic wait
+    QWaitCondition wakeCondition;
+    QThread *thread = nullptr;
+    QElapsedTimer clock;                    ///< Общие часы для времени ожидания
+
+    // only touched by the storage thread
+    GroupCommitPolicy policy;
+    QList<Database::NewMessage> batch;              ///< Сообщения, ждущие фиксации
+    QList<std::function<void(qint64)>> batchStored; ///< Уведомления для сообщений batch
+    qint64 batchStartedNs = 0;                      ///< Когда в пустой пакет пришло первое сообщение
+    Histogram *commitTime = nullptr;                ///< timp_commit_duration_us{durability="..."}
+    Histogram *batchSize = nullptr;                 ///< timp_commit_batch_size{durability="..."}
+};
+
+#endif // STORAGE_EXECUTOR_H
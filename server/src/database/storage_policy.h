@@ -0,0 +1,29 @@
+#ifndef STORAGE_POLICY_H
+#define STORAGE_POLICY_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Где хранятся пользователи и сообщения.
+ */
+enum class StorageBackend {
+    Sqlite, ///< Файл SQLite (SqliteStore)
+    Memory  ///< Только память процесса (MemoryStore): всё теряется при остановке
+};
+
+/**
+ * @brief Параметры хранилища за Database.
+ *
+ * Бэкенд Memory убирает диск из пути сообщения целиком — например, чтобы
+ * измерить пропускную способность сети и рассылки без SQLite. Эфемерные
+ * комнаты держатся в памяти и при бэкенде SQLite: их сообщения не попадают
+ * ни в файл, ни в архив, ни в полнотекстовый поиск.
+ */
+struct StoragePolicy {
+    StorageBackend backend = StorageBackend::Sqlite; ///< Основное хранилище
+    QStringList ephemeralRooms;                      ///< Комнаты, сообщения которых живут только в памяти
+    qsizetype memoryRoomLimit = 10000;               ///< Сколько последних сообщений комнаты хранит память (0 — без ограничения)
+};
+
+#endif // STORAGE_POLICY_H
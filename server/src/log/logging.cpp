@@ -0,0 +1,172 @@
+#include "logging.h"
+
+#include <QDateTime>
+#include <QThread>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "util/mpsc_queue.h"
+
+Q_LOGGING_CATEGORY(lcServer, "timp.server")
+Q_LOGGING_CATEGORY(lcNet, "timp.net", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcCommand, "timp.command", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcDatabase, "timp.db", QtInfoMsg)
+
+namespace {
+    /// Окно ограничения частоты для одной категории
+    struct RateBucket {
+        const char *category;
+        std::atomic<qint64> second{0};
+        std::atomic<int> count{0};
+        std::atomic<int> suppressed{0};
+    };
+
+    // fixed table, so the handler never needs a lock to find its bucket; the last one catches the rest
+    RateBucket buckets[] = {{"timp.server"}, {"timp.net"}, {"timp.command"}, {"timp.db"}, {nullptr}};
+
+    /// Состояние асинхронного журнала
+    struct LogState {
+        MpscQueue<QByteArray> queue;
+        std::atomic<quint32> pending{0};
+        std::atomic<bool> running{true};
+        QThread *writer = nullptr;
+        FILE *out = stderr;
+        int rateLimit = 200;
+    };
+
+    LogState *state = nullptr;
+
+    RateBucket &bucketFor(const char *category) {
+        for (RateBucket &bucket: buckets) {
+            if (!bucket.category || (category && std::strcmp(bucket.category, category) == 0)) {
+                return bucket;
+            }
+        }
+        return buckets[std::size(buckets) - 1];
+    }
+
+    const char *levelName(const QtMsgType type) {
+        switch (type) {
+            case QtDebugMsg: return "D";
+            case QtInfoMsg: return "I";
+            case QtWarningMsg: return "W";
+            case QtCriticalMsg: return "C";
+            case QtFatalMsg: return "F";
+        }
+        return "?";
+    }
+
+    QByteArray formatLine(const QtMsgType type, const char *category, const QString &message) {
+        return QDateTime::currentDateTime().toString(Qt::ISODateWithMs).toUtf8()
+               + ' ' + levelName(type) + ' ' + (category ? category : "default") + ": "
+               + message.toUtf8() + '\n';
+    }
+
+    void enqueue(QByteArray line) {
+        state->queue.push(std::move(line));
+        state->pending.fetch_add(1, std::memory_order_release);
+        state->pending.notify_one();
+    }
+
+    bool admit(RateBucket &bucket) {
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        qint64 second = bucket.second.load(std::memory_order_relaxed);
+        if (second != now && bucket.second.compare_exchange_strong(second, now, std::memory_order_relaxed)) {
+            bucket.count.store(0, std::memory_order_relaxed);
+            if (const int dropped = bucket.suppressed.exchange(0, std::memory_order_relaxed); dropped > 0) {
+                enqueue(formatLine(QtWarningMsg, bucket.category,
+                                   QString("%1 messages suppressed by rate limit").arg(dropped)));
+            }
+        }
+
+        if (bucket.count.fetch_add(1, std::memory_order_relaxed) < state->rateLimit) {
+            return true;
+        }
+        bucket.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void messageHandler(const QtMsgType type, const QMessageLogContext &context, const QString &message) {
+        if (type == QtFatalMsg) {
+            // qt aborts right after the handler returns, so this one cannot wait for the writer
+            const QByteArray line = formatLine(type, context.category, message);
+            std::fwrite(line.constData(), 1, line.size(), state->out);
+            std::fflush(state->out);
+            return;
+        }
+
+        if ((type == QtDebugMsg || type == QtInfoMsg) && !admit(bucketFor(context.category))) {
+            return;
+        }
+
+        enqueue(formatLine(type, context.category, message));
+    }
+
+    void writerLoop() {
+        while (true) {
+            const quint32 seen = state->pending.load(std::memory_order_acquire);
+            while (std::optional<QByteArray> line = state->queue.pop()) {
+                std::fwrite(line->constData(), 1, line->size(), state->out);
+            }
+            std::fflush(state->out);
+
+            if (!state->running.load(std::memory_order_acquire)) {
+                break;
+            }
+            state->pending.wait(seen, std::memory_order_acquire);
+        }
+    }
+}
+
+void Logging::install(const LogConfig &config) {
+    if (state) return;
+
+    state = new LogState;
+    state->rateLimit = config.rateLimitPerSecond;
+    if (!config.filePath.isEmpty()) {
+        if (FILE *file = std::fopen(config.filePath.toLocal8Bit().constData(), "a")) {
+            state->out = file;
+        }
+    }
+
+    QString rules;
+    rules += QString("timp.*.debug=%1\n").arg(config.minLevel == QtDebugMsg ? "true" : "false");
+    rules += QString("timp.*.info=%1\n").arg(config.minLevel == QtDebugMsg || config.minLevel == QtInfoMsg
+                                                 ? "true" : "false");
+    rules += QString("timp.*.warning=%1\n").arg(config.minLevel == QtCriticalMsg ? "false" : "true");
+    QLoggingCategory::setFilterRules(rules);
+
+    state->writer = QThread::create(writerLoop);
+    state->writer->setObjectName("log-writer");
+    state->writer->start(QThread::LowPriority);
+
+    qInstallMessageHandler(messageHandler);
+}
+
+void Logging::shutdown() {
+    if (!state) return;
+
+    qInstallMessageHandler(nullptr);
+
+    state->running.store(false, std::memory_order_release);
+    state->pending.fetch_add(1, std::memory_order_release);
+    state->pending.notify_one();
+    state->writer->wait();
+    delete state->writer;
+
+    if (state->out != stderr) {
+        std::fclose(state->out);
+    }
+    delete state;
+    state = nullptr;
+}
+
+QtMsgType Logging::levelFromString(const QString &name, const QtMsgType fallback) {
+    if (name == "debug") return QtDebugMsg;
+    if (name == "info") return QtInfoMsg;
+    if (name == "warning") return QtWarningMsg;
+    if (name == "critical") return QtCriticalMsg;
+    return fallback;
+}
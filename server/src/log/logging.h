@@ -0,0 +1,57 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+#include <QString>
+
+/// Жизненный цикл сервера: запуск, остановка, ошибки конфигурации
+Q_DECLARE_LOGGING_CATEGORY(lcServer)
+/// Сетевой трафик: содержимое входящих и исходящих кадров (по умолчанию выключено)
+Q_DECLARE_LOGGING_CATEGORY(lcNet)
+/// Выполнение команд клиентов
+Q_DECLARE_LOGGING_CATEGORY(lcCommand)
+/// Запросы к базе данных
+Q_DECLARE_LOGGING_CATEGORY(lcDatabase)
+
+/**
+ * @brief Параметры журналирования.
+ */
+struct LogConfig {
+    QtMsgType minLevel = QtInfoMsg;  ///< Минимальный уровень, включаемый во время работы
+    QString filePath;                ///< Файл журнала; пустая строка — stderr
+    int rateLimitPerSecond = 200;    ///< Сколько debug/info-записей одной категории пропускается в секунду
+};
+
+/**
+ * @brief Класс Logging — асинхронный журнал сервера поверх QLoggingCategory.
+ *
+ * - Уровни отсекаются на этапе компиляции (TIMP_LOG_LEVEL в CMake задаёт
+ *   QT_NO_DEBUG_OUTPUT / QT_NO_INFO_OUTPUT) и во время работы (правила категорий):
+ *   qCDebug() не вычисляет аргументы, если уровень выключен.
+ * - Обработчик сообщений только кладёт готовую строку в неблокирующую очередь,
+ *   запись в файл или stderr выполняет отдельный поток.
+ * - debug/info-записи каждой категории ограничены rateLimitPerSecond в секунду,
+ *   число пропущенных записей выводится при смене секунды.
+ */
+class Logging {
+public:
+    /**
+     * @brief Устанавливает обработчик сообщений Qt и запускает поток записи.
+     * @param config Параметры журналирования.
+     */
+    static void install(const LogConfig &config);
+
+    /**
+     * @brief Дописывает оставшиеся записи и останавливает поток записи.
+     */
+    static void shutdown();
+
+    /**
+     * @brief Разбирает имя уровня (debug, info, warning, critical).
+     * @param name Имя уровня.
+     * @param fallback Значение для неизвестного имени.
+     */
+    static QtMsgType levelFromString(const QString &name, QtMsgType fallback = QtInfoMsg);
+};
+
+#endif // LOGGING_H
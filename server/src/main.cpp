@@ -1,21 +1,211 @@
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTimer>
 
+#include <optional>
+
+#include "auth/auth_pool.h"
 #include "database/database.h"
+#include "database/history_cache.h"
+#include "database/message_archive.h"
+#include "database/read_pool.h"
+#include "database/storage_executor.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
+#include "metrics/metrics_http_server.h"
+#include "server/client_connection.h"
 #include "server/server.h"
 
+/**
+ * @brief Заполняет ServerConfig и LogConfig из аргументов командной строки.
+ * @return nullopt, если значение параметра не распознано (ошибка уже выведена).
+ */
+static std::optional<ServerConfig> parseConfig(const QCoreApplication &app, LogConfig &logConfig) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("timp chat server");
+    parser.addHelpOption();
+
+    const QCommandLineOption portOption("port", "port to listen on", "port", "1234");
+    const QCommandLineOption databaseOption("database", "path to sqlite database", "path", "database.sqlite");
+    const QCommandLineOption storageOption("storage", "sqlite | memory (nothing is written to disk)", "backend",
+                                           "sqlite");
+    const QCommandLineOption ephemeralRoomOption("ephemeral-room", "room kept in memory only (repeatable)", "room");
+    const QCommandLineOption memoryRoomLimitOption("memory-room-limit", "messages kept per in-memory room "
+                                                   "(0 = unlimited)", "count", "10000");
+    const QCommandLineOption workersOption("workers", "number of worker threads (0 = main thread only)", "count", "0");
+    const QCommandLineOption dispatchOption("dispatch", "connection dispatch policy: round-robin | least-loaded",
+                                           "policy", "round-robin");
+    const QCommandLineOption queueLowOption("send-queue-low", "per-client send queue low watermark, KiB", "kib", "64");
+    const QCommandLineOption queueHighOption("send-queue-high", "per-client send queue high watermark, KiB", "kib", "1024");
+    const QCommandLineOption queueLimitOption("send-queue-limit", "per-client send queue eviction limit, KiB", "kib", "4096");
+    const QCommandLineOption latencyOption("write-latency-us",
+                                           "how long an outgoing frame may wait to be coalesced, microseconds",
+                                           "us", "0");
+    const QCommandLineOption maxFrameOption("max-frame", "maximum incoming frame size, KiB", "kib", "1024");
+    const QCommandLineOption durabilityOption("durability",
+                                              "strict: broadcast after the message is on disk | relaxed: broadcast at once",
+                                              "mode", "strict");
+    const QCommandLineOption commitWindowOption("commit-window-us", "how long messages are collected into one commit, "
+                                                "microseconds", "us", "2000");
+    const QCommandLineOption commitBatchOption("commit-batch", "maximum messages per commit", "count", "256");
+    const QCommandLineOption readersOption("db-readers", "read-only database connections for history, search and "
+                                           "login (0 = reads share the storage thread)", "count", "2");
+    const QCommandLineOption historyCacheOption("history-cache", "recent messages kept in memory per room (0 = disabled)",
+                                                "count", "200");
+    const QCommandLineOption historyRoomsOption("history-cache-rooms", "rooms kept in the history cache, least "
+                                                "recently written are dropped first (0 = unlimited)", "count", "1024");
+    const QCommandLineOption pbkdf2Option("pbkdf2-iterations", "PBKDF2 work factor for new and upgraded passwords",
+                                          "count", "100000");
+    const QCommandLineOption authThreadsOption("auth-threads", "password hashing threads", "count", "2");
+    const QCommandLineOption authQueueOption("auth-queue", "password hashing jobs allowed in flight before "
+                                             "logins are refused", "count", "64");
+    const QCommandLineOption retentionOption("retention-days", "move messages older than this to archive segments "
+                                             "(0 = keep everything in the table)", "days", "0");
+    const QCommandLineOption archiveDirOption("archive-dir", "directory for archive segment files", "path", "archive");
+    const QCommandLineOption sessionTtlOption("session-ttl", "lifetime of a session resume token", "seconds", "86400");
+    const QCommandLineOption resumeGraceOption("resume-grace", "how long a dropped user may resume before their leave "
+                                               "is announced", "seconds", "30");
+    const QCommandLineOption logLevelOption("log-level", "debug | info | warning | critical", "level", "info");
+    const QCommandLineOption logFileOption("log-file", "write the log to a file instead of stderr", "path");
+    const QCommandLineOption logRateOption("log-rate", "max debug/info records per category per second", "count", "200");
+    const QCommandLineOption metricsPortOption("metrics-port", "local port for Prometheus metrics (0 = disabled)",
+                                               "port", "9464");
+    const QCommandLineOption adminOption("admin", "user allowed to run the stats command (repeatable)", "username");
+    parser.addOptions({portOption, databaseOption, storageOption, ephemeralRoomOption, memoryRoomLimitOption,
+                       workersOption, dispatchOption,
+                       queueLowOption, queueHighOption, queueLimitOption, latencyOption, maxFrameOption,
+                       durabilityOption, commitWindowOption, commitBatchOption, readersOption, historyCacheOption,
+                       historyRoomsOption, pbkdf2Option, authThreadsOption, authQueueOption, sessionTtlOption, resumeGraceOption,
+                       retentionOption, archiveDirOption,
+                       logLevelOption, logFileOption, logRateOption, metricsPortOption, adminOption});
+    parser.process(app);
+
+    ServerConfig config;
+    config.port = parser.value(portOption).toUShort();
+    config.databasePath = parser.value(databaseOption);
+    if (const QString storage = parser.value(storageOption); storage == "memory") {
+        config.storage.backend = StorageBackend::Memory;
+    } else if (storage != "sqlite") {
+        qCritical().noquote() << "unknown --storage value:" << storage << "(expected sqlite or memory)";
+        return std::nullopt;
+    }
+    config.storage.ephemeralRooms = parser.values(ephemeralRoomOption);
+    config.storage.memoryRoomLimit = parser.value(memoryRoomLimitOption).toLongLong();
+    config.workerThreads = parser.value(workersOption).toInt();
+    if (const QString dispatch = parser.value(dispatchOption); dispatch == "least-loaded") {
+        config.dispatchPolicy = DispatchPolicy::LeastLoaded;
+    } else if (dispatch != "round-robin") {
+        qCritical().noquote() << "unknown --dispatch value:" << dispatch << "(expected round-robin | least-loaded)";
+        return std::nullopt;
+    }
+    config.sendQueue.lowWatermark = parser.value(queueLowOption).toLongLong() * 1024;
+    config.sendQueue.highWatermark = parser.value(queueHighOption).toLongLong() * 1024;
+    config.sendQueue.hardLimit = parser.value(queueLimitOption).toLongLong() * 1024;
+    config.writeLatencyBudget = std::chrono::microseconds(parser.value(latencyOption).toLongLong());
+    // a larger frame could not be echoed back in CBOR anyway
+    config.maxFrameSize = qMin(parser.value(maxFrameOption).toLongLong() * 1024, OutboundFrame::MaxCborFrameSize);
+    // a typo must not quietly pick the slower mode
+    if (const QString durability = parser.value(durabilityOption); durability == "relaxed") {
+        config.groupCommit.durability = Durability::Relaxed;
+    } else if (durability != "strict") {
+        qCritical().noquote() << "unknown --durability value:" << durability << "(expected strict or relaxed)";
+        return std::nullopt;
+    }
+    config.groupCommit.window = std::chrono::microseconds(parser.value(commitWindowOption).toLongLong());
+    config.groupCommit.maxBatch = parser.value(commitBatchOption).toInt();
+    config.storageReaders = parser.value(readersOption).toInt();
+    config.historyCacheSize = parser.value(historyCacheOption).toLongLong();
+    config.historyCacheRooms = parser.value(historyRoomsOption).toLongLong();
+    config.auth.iterations = parser.value(pbkdf2Option).toInt();
+    config.auth.threads = parser.value(authThreadsOption).toInt();
+    config.auth.maxPending = parser.value(authQueueOption).toInt();
+    config.retention.maxAge = std::chrono::hours(24 * parser.value(retentionOption).toLongLong());
+    config.retention.archiveDirectory = parser.value(archiveDirOption);
+    config.sessionTtl = std::chrono::seconds(parser.value(sessionTtlOption).toLongLong());
+    config.resumeGrace = std::chrono::seconds(parser.value(resumeGraceOption).toLongLong());
+    config.metricsPort = parser.value(metricsPortOption).toUShort();
+    config.adminUsers = parser.values(adminOption);
+
+    logConfig.minLevel = Logging::levelFromString(parser.value(logLevelOption));
+    logConfig.filePath = parser.value(logFileOption);
+    logConfig.rateLimitPerSecond = parser.value(logRateOption).toInt();
+    return config;
+}
+
 int main(int argc, char *argv[]) {
     QCoreApplication a(argc, argv);
+    LogConfig logConfig;
+    const std::optional<ServerConfig> parsed = parseConfig(a, logConfig);
+    if (!parsed) {
+        return 1;
+    }
+    const ServerConfig &config = *parsed;
+    Logging::install(logConfig);
 
-    if (!Database::instance().init()) {
-        qDebug() << "database initialization failed";
+    if (!Database::instance().init(config.databasePath, config.groupCommit.durability, config.storage)) {
+        qCCritical(lcServer) << "database initialization failed";
+        Logging::shutdown();
         return 1;
     }
+    // the archive is made of SQLite rows; a memory-only server has nothing to archive
+    const bool persistent = config.storage.backend == StorageBackend::Sqlite;
+    if (persistent && !MessageArchive::instance().open(config.retention.archiveDirectory)) {
+        qCCritical(lcServer) << "archive initialization failed";
+        Logging::shutdown();
+        return 1;
+    }
+    HistoryCache::instance().warm(config.historyCacheSize, config.historyCacheRooms);
+    // from here on the database is written only from the storage thread and read from the read pool
+    StorageExecutor::instance().start(config.groupCommit);
+    ReadPool::instance().start(config.storageReaders);
+    AuthPool::instance().start(config.auth);
 
     // ReSharper disable once CppTooWideScopeInitStatement
-    const Server server;
-    if (!server.startServer(1234)) {
+    Server server(config);
+    if (!server.startServer(config.port)) {
+        AuthPool::instance().stop();
+        ReadPool::instance().stop();
+        StorageExecutor::instance().stop();
+        Logging::shutdown();
         return 1;
     }
 
-    return QCoreApplication::exec();
+    // queue totals are cheaper to read on demand than to mirror on every enqueue
+    Metrics::instance().addCollector([] {
+        static Gauge &queued = Metrics::instance().gauge("timp_send_queue_bytes", "bytes waiting in client send queues");
+        static Counter &dropped = Metrics::instance().counter("timp_send_queue_dropped_frames_total",
+                                                              "low priority frames dropped for slow clients");
+        static Counter &evictions = Metrics::instance().counter("timp_send_queue_evictions_total",
+                                                                "slow clients disconnected");
+        const ClientConnection::Stats stats = ClientConnection::stats();
+        queued.set(stats.queuedBytes);
+        dropped.raiseTo(stats.droppedFrames);
+        evictions.raiseTo(stats.evictions);
+    });
+
+    // retention runs on the storage thread like every other database job, one segment per job
+    QTimer retentionTimer;
+    if (persistent && config.retention.maxAge.count() > 0) {
+        const RetentionPolicy retention = config.retention;
+        auto archiveExpired = [retention] {
+            StorageExecutor::instance().post([retention] { MessageArchive::instance().archiveExpired(retention); });
+        };
+        QObject::connect(&retentionTimer, &QTimer::timeout, archiveExpired);
+        retentionTimer.start(retention.interval);
+        archiveExpired();
+    }
+
+    // a busy metrics port must not keep the chat server down
+    MetricsHttpServer metricsServer;
+    if (config.metricsPort != 0) {
+        metricsServer.start(config.metricsPort);
+    }
+
+    const int result = QCoreApplication::exec();
+    // drain pending writes while the workers still exist
+    AuthPool::instance().stop();
+    ReadPool::instance().stop();
+    StorageExecutor::instance().stop();
+    Logging::shutdown();
+    return result;
 }
@@ -0,0 +1,217 @@
+#include "metrics.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <bit>
+
+using namespace Qt::StringLiterals;
+
+void Counter::raiseTo(const quint64 total) {
+    quint64 current = value_.load(std::memory_order_relaxed);
+    while (total > current && !value_.compare_exchange_weak(current, total, std::memory_order_relaxed)) {
+    }
+}
+
+int Histogram::bucketIndex(const quint64 value) {
+    if (value < 32) {
+        return static_cast<int>(value);
+    }
+
+    // 16 sub-buckets per power of two: keep the top five bits of the value
+    const int shift = std::bit_width(value) - 5;
+    return shift * 16 + static_cast<int>(value >> shift);
+}
+
+quint64 Histogram::bucketUpperBound(const int index) {
+    if (index < 32) {
+        return index;
+    }
+
+    const int shift = index / 16 - 1;
+    const quint64 top = index % 16 + 16;
+    return ((top + 1) << shift) - 1;
+}
+
+void Histogram::record(const quint64 value) {
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    quint64 currentMax = max_.load(std::memory_order_relaxed);
+    while (value > currentMax && !max_.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+quint64 Histogram::percentile(const double q) const {
+    const quint64 total = count();
+    if (total == 0) return 0;
+
+    const auto rank = static_cast<quint64>(q * static_cast<double>(total - 1)) + 1;
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+Metrics &Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+void *Metrics::find(const Kind kind, const QString &name, const QString &labels) const {
+    for (const Entry &entry: entries) {
+        if (entry.kind == kind && entry.name == name && entry.labels == labels) {
+            return entry.metric;
+        }
+    }
+    return nullptr;
+}
+
+Counter &Metrics::counter(const QString &name, const QString &help, const QString &labels) {
+    QMutexLocker locker(&mutex);
+    if (void *existing = find(Kind::Counter, name, labels)) {
+        return *static_cast<Counter *>(existing);
+    }
+    Counter &metric = counters.emplace_back();
+    entries.append({Kind::Counter, name, help, labels, &metric});
+    return metric;
+}
+
+Gauge &Metrics::gauge(const QString &name, const QString &help, const QString &labels) {
+    QMutexLocker locker(&mutex);
+    if (void *existing = find(Kind::Gauge, name, labels)) {
+        return *static_cast<Gauge *>(existing);
+    }
+    Gauge &metric = gauges.emplace_back();
+    entries.append({Kind::Gauge, name, help, labels, &metric});
+    return metric;
+}
+
+Histogram &Metrics::histogram(const QString &name, const QString &help, const QString &labels) {
+    QMutexLocker locker(&mutex);
+    if (void *existing = find(Kind::Histogram, name, labels)) {
+        return *static_cast<Histogram *>(existing);
+    }
+    Histogram &metric = histograms.emplace_back();
+    entries.append({Kind::Histogram, name, help, labels, &metric});
+    return metric;
+}
+
+QString Metrics::label(const QString &key, const QString &value) {
+    QString escaped = value;
+    escaped.replace('\\', "\\\\"_L1).replace('"', "\\\""_L1).replace('\n', "\\n"_L1);
+    return key + "=\"" + escaped + '"';
+}
+
+void Metrics::addCollector(std::function<void()> collector) {
+    QMutexLocker locker(&mutex);
+    collectors.append(std::move(collector));
+}
+
+void Metrics::collect() {
+    QList<std::function<void()>> snapshot;
+    {
+        QMutexLocker locker(&mutex);
+        snapshot = collectors;
+    }
+    for (const auto &collector: snapshot) {
+        collector();
+    }
+}
+
+QByteArray Metrics::prometheusText() {
+    collect();
+
+    static constexpr double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    QMutexLocker locker(&mutex);
+
+    // series registered later (per query, per command...) are pulled up next to the first one of their name
+    QHash<QString, qsizetype> firstSeen;
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        if (!firstSeen.contains(entries[i].name)) {
+            firstSeen.insert(entries[i].name, i);
+        }
+    }
+    QList<const Entry *> ordered;
+    ordered.reserve(entries.size());
+    for (const Entry &entry: entries) {
+        ordered.append(&entry);
+    }
+    std::ranges::stable_sort(ordered, {}, [&firstSeen](const Entry *entry) { return firstSeen.value(entry->name); });
+
+    QByteArray out;
+    QString lastName;
+    for (const Entry *next: ordered) {
+        const Entry &entry = *next;
+        const QByteArray name = entry.name.toUtf8();
+        const QByteArray labels = entry.labels.toUtf8();
+        const QByteArray series = labels.isEmpty() ? name : name + '{' + labels + '}';
+
+        if (entry.name != lastName) {
+            const char *type = entry.kind == Kind::Counter ? "counter"
+                             : entry.kind == Kind::Gauge ? "gauge" : "summary";
+            out += "# HELP " + name + ' ' + entry.help.toUtf8() + '\n';
+            out += "# TYPE " + name + ' ' + type + '\n';
+            lastName = entry.name;
+        }
+
+        switch (entry.kind) {
+            case Kind::Counter:
+                out += series + ' ' + QByteArray::number(static_cast<Counter *>(entry.metric)->value()) + '\n';
+                break;
+            case Kind::Gauge:
+                out += series + ' ' + QByteArray::number(static_cast<Gauge *>(entry.metric)->value()) + '\n';
+                break;
+            case Kind::Histogram: {
+                const auto *histogram = static_cast<Histogram *>(entry.metric);
+                const QByteArray prefix = labels.isEmpty() ? QByteArray() : labels + ',';
+                for (const double q: quantiles) {
+                    out += name + "{" + prefix + "quantile=\"" + QByteArray::number(q) + "\"} "
+                            + QByteArray::number(histogram->percentile(q)) + '\n';
+                }
+                const QByteArray suffix = labels.isEmpty() ? QByteArray() : '{' + labels + '}';
+                out += name + "_sum" + suffix + ' ' + QByteArray::number(histogram->sum()) + '\n';
+                out += name + "_count" + suffix + ' ' + QByteArray::number(histogram->count()) + '\n';
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+QJsonObject Metrics::toJson() {
+    collect();
+
+    QMutexLocker locker(&mutex);
+    QJsonObject out;
+    for (const Entry &entry: entries) {
+        const QString series = entry.labels.isEmpty() ? entry.name : entry.name + '{' + entry.labels + '}';
+
+        switch (entry.kind) {
+            case Kind::Counter:
+                out[series] = static_cast<qint64>(static_cast<Counter *>(entry.metric)->value());
+                break;
+            case Kind::Gauge:
+                out[series] = static_cast<Gauge *>(entry.metric)->value();
+                break;
+            case Kind::Histogram: {
+                const auto *histogram = static_cast<Histogram *>(entry.metric);
+                QJsonObject summary;
+                summary["count"] = static_cast<qint64>(histogram->count());
+                summary["p50"] = static_cast<qint64>(histogram->percentile(0.5));
+                summary["p99"] = static_cast<qint64>(histogram->percentile(0.99));
+                summary["p999"] = static_cast<qint64>(histogram->percentile(0.999));
+                summary["max"] = static_cast<qint64>(histogram->max());
+                out[series] = summary;
+                break;
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,196 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+/**
+ * @brief Монотонно растущий счётчик.
+ */
+class Counter {
+public:
+    /// Увеличивает счётчик на n
+    void add(quint64 n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+    /// Поднимает счётчик до total, если он меньше (для итогов, которые ведутся в другом месте)
+    void raiseTo(quint64 total);
+
+    /// Текущее значение
+    [[nodiscard]] quint64 value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> value_{0};
+};
+
+/**
+ * @brief Значение, которое может как расти, так и уменьшаться.
+ */
+class Gauge {
+public:
+    /// Устанавливает значение
+    void set(qint64 v) { value_.store(v, std::memory_order_relaxed); }
+
+    /// Прибавляет delta (может быть отрицательным)
+    void add(qint64 delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+
+    /// Текущее значение
+    [[nodiscard]] qint64 value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> value_{0};
+};
+
+/**
+ * @brief Гистограмма в стиле HDR с логарифмически-линейными корзинами.
+ *
+ * Значения до 32 хранятся точно, дальше каждая степень двойки делится на 16
+ * корзин, то есть относительная погрешность квантилей не превышает ~6%.
+ * Запись — один atomic fetch_add без блокировок.
+ */
+class Histogram {
+public:
+    /// Число корзин (покрывает весь диапазон quint64)
+    static constexpr int BucketCount = 976;
+
+    /**
+     * @brief Добавляет значение.
+     */
+    void record(quint64 value);
+
+    /**
+     * @brief Возвращает оценку квантиля.
+     * @param q Квантиль от 0 до 1.
+     * @return Верхняя граница корзины, в которую попал квантиль.
+     */
+    [[nodiscard]] quint64 percentile(double q) const;
+
+    /// Число записанных значений
+    [[nodiscard]] quint64 count() const { return count_.load(std::memory_order_relaxed); }
+
+    /// Сумма записанных значений
+    [[nodiscard]] quint64 sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    /// Максимальное записанное значение
+    [[nodiscard]] quint64 max() const { return max_.load(std::memory_order_relaxed); }
+
+private:
+    static int bucketIndex(quint64 value);
+    static quint64 bucketUpperBound(int index);
+
+    std::array<std::atomic<quint64>, BucketCount> buckets{};
+    std::atomic<quint64> count_{0};
+    std::atomic<quint64> sum_{0};
+    std::atomic<quint64> max_{0};
+};
+
+/**
+ * @brief Записывает в гистограмму время жизни объекта в микросекундах.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram &histogram) : histogram(histogram) { timer.start(); }
+    ~ScopedTimer() { histogram.record(timer.nsecsElapsed() / 1000); }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Histogram &histogram;
+    QElapsedTimer timer;
+};
+
+/**
+ * @brief Класс Metrics — реестр метрик сервера (синглтон).
+ *
+ * Метрики регистрируются один раз (обычно в static-переменной по месту
+ * использования) и живут до конца процесса, так что ссылки на них можно
+ * хранить без блокировок. Экспорт:
+ * - prometheusText() — текстовый формат Prometheus (для HTTP-слушателя)
+ * - toJson() — для административной команды stats
+ */
+class Metrics {
+public:
+    /**
+     * @brief Возвращает единственный экземпляр реестра.
+     */
+    static Metrics &instance();
+
+    /**
+     * @brief Регистрирует (или возвращает уже зарегистрированный) счётчик.
+     * @param name Имя метрики в формате Prometheus.
+     * @param help Описание метрики.
+     * @param labels Метки в виде key="value",... (значения — через label()) или пустая строка.
+     */
+    Counter &counter(const QString &name, const QString &help, const QString &labels = {});
+
+    /**
+     * @brief Регистрирует (или возвращает уже зарегистрированный) gauge.
+     */
+    Gauge &gauge(const QString &name, const QString &help, const QString &labels = {});
+
+    /**
+     * @brief Регистрирует (или возвращает уже зарегистрированную) гистограмму.
+     */
+    Histogram &histogram(const QString &name, const QString &help, const QString &labels = {});
+
+    /**
+     * @brief Собирает метку key="value", экранируя в значении \, " и перевод строки.
+     */
+    static QString label(const QString &key, const QString &value);
+
+    /**
+     * @brief Добавляет функцию, обновляющую метрики перед каждым экспортом.
+     *
+     * Нужна для значений, которые дешевле прочитать по запросу, чем
+     * поддерживать на горячем пути.
+     */
+    void addCollector(std::function<void()> collector);
+
+    /**
+     * @brief Возвращает все метрики в текстовом формате Prometheus.
+     *
+     * Серии одной метрики идут подряд под общими HELP и TYPE, даже если
+     * зарегистрированы вперемешку с другими.
+     */
+    QByteArray prometheusText();
+
+    /**
+     * @brief Возвращает все метрики в виде JSON-объекта.
+     */
+    QJsonObject toJson();
+
+private:
+    Metrics() = default;
+
+    /// Тип метрики
+    enum class Kind { Counter, Gauge, Histogram };
+
+    /// Зарегистрированная серия
+    struct Entry {
+        Kind kind;
+        QString name;
+        QString help;
+        QString labels;
+        void *metric;
+    };
+
+    void *find(Kind kind, const QString &name, const QString &labels) const;
+    void collect();
+
+    mutable QMutex mutex;                        ///< Защищает списки (но не значения метрик)
+    QList<Entry> entries;                        ///< Серии в порядке регистрации
+    std::deque<Counter> counters;                ///< Хранилища со стабильными адресами
+    std::deque<Gauge> gauges;
+    std::deque<Histogram> histograms;
+    QList<std::function<void()>> collectors;     ///< Функции обновления перед экспортом
+};
+
+#endif // METRICS_H
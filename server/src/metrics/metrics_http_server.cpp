@@ -0,0 +1,59 @@
+#include "metrics_http_server.h"
+
+#include <QTcpSocket>
+
+#include "log/logging.h"
+#include "metrics.h"
+
+namespace {
+    /// Предел размера заголовков запроса
+    constexpr qsizetype MaxRequestSize = 8 * 1024;
+
+    QByteArray httpResponse(const QByteArray &status, const QByteArray &contentType, const QByteArray &body) {
+        return "HTTP/1.1 " + status + "\r\n"
+               "Content-Type: " + contentType + "\r\n"
+               "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+               "Connection: close\r\n\r\n" + body;
+    }
+}
+
+MetricsHttpServer::MetricsHttpServer(QObject *parent) : QTcpServer(parent) {
+    connect(this, &QTcpServer::newConnection, this, &MetricsHttpServer::handleNewConnection);
+}
+
+bool MetricsHttpServer::start(const quint16 port) {
+    if (!listen(QHostAddress::LocalHost, port)) {
+        qCWarning(lcServer) << "metrics listener failed to start on port" << port << ":" << errorString();
+        return false;
+    }
+    qCInfo(lcServer) << "metrics listener started on 127.0.0.1:" << port;
+    return true;
+}
+
+void MetricsHttpServer::handleNewConnection() {
+    while (QTcpSocket *socket = nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, socket, [socket] {
+            // only the request line matters; wait until the headers are complete
+            if (socket->bytesAvailable() > MaxRequestSize) {
+                socket->abort();
+                return;
+            }
+            if (!socket->peek(MaxRequestSize).contains("\r\n\r\n")) {
+                return;
+            }
+
+            const QByteArray requestLine = socket->readLine().trimmed();
+            socket->readAll();
+
+            const QList<QByteArray> parts = requestLine.split(' ');
+            if (parts.size() >= 2 && parts[0] == "GET" && parts[1] == "/metrics") {
+                socket->write(httpResponse("200 OK", "text/plain; version=0.0.4; charset=utf-8",
+                                           Metrics::instance().prometheusText()));
+            } else {
+                socket->write(httpResponse("404 Not Found", "text/plain", "not found\n"));
+            }
+            socket->disconnectFromHost();
+        });
+    }
+}
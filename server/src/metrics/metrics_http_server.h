@@ -0,0 +1,37 @@
+#ifndef METRICS_HTTP_SERVER_H
+#define METRICS_HTTP_SERVER_H
+
+#include <QTcpServer>
+
+/**
+ * @brief Класс MetricsHttpServer — минимальный HTTP-слушатель для Prometheus.
+ *
+ * Отвечает на GET /metrics содержимым Metrics::prometheusText(), на всё
+ * остальное — 404. Слушает только локальный адрес: метрики не
+ * предназначены для клиентов чата.
+ */
+class MetricsHttpServer final : public QTcpServer {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param parent Родительский объект.
+     */
+    explicit MetricsHttpServer(QObject *parent = nullptr);
+
+    /**
+     * @brief Запускает слушатель на 127.0.0.1.
+     * @param port Порт.
+     * @return true, если порт удалось занять.
+     */
+    bool start(quint16 port);
+
+private slots:
+    /**
+     * @brief Принимает новые соединения.
+     */
+    void handleNewConnection();
+};
+
+#endif // METRICS_HTTP_SERVER_H
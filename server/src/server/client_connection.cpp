@@ -0,0 +1,160 @@
+#include "client_connection.h"
+
+#include "log/logging.h"
+
+std::atomic<qint64> ClientConnection::totalQueuedBytes{0};
+std::atomic<quint64> ClientConnection::totalDropped{0};
+std::atomic<quint64> ClientConnection::totalEvictions{0};
+std::atomic<int> ClientConnection::cborConnections{0};
+
+ClientConnection::ClientConnection(const ServerConfig &config, QObject *parent)
+    : QTcpSocket(parent), limits(config.sendQueue), reader(config.maxFrameSize),
+      latencyBudget(config.writeLatencyBudget) {
+    // bound Qt's own read buffer as well, the reader never needs more than one frame
+    setReadBufferSize(config.maxFrameSize + OutboundFrame::LengthPrefixSize + 1);
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setTimerType(Qt::PreciseTimer);
+    flushTimer.setInterval(latencyBudget);
+    connect(&flushTimer, &QChronoTimer::timeout, this, &ClientConnection::flushBatch);
+
+    // the socket drained part of its buffer: feed it the next batch right away
+    connect(this, &QTcpSocket::bytesWritten, this, &ClientConnection::flushBatch);
+}
+
+ClientConnection::~ClientConnection() {
+    totalQueuedBytes.fetch_sub(pendingBytes, std::memory_order_relaxed);
+    setWireFormat(WireFormat::Json);
+}
+
+void ClientConnection::enqueue(const QByteArray &frame, const FramePriority priority) {
+    // an empty frame is one the encoder refused as oversized
+    if (evicted || frame.isEmpty()) return;
+
+    if (!throttled && queuedBytes() + frame.size() > limits.highWatermark) {
+        qCWarning(lcNet) << "slow client" << peerAddress().toString() << "queue:" << queuedBytes();
+        throttled = true;
+        dropLowPriority();
+    }
+
+    if (throttled && priority == FramePriority::Low) {
+        totalDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    queue.append({frame, priority});
+    pendingBytes += frame.size();
+    totalQueuedBytes.fetch_add(frame.size(), std::memory_order_relaxed);
+
+    if (queuedBytes() > limits.hardLimit) {
+        evict();
+        return;
+    }
+
+    // a full batch gains nothing from waiting
+    if (pendingBytes >= limits.lowWatermark) {
+        flushBatch();
+        return;
+    }
+
+    scheduleFlush();
+}
+
+void ClientConnection::enqueue(OutboundFrame &frame, const FramePriority priority) {
+    enqueue(frame.bytes(format), priority);
+}
+
+FrameReader &ClientConnection::frameReader() {
+    return reader;
+}
+
+WireFormat ClientConnection::wireFormat() const {
+    return format;
+}
+
+void ClientConnection::setWireFormat(const WireFormat newFormat) {
+    if (format == newFormat) return;
+    cborConnections.fetch_add(newFormat == WireFormat::Cbor ? 1 : -1, std::memory_order_relaxed);
+    format = newFormat;
+}
+
+bool ClientConnection::anyCborConnections() {
+    return cborConnections.load(std::memory_order_relaxed) > 0;
+}
+
+qint64 ClientConnection::queuedBytes() const {
+    return pendingBytes + bytesToWrite();
+}
+
+ClientConnection::Stats ClientConnection::stats() {
+    return {
+        totalQueuedBytes.load(std::memory_order_relaxed),
+        totalDropped.load(std::memory_order_relaxed),
+        totalEvictions.load(std::memory_order_relaxed)
+    };
+}
+
+void ClientConnection::scheduleFlush() {
+    if (flushScheduled) return;
+    flushScheduled = true;
+
+    if (latencyBudget.count() > 0) {
+        flushTimer.start();
+        return;
+    }
+
+    // runs after the events already queued in this loop turn, so their frames join the batch
+    QMetaObject::invokeMethod(this, &ClientConnection::flushBatch, Qt::QueuedConnection);
+}
+
+void ClientConnection::flushBatch() {
+    flushScheduled = false;
+    flushTimer.stop();
+
+    // keep the socket's own (unbounded) buffer small, the rest waits in our queue
+    const qint64 room = limits.lowWatermark - bytesToWrite();
+    if (!queue.isEmpty() && room > 0) {
+        QByteArray batch;
+        if (queue.first().data.size() >= room || queue.size() == 1) {
+            // nothing to coalesce, avoid copying the frame
+            batch = queue.takeFirst().data;
+        } else {
+            batch.reserve(qMin(pendingBytes, room));
+            while (!queue.isEmpty() && batch.size() + queue.first().data.size() <= room) {
+                batch.append(queue.takeFirst().data);
+            }
+        }
+
+        pendingBytes -= batch.size();
+        totalQueuedBytes.fetch_sub(batch.size(), std::memory_order_relaxed);
+        write(batch);
+    }
+
+    if (throttled && queuedBytes() <= limits.lowWatermark) {
+        throttled = false;
+    }
+}
+
+void ClientConnection::dropLowPriority() {
+    const qsizetype before = queue.size();
+    queue.removeIf([this](const Frame &frame) {
+        if (frame.priority != FramePriority::Low) return false;
+        pendingBytes -= frame.data.size();
+        totalQueuedBytes.fetch_sub(frame.data.size(), std::memory_order_relaxed);
+        return true;
+    });
+    totalDropped.fetch_add(before - queue.size(), std::memory_order_relaxed);
+}
+
+void ClientConnection::evict() {
+    qCWarning(lcNet) << "evicting slow client" << peerAddress().toString() << "queue:" << queuedBytes();
+    evicted = true;
+    totalEvictions.fetch_add(1, std::memory_order_relaxed);
+
+    totalQueuedBytes.fetch_sub(pendingBytes, std::memory_order_relaxed);
+    queue.clear();
+    pendingBytes = 0;
+
+    // we may be inside a broadcast loop over the worker's clients, so close later
+    QMetaObject::invokeMethod(this, &QAbstractSocket::abort, Qt::QueuedConnection);
+}
@@ -0,0 +1,156 @@
+#ifndef CLIENT_CONNECTION_H
+#define CLIENT_CONNECTION_H
+
+#include <QTcpSocket>
+#include <QChronoTimer>
+#include <QList>
+
+#include <atomic>
+
+#include "frame_reader.h"
+#include "server_config.h"
+#include "wire_format.h"
+
+/**
+ * @brief Приоритет исходящего кадра.
+ *
+ * При переполнении очереди первыми отбрасываются кадры с приоритетом Low.
+ */
+enum class FramePriority {
+    Low,    ///< Системные сообщения и списки пользователей
+    Normal, ///< Сообщения чата
+    High    ///< Ответы на команды клиента
+};
+
+/**
+ * @brief Класс ClientConnection — клиентский сокет с ограниченной исходящей очередью.
+ *
+ * Кадры сначала попадают в собственную очередь соединения и передаются сокету
+ * порциями не больше lowWatermark, по мере того как он отдаёт данные в сеть.
+ * Кадры, накопившиеся за один проход цикла событий (или за latencyBudget),
+ * склеиваются и уходят в сокет одной записью.
+ * Это позволяет:
+ * - не вызывать блокирующий flush() и отдельный send() на каждый кадр
+ * - отбрасывать низкоприоритетные кадры для медленного клиента
+ * - отключать клиента, очередь которого превысила hardLimit
+ */
+class ClientConnection final : public QTcpSocket {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Сводные счётчики исходящих очередей всех соединений.
+     */
+    struct Stats {
+        qint64 queuedBytes;    ///< Суммарный объём кадров в очередях
+        quint64 droppedFrames; ///< Число отброшенных низкоприоритетных кадров
+        quint64 evictions;     ///< Число отключённых медленных клиентов
+    };
+
+    /**
+     * @brief Конструктор соединения.
+     * @param config Параметры сервера (пороги очереди, бюджет задержки, размер кадра).
+     * @param parent Родительский QObject (воркер).
+     */
+    explicit ClientConnection(const ServerConfig &config, QObject *parent = nullptr);
+
+    /// Деструктор
+    ~ClientConnection() override;
+
+    /**
+     * @brief Ставит кадр в исходящую очередь.
+     * @param frame Сериализованный кадр.
+     * @param priority Приоритет кадра.
+     */
+    void enqueue(const QByteArray &frame, FramePriority priority);
+
+    /**
+     * @brief Ставит кадр в исходящую очередь в формате этого соединения.
+     * @param frame Кадр (недостающий формат кодируется лениво).
+     * @param priority Приоритет кадра.
+     */
+    void enqueue(OutboundFrame &frame, FramePriority priority);
+
+    /**
+     * @brief Возвращает разборщик входящих кадров соединения.
+     */
+    FrameReader &frameReader();
+
+    /**
+     * @brief Возвращает формат исходящих кадров соединения.
+     */
+    [[nodiscard]] WireFormat wireFormat() const;
+
+    /**
+     * @brief Переключает формат исходящих кадров (после согласования hello).
+     *
+     * Кадры, уже стоящие в очереди, остаются в прежнем формате.
+     */
+    void setWireFormat(WireFormat format);
+
+    /**
+     * @brief Есть ли хотя бы одно соединение в формате Cbor.
+     *
+     * Используется при рассылке, чтобы заранее закодировать CBOR-вариант кадра
+     * один раз, а не в каждом воркере.
+     */
+    static bool anyCborConnections();
+
+    /**
+     * @brief Возвращает объём неотправленных данных (очередь + буфер сокета).
+     */
+    [[nodiscard]] qint64 queuedBytes() const;
+
+    /**
+     * @brief Возвращает снимок сводных счётчиков очередей.
+     */
+    static Stats stats();
+
+private slots:
+    /**
+     * @brief Склеивает кадры из очереди и передаёт их сокету одной записью,
+     * пока его буфер не заполнится.
+     */
+    void flushBatch();
+
+private:
+    /// Кадр в исходящей очереди
+    struct Frame {
+        QByteArray data;
+        FramePriority priority;
+    };
+
+    /**
+     * @brief Планирует flushBatch() по истечении бюджета задержки.
+     */
+    void scheduleFlush();
+
+    /**
+     * @brief Удаляет из очереди все низкоприоритетные кадры.
+     */
+    void dropLowPriority();
+
+    /**
+     * @brief Отключает клиента, не успевающего читать данные.
+     */
+    void evict();
+
+    SendQueueLimits limits;  ///< Пороги очереди
+    QList<Frame> queue;      ///< Кадры, ещё не переданные сокету
+    qint64 pendingBytes = 0; ///< Объём кадров в queue
+    bool throttled = false;  ///< Очередь выше highWatermark и ещё не опустилась ниже lowWatermark
+    bool evicted = false;    ///< Клиент помечен на отключение
+    WireFormat format = WireFormat::Json; ///< Формат исходящих кадров
+    FrameReader reader;                   ///< Разборщик входящих кадров
+
+    std::chrono::microseconds latencyBudget; ///< Бюджет задержки склейки
+    QChronoTimer flushTimer;                 ///< Таймер отложенной записи (при ненулевом бюджете)
+    bool flushScheduled = false;             ///< flushBatch() уже запланирован
+
+    static std::atomic<qint64> totalQueuedBytes;   ///< Сумма pendingBytes всех соединений
+    static std::atomic<quint64> totalDropped;      ///< Отброшенные кадры
+    static std::atomic<quint64> totalEvictions;    ///< Отключённые клиенты
+    static std::atomic<int> cborConnections;       ///< Соединения в формате Cbor
+};
+
+#endif // CLIENT_CONNECTION_H
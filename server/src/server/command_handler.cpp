@@ -1,81 +1,440 @@
 #include "command_handler.h"
 
+#include <QDateTime>
 #include <QJsonDocument>
+#include <QUuid>
 
+#include <memory>
+
+#include "client_connection.h"
 #include "server.h"
+#include "auth/auth_pool.h"
+#include "auth/password_hasher.h"
 #include "database/database.h"
+#include "database/history_cache.h"
+#include "database/read_pool.h"
+#include "database/storage_executor.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
 
 #include "QJsonArray"
 
+using namespace Qt::StringLiterals;
+
 CommandHandler::CommandHandler(Server *serverInstance) : server(serverInstance) {
-    registerHandlers();
+    for (std::size_t i = 0; i < CommandCount; ++i) {
+        const std::string_view name = commandName(static_cast<CommandId>(i));
+        latency[i] = &Metrics::instance().histogram("timp_command_duration_us", "command handler time, microseconds",
+                                                    Metrics::label("command", QLatin1StringView(name)));
+    }
+}
+
+void CommandHandler::processCommand(QTcpSocket *socket, const CommandView &command) {
+    static Counter &unknownCommands = Metrics::instance().counter("timp_unknown_commands_total",
+                                                                  "commands without a registered handler");
+    const std::optional<CommandId> id = commandFromName(command.string("command"_L1));
+    if (!id) {
+        unknownCommands.add();
+        server->sendCommandResponse(socket, {"error", "unknown command"});
+        return;
+    }
+
+    ScopedTimer timer(*latency[static_cast<std::size_t>(*id)]);
+    switch (*id) {
+        case CommandId::Hello:
+            handleHello(server, socket, HelloRequest::parse(command));
+            break;
+        case CommandId::Login:
+            handleLogin(server, socket, CredentialsRequest::parse(command));
+            break;
+        case CommandId::Register:
+            handleRegister(server, socket, CredentialsRequest::parse(command));
+            break;
+        case CommandId::SendMessage:
+            handleSendMessage(server, socket, SendMessageRequest::parse(command));
+            break;
+        case CommandId::GetHistory:
+            handleGetHistory(server, socket, GetHistoryRequest::parse(command));
+            break;
+        case CommandId::GetOnlineUsers:
+            handleGetOnlineUsers(server, socket, EmptyRequest::parse(command));
+            break;
+        case CommandId::Stats:
+            handleStats(server, socket, EmptyRequest::parse(command));
+            break;
+        case CommandId::JoinRoom:
+            handleJoinRoom(server, socket, RoomRequest::parse(command));
+            break;
+        case CommandId::LeaveRoom:
+            handleLeaveRoom(server, socket, RoomRequest::parse(command));
+            break;
+        case CommandId::SendDirect:
+            handleSendDirect(server, socket, DirectMessageRequest::parse(command));
+            break;
+        case CommandId::Resume:
+            handleResume(server, socket, ResumeRequest::parse(command));
+            break;
+        case CommandId::Search:
+            handleSearch(server, socket, SearchRequest::parse(command));
+            break;
+        case CommandId::Count:
+            break;
+    }
 }
 
-void CommandHandler::registerHandlers() {
-    handlers["login"] = &CommandHandler::handleLogin;
-    handlers["register"] = &CommandHandler::handleRegister;
-    handlers["send_message"] = &CommandHandler::handleSendMessage;
-    handlers["get_history"] = &CommandHandler::handleGetHistory;
-    handlers["get_online_users"] = &CommandHandler::handleGetOnlineUsers;
+void CommandHandler::handleHello(Server *server, QTcpSocket *socket, const HelloRequest &request) {
+    const bool wantsCbor = request.wantsCbor;
+    auto *connection = qobject_cast<ClientConnection *>(socket);
+
+    QJsonObject helloResponse;
+    helloResponse["type"] = "hello";
+    helloResponse["protocol"] = wantsCbor && connection ? "cbor" : "json";
+
+    // the reply is still encoded in the old format, everything after it in the new one
+    server->sendResponse(socket, helloResponse);
+    if (wantsCbor && connection) {
+        connection->setWireFormat(WireFormat::Cbor);
+    }
 }
 
-void CommandHandler::processCommand(QTcpSocket *socket, const QJsonObject &json) {
-    const auto command = json["command"].toString();
+namespace {
+    /**
+     * История комнаты в том виде, в каком её ждёт клиент: сообщения от старых к новым
+     * и курсоры для следующих страниц — before_id (старше) и after_id (новее).
+     */
+    QJsonObject historyResponse(const QString &room, const Database::HistoryPage &page, const qint64 sinceId = 0) {
+        QJsonArray messagesArray;
+        for (const Database::StoredMessage &msg: page.messages) {
+            QJsonObject msgObj;
+            msgObj["type"] = "message";
+            msgObj["id"] = msg.id;
+            msgObj["room"] = room;
+            msgObj["sender"] = msg.sender;
+            msgObj["content"] = msg.content;
+            msgObj["timestamp"] = msg.timestamp;
+            messagesArray.append(msgObj);
+        }
+
+        QJsonObject response;
+        response["type"] = "history";
+        response["room"] = room;
+        response["messages"] = messagesArray;
+        response["has_more"] = page.hasMore;
+        if (!page.messages.isEmpty()) {
+            response["before_id"] = page.messages.constFirst().id;
+            response["after_id"] = page.messages.constLast().id;
+        }
+        // a delta since the client's last seen message, not a page it asked for
+        if (sinceId > 0) {
+            response["since_id"] = sinceId;
+        }
+        return response;
+    }
 
-    if (handlers.contains(command)) {
-        handlers[command](server, socket, json);
+    /**
+     * Кадр истории, который клиент сможет прочитать: если страница не помещается в
+     * MaxCborFrameSize, она укорачивается с дальнего конца (для страницы назад — со старых
+     * сообщений, вперёд — с новых) и получает has_more, так что остаток дочитывается по курсору.
+     */
+    QByteArray historyFrame(const QString &room, Database::HistoryPage page, const bool forward,
+                            const WireFormat format, const qint64 sinceId = 0) {
+        for (;;) {
+            QByteArray frame = OutboundFrame::encode(historyResponse(room, page, sinceId), format);
+            if (!frame.isEmpty() || page.messages.size() <= 1) {
+                return frame;
+            }
+
+            const qsizetype dropped = page.messages.size() / 2;
+            if (forward) {
+                page.messages.remove(page.messages.size() - dropped, dropped);
+            } else {
+                page.messages.remove(0, dropped);
+            }
+            page.hasMore = true;
+        }
+    }
+
+    /// Отправляет страницу истории, при необходимости укоротив её до размера кадра
+    void sendHistory(Server *server, QTcpSocket *socket, const QString &room, const Database::HistoryPage &page,
+                     const bool forward, const qint64 sinceId = 0) {
+        auto *connection = qobject_cast<ClientConnection *>(socket);
+        if (!connection) {
+            server->sendResponse(socket, historyResponse(room, page, sinceId));
+            return;
+        }
+        connection->enqueue(historyFrame(room, page, forward, connection->wireFormat(), sinceId), FramePriority::High);
+    }
+
+    /// Результаты search; курсор следующей страницы (offset, until_id) есть только при has_more
+    QJsonObject searchResponse(const SearchRequest &request, const Database::SearchPage &page) {
+        QJsonArray results;
+        for (const Database::SearchHit &hit: page.hits) {
+            QJsonObject result;
+            result["id"] = hit.id;
+            result["sender"] = hit.sender;
+            result["snippet"] = hit.snippet;
+            result["timestamp"] = hit.timestamp;
+            result["rank"] = hit.rank;
+            results.append(result);
+        }
+
+        QJsonObject response;
+        response["type"] = "search_results";
+        response["room"] = request.room;
+        response["query"] = request.query;
+        response["results"] = results;
+        // deeper than MaxOffset the order is not worth trusting: the client refines the query instead
+        const int next = request.offset + static_cast<int>(page.hits.size());
+        const bool hasMore = page.hasMore && next < SearchRequest::MaxOffset;
+        response["has_more"] = hasMore;
+        if (hasMore) {
+            response["offset"] = next;
+            response["until_id"] = page.untilId;
+        }
+        return response;
+    }
+
+    QJsonObject directMessageObject(const QString &sender, const QString &recipient, const QString &content,
+                                    const QString &timestamp) {
+        QJsonObject message;
+        message["type"] = "direct";
+        message["sender"] = sender;
+        message["recipient"] = recipient;
+        message["content"] = content;
+        message["timestamp"] = timestamp;
+        return message;
+    }
+
+    /// Токен для resume; клиент хранит его, пока сервер не ответит "invalid session"
+    QJsonObject sessionResponse(const QString &token, const std::chrono::seconds ttl) {
+        QJsonObject response;
+        response["type"] = "session";
+        response["token"] = token;
+        response["expires_in"] = static_cast<qint64>(ttl.count());
+        return response;
+    }
+
+    void sendDirectBacklog(Server *server, QTcpSocket *socket, const QString &username,
+                           const QList<QVariantMap> &direct) {
+        for (const QVariantMap &message: direct) {
+            server->sendResponse(socket, directMessageObject(message["sender"].toString(), username,
+                                                             message["content"].toString(),
+                                                             message["timestamp"].toString()));
+        }
+    }
+
+    /// Результат проверки пароля в AuthPool
+    struct PasswordCheck {
+        bool valid = false;
+        QString upgradedHash; ///< Непустой, если хэш нужно заменить
+    };
+
+    /// Хэш, с которым сверяется пароль несуществующего пользователя (считается один раз, в AuthPool)
+    const QString &unknownUserHash(const int iterations) {
+        static const QString hash = PasswordHasher::hash(QUuid::createUuid().toString(), iterations);
+        return hash;
+    }
+}
+
+void CommandHandler::handleLogin(Server *server, QTcpSocket *socket, const CredentialsRequest &request) {
+    if (!server->getUserBySocket(socket).isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "already authenticated"});
         return;
     }
 
-    server->sendCommandResponse(socket, {"error", "unknown command"});
+    ReadPool::instance().submit(socket, [username = request.username] {
+        return Database::passwordHash(username);
+    }, [server, socket, request](const std::optional<QString> &stored) {
+        verifyPassword(server, socket, request, stored);
+    });
 }
 
-void CommandHandler::handleLogin(Server *server, QTcpSocket *socket, const QJsonObject &json) {
-    const QString username = json["username"].toString();
-    const QString password = json["password"].toString();
+void CommandHandler::verifyPassword(Server *server, QTcpSocket *socket, const CredentialsRequest &request,
+                                    const std::optional<QString> &stored) {
+    const int iterations = AuthPool::instance().policy().iterations;
+    const bool accepted = AuthPool::instance().submit(socket, [password = request.password, stored, iterations] {
+        if (!stored) {
+            // same work as a wrong password for a real user, so the answer's timing does not tell them apart
+            PasswordHasher::verify(password, unknownUserHash(iterations), iterations);
+            return PasswordCheck{};
+        }
+
+        const PasswordHasher::Verification verification = PasswordHasher::verify(password, *stored, iterations);
+        // rehashed here, while the plaintext is at hand; the caller only stores the result
+        return PasswordCheck{verification.valid,
+                             verification.needsUpgrade ? PasswordHasher::hash(password, iterations) : QString()};
+    }, [server, socket, username = request.username](const PasswordCheck &check) {
+        if (!check.upgradedHash.isEmpty()) {
+            StorageExecutor::instance().post([username, hash = check.upgradedHash] {
+                Database::updatePasswordHash(username, hash);
+            });
+        }
+        finishLogin(server, socket, username, check.valid);
+    });
+
+    if (!accepted) {
+        server->sendCommandResponse(socket, {"error", "server busy"});
+    }
+}
 
-    if (!Database::checkCredentials(username, password)) {
+void CommandHandler::finishLogin(Server *server, QTcpSocket *socket, const QString &username, const bool valid) {
+    if (!valid) {
         server->sendCommandResponse(socket, {"error", "invalid login or password"});
         return;
     }
 
+    // checked again: two logins may have been in flight on this socket
+    if (!server->getUserBySocket(socket).isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "already authenticated"});
+        return;
+    }
+
     if (server->isUserOnline(username)) {
         server->sendCommandResponse(socket, {"error", "user already online"});
         return;
     }
 
-    server->addConnectedUser(socket, username);
-    qDebug() << "user connected: " << username;
+    if (!server->addConnectedUser(socket, username)) {
+        // lost the race against a concurrent login on another worker
+        server->sendCommandResponse(socket, {"error", "user already online"});
+        return;
+    }
+    qCInfo(lcCommand) << "user connected: " << username;
+    server->joinRoom(socket, DefaultRoom);
 
-    server->broadcastSystemMessage(username + " has joined the chat");
+    // back within the resume grace period by password: the leave was never announced, so neither is this
+    if (!server->sessionStore().settle(username)) {
+        server->broadcastSystemMessage(username + " has joined the chat");
+    }
+    // the new user gets the full list once, everybody else only the delta
+    server->broadcastPresenceDelta(username, true);
+    server->sendResponse(socket, sessionResponse(server->sessionStore().issue(username),
+                                                 server->configuration().sessionTtl));
+
+    StorageExecutor::instance().submit(socket, [username] {
+        return Database::takeUndeliveredMessages(username);
+    }, [server, socket, username](const QList<QVariantMap> &direct) {
+        auto finish = [server, socket, username, direct] {
+            sendDirectBacklog(server, socket, username, direct);
+
+            handleGetOnlineUsers(server, socket, EmptyRequest{});
+            server->sendCommandResponse(socket, {"ok", "success login"});
+        };
+        // send message history after user logged in, then what was sent to them meanwhile
+        sendHistoryHead(server, socket, DefaultRoom, GetHistoryRequest::DefaultLimit, std::move(finish));
+    });
+}
 
-    // send message history after user logged in
-    QJsonObject historyCmd;
-    historyCmd["command"] = "get_history";
-    historyCmd["limit"] = 50;
-    handleGetHistory(server, socket, historyCmd);
+void CommandHandler::handleResume(Server *server, QTcpSocket *socket, const ResumeRequest &request) {
+    if (!server->getUserBySocket(socket).isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "already authenticated"});
+        return;
+    }
 
-    // send updated online user list
-    broadcastOnlineUsers(server);
+    const std::optional<SessionStore::Session> session = server->sessionStore().resume(request.token);
+    if (!session) {
+        server->sendCommandResponse(socket, {"error", "invalid session"});
+        return;
+    }
 
-    server->sendCommandResponse(socket, {"ok", "success login"});
+    const QString username = session->username;
+    if (!server->addConnectedUser(socket, username)) {
+        // the old connection is not known to be dead yet
+        server->sendCommandResponse(socket, {"error", "user already online"});
+        return;
+    }
+    qCInfo(lcCommand) << "session resumed: " << username;
+
+    const QStringList rooms = session->rooms.isEmpty() ? QStringList{DefaultRoom} : session->rooms;
+    for (const QString &room: rooms) {
+        server->joinRoom(socket, room);
+    }
+
+    // a lingering session means nobody was told about the drop, so there is nothing to take back
+    if (!session->lingering) {
+        server->broadcastSystemMessage(username + " has joined the chat");
+    }
+    // idempotent on clients, and users who logged in meanwhile did not list this one
+    server->broadcastPresenceDelta(username, true);
+
+    StorageExecutor::instance().submit(socket, [username] {
+        return Database::takeUndeliveredMessages(username);
+    }, [server, socket, username, rooms, request](const QList<QVariantMap> &direct) {
+        // every room's reply arrives on this thread, so a plain counter orders the final answer after them
+        auto remaining = std::make_shared<qsizetype>(rooms.size());
+        auto finish = [server, socket, username, direct, remaining] {
+            if (--*remaining > 0) return;
+
+            sendDirectBacklog(server, socket, username, direct);
+            handleGetOnlineUsers(server, socket, EmptyRequest{});
+            server->sendCommandResponse(socket, {"ok", "session resumed"});
+        };
+        for (const QString &room: rooms) {
+            sendMissedMessages(server, socket, room, request.lastSeen(room), finish);
+        }
+    });
 }
 
-void CommandHandler::handleRegister(Server *server, QTcpSocket *socket, const QJsonObject &json) {
-    const QString username = json["username"].toString();
-    const QString password = json["password"].toString();
+void CommandHandler::sendMissedMessages(Server *server, QTcpSocket *socket, const QString &room,
+                                        const qint64 lastSeenId, std::function<void()> then) {
+    if (lastSeenId == 0) {
+        sendHistoryHead(server, socket, room, GetHistoryRequest::DefaultLimit, std::move(then));
+        return;
+    }
+
+    auto send = [server, socket, room, lastSeenId, then](const Database::HistoryPage &page) {
+        if (page.hasMore) {
+            // missed more than a page: a fresh head is cheaper than paging forward through all of it
+            sendHistoryHead(server, socket, room, GetHistoryRequest::DefaultLimit, then);
+            return;
+        }
+
+        sendHistory(server, socket, room, page, true, lastSeenId);
+        then();
+    };
 
-    if (Database::registerUser(username, password)) {
-        qDebug() << "user registered";
-        server->sendCommandResponse(socket, {"ok", "success register"});
+    const Database::HistoryCursor cursor{0, lastSeenId};
+    if (const auto cached = HistoryCache::instance().page(room, GetHistoryRequest::MaxLimit, cursor)) {
+        send(*cached);
         return;
     }
 
-    server->sendCommandResponse(socket, {"error", "unsuccessful register"});
+    ReadPool::instance().submit(socket, [room, cursor] {
+        return Database::getMessages(room, GetHistoryRequest::MaxLimit, cursor);
+    }, std::move(send));
 }
 
-void CommandHandler::handleSendMessage(Server *server, QTcpSocket *socket, const QJsonObject &json) {
-    const QString message = json["message"].toString().trimmed();
+void CommandHandler::handleRegister(Server *server, QTcpSocket *socket, const CredentialsRequest &request) {
+    // rejected before paying for a hash
+    if (request.username.isEmpty() || request.password.isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "unsuccessful register"});
+        return;
+    }
+
+    const int iterations = AuthPool::instance().policy().iterations;
+    const bool accepted = AuthPool::instance().submit(socket, [password = request.password, iterations] {
+        return PasswordHasher::hash(password, iterations);
+    }, [server, socket, username = request.username](const QString &hash) {
+        StorageExecutor::instance().submit(socket, [username, hash] {
+            return Database::registerUser(username, hash);
+        }, [server, socket](const bool registered) {
+            if (registered) {
+                qCInfo(lcCommand) << "user registered";
+                server->sendCommandResponse(socket, {"ok", "success register"});
+                return;
+            }
+
+            server->sendCommandResponse(socket, {"error", "unsuccessful register"});
+        });
+    });
+
+    if (!accepted) {
+        server->sendCommandResponse(socket, {"error", "server busy"});
+    }
+}
+
+void CommandHandler::handleSendMessage(Server *server, QTcpSocket *socket, const SendMessageRequest &request) {
+    const QString &message = request.message;
 
     if (message.isEmpty()) {
         server->sendCommandResponse(socket, {"error", "empty message"});
@@ -89,49 +448,142 @@ void CommandHandler::handleSendMessage(Server *server, QTcpSocket *socket, const
         return;
     }
 
-    // save message to db
-    if (!Database::saveMessage(sender, message)) {
-        server->sendCommandResponse(socket, {"error", "failed to save message"});
+    if (!server->isInRoom(socket, request.room)) {
+        server->sendCommandResponse(socket, {"error", "not in room"});
         return;
     }
 
-    // broadcast message
-    server->broadcastMessage(sender, message);
+    Database::NewMessage record{request.room, sender, message};
+    if (server->configuration().groupCommit.durability == Durability::Relaxed) {
+        // relaxed: members see the message now, the batch commits it shortly after;
+        // the id is not known yet, so a resume may send the message once more
+        server->broadcastMessage(request.room, sender, message);
+        StorageExecutor::instance().appendMessage(std::move(record));
+        return;
+    }
+
+    // strict: the broadcast waits for the batch holding the message to be durable, the event loop does not
+    auto broadcast = [server, socket, request, sender](const qint64 id) {
+        if (id < 0) {
+            server->sendCommandResponse(socket, {"error", "failed to save message"});
+            return;
+        }
+
+        // only members of the room receive it, with the id a reconnecting client resumes from
+        server->broadcastMessage(request.room, sender, request.message, id);
+    };
+    StorageExecutor::instance().submitMessage(socket, std::move(record), std::move(broadcast));
 }
 
-void CommandHandler::handleGetHistory(Server *server, QTcpSocket *socket, const QJsonObject &json) {
+void CommandHandler::handleGetHistory(Server *server, QTcpSocket *socket, const GetHistoryRequest &request) {
     const QString username = server->getUserBySocket(socket);
     if (username.isEmpty()) {
         server->sendCommandResponse(socket, {"error", "not authenticated"});
         return;
     }
 
-    int limit = json.value("limit").toInt(50);
-    if (limit <= 0 || limit > 200) {
-        limit = 50;
+    if (!server->isInRoom(socket, request.room)) {
+        server->sendCommandResponse(socket, {"error", "not in room"});
+        return;
     }
 
-    QList<QVariantMap> messages = Database::getRecentMessages(limit);
-    std::ranges::reverse(messages);
+    // the latest page is what nearly everyone asks for: served from memory, often as a ready frame
+    const Database::HistoryCursor cursor{request.beforeId, request.afterId};
+    if (cursor.beforeId == 0 && cursor.afterId == 0) {
+        sendHistoryHead(server, socket, request.room, request.limit, {});
+        return;
+    }
 
-    QJsonArray messagesArray;
-    for (const auto &msg: messages) {
-        QJsonObject msgObj;
-        msgObj["type"] = "message";
-        msgObj["sender"] = msg["sender"].toString();
-        msgObj["content"] = msg["content"].toString();
-        msgObj["timestamp"] = msg["timestamp"].toString();
-        messagesArray.append(msgObj);
+    // cursor pages inside the hot window skip the storage queue as well
+    const bool forward = cursor.afterId > 0;
+    if (const auto cached = HistoryCache::instance().page(request.room, request.limit, cursor)) {
+        sendHistory(server, socket, request.room, *cached, forward);
+        return;
     }
 
-    QJsonObject historyResponse;
-    historyResponse["type"] = "history";
-    historyResponse["messages"] = messagesArray;
+    ReadPool::instance().submit(socket, [request, cursor] {
+        return Database::getMessages(request.room, request.limit, cursor);
+    }, [server, socket, room = request.room, forward](const Database::HistoryPage &page) {
+        sendHistory(server, socket, room, page, forward);
+    });
+}
 
-    server->sendResponse(socket, historyResponse);
+bool CommandHandler::sendCachedHistoryHead(Server *server, QTcpSocket *socket, const QString &room, const int limit) {
+    auto *connection = qobject_cast<ClientConnection *>(socket);
+    const bool shared = connection && HistoryFrames::caches(limit);
+    // 0: the room has no ring, so there is no generation to check a frame against
+    const quint64 current = shared ? HistoryCache::instance().generation(room) : 0;
+    if (current != 0) {
+        const QByteArray frame = server->historyFrames().find(room, limit, connection->wireFormat(), current);
+        if (!frame.isEmpty()) {
+            connection->enqueue(frame, FramePriority::High);
+            return true;
+        }
+    }
+
+    quint64 generation = 0;
+    const std::optional<Database::HistoryPage> page = HistoryCache::instance().page(room, limit, {}, &generation);
+    if (!page) {
+        return false;
+    }
+
+    if (!shared || generation == 0) {
+        sendHistory(server, socket, room, *page, false);
+        return true;
+    }
+
+    // encoded once per room change; everyone after gets these bytes until the next message
+    const QByteArray frame = historyFrame(room, *page, false, connection->wireFormat());
+    server->historyFrames().store(room, limit, connection->wireFormat(), generation, frame);
+    connection->enqueue(frame, FramePriority::High);
+    return true;
+}
+
+void CommandHandler::sendHistoryHead(Server *server, QTcpSocket *socket, const QString &room, const int limit,
+                                     std::function<void()> then) {
+    if (sendCachedHistoryHead(server, socket, room, limit)) {
+        if (then) then();
+        return;
+    }
+
+    ReadPool::instance().submit(socket, [room, limit] {
+        return Database::getMessages(room, limit);
+    }, [server, socket, room, then = std::move(then)](const Database::HistoryPage &page) {
+        sendHistory(server, socket, room, page, false);
+        if (then) then();
+    });
+}
+
+void CommandHandler::handleSearch(Server *server, QTcpSocket *socket, const SearchRequest &request) {
+    if (server->getUserBySocket(socket).isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "not authenticated"});
+        return;
+    }
+
+    if (request.query.isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "empty query"});
+        return;
+    }
+
+    if (!server->isInRoom(socket, request.room)) {
+        server->sendCommandResponse(socket, {"error", "not in room"});
+        return;
+    }
+
+    ReadPool::instance().submit(socket, [request] {
+        // the last page allowed ends at MaxOffset
+        const int limit = std::min(request.limit, SearchRequest::MaxOffset - request.offset);
+        return Database::searchMessages(request.room, request.query, limit, {request.untilId, request.offset});
+    }, [server, socket, request](const std::optional<Database::SearchPage> &page) {
+        if (!page) {
+            server->sendCommandResponse(socket, {"error", "search unavailable"});
+            return;
+        }
+        server->sendResponse(socket, searchResponse(request, *page));
+    });
 }
 
-void CommandHandler::handleGetOnlineUsers(Server *server, QTcpSocket *socket, const QJsonObject &json) {
+void CommandHandler::handleGetOnlineUsers(Server *server, QTcpSocket *socket, const EmptyRequest &request) {
     const QString username = server->getUserBySocket(socket);
     if (username.isEmpty()) {
         server->sendCommandResponse(socket, {"error", "not authenticated"});
@@ -154,19 +606,101 @@ void CommandHandler::handleGetOnlineUsers(Server *server, QTcpSocket *socket, co
     server->sendResponse(socket, usersResponse);
 }
 
-void CommandHandler::broadcastOnlineUsers(Server *server) {
-    QStringList onlineUsers = server->getOnlineUsers();
+void CommandHandler::handleStats(Server *server, QTcpSocket *socket, const EmptyRequest &request) {
+    const QString username = server->getUserBySocket(socket);
+    if (username.isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "not authenticated"});
+        return;
+    }
 
-    QJsonObject usersResponse;
-    usersResponse["type"] = "online_users";
+    if (!server->configuration().adminUsers.contains(username)) {
+        server->sendCommandResponse(socket, {"error", "permission denied"});
+        return;
+    }
 
-    QJsonArray usersArray;
-    for (const QString &user: onlineUsers) {
-        usersArray.append(user);
+    QJsonObject statsResponse;
+    statsResponse["type"] = "stats";
+    statsResponse["metrics"] = Metrics::instance().toJson();
+
+    server->sendResponse(socket, statsResponse);
+}
+
+void CommandHandler::handleJoinRoom(Server *server, QTcpSocket *socket, const RoomRequest &request) {
+    if (server->getUserBySocket(socket).isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "not authenticated"});
+        return;
     }
 
-    usersResponse["count"] = onlineUsers.size();
-    usersResponse["users"] = usersArray;
+    if (!request.isValid()) {
+        server->sendCommandResponse(socket, {"error", "invalid room name"});
+        return;
+    }
+
+    if (!server->joinRoom(socket, request.room)) {
+        server->sendCommandResponse(socket, {"error", "already in room"});
+        return;
+    }
+
+    // the room's recent messages first, so the client can render it right away
+    sendHistoryHead(server, socket, request.room, GetHistoryRequest::DefaultLimit, [server, socket] {
+        server->sendCommandResponse(socket, {"ok", "joined room"});
+    });
+}
+
+void CommandHandler::handleLeaveRoom(Server *server, QTcpSocket *socket, const RoomRequest &request) {
+    if (server->getUserBySocket(socket).isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "not authenticated"});
+        return;
+    }
+
+    if (!server->leaveRoom(socket, request.room)) {
+        server->sendCommandResponse(socket, {"error", "not in room"});
+        return;
+    }
+
+    server->sendCommandResponse(socket, {"ok", "left room"});
+}
+
+void CommandHandler::handleSendDirect(Server *server, QTcpSocket *socket, const DirectMessageRequest &request) {
+    const QString sender = server->getUserBySocket(socket);
+    if (sender.isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "not authenticated"});
+        return;
+    }
+
+    if (request.message.isEmpty()) {
+        server->sendCommandResponse(socket, {"error", "empty message"});
+        return;
+    }
 
-    server->broadcastJSON(usersResponse);
+    // saved as delivered when the recipient looks online; the owning worker flips it back if not
+    const bool online = server->isUserOnline(request.recipient);
+    StorageExecutor::instance().submit(socket, [request, sender, online]() -> qint64 {
+        if (!Database::userExists(request.recipient)) {
+            return UnknownRecipient;
+        }
+        return Database::saveDirectMessage(sender, request.recipient, request.message, online);
+    }, [server, socket, request, sender, online](const qint64 id) {
+        if (id == UnknownRecipient) {
+            server->sendCommandResponse(socket, {"error", "unknown recipient"});
+            return;
+        }
+        if (id < 0) {
+            server->sendCommandResponse(socket, {"error", "failed to save message"});
+            return;
+        }
+
+        const QJsonObject message = directMessageObject(sender, request.recipient, request.message,
+                                                        QDateTime::currentDateTime().toString(Qt::ISODate));
+        if (online && server->sendDirect(request.recipient, message, id)) {
+            server->sendCommandResponse(socket, {"ok", "direct sent"});
+            return;
+        }
+
+        if (online) {
+            // logged out while the message was being saved
+            StorageExecutor::instance().post([id] { Database::markUndelivered(id); });
+        }
+        server->sendCommandResponse(socket, {"ok", "direct queued"});
+    });
 }
@@ -3,10 +3,15 @@
 
 #include <QTcpSocket>
 #include <QJsonObject>
+#include <array>
 #include <functional>
+#include <optional>
+
+#include "command_view.h"
+#include "commands.h"
 #include <QString>
-#include <QHash>
 
+class Histogram;
 class Server;
 
 /**
@@ -18,18 +23,15 @@ struct CommandResponse {
 };
 
 /**
- * @brief Тип функции-обработчика команды.
+ * @brief Класс CommandHandler обрабатывает команды клиентов (JSON или CBOR).
  *
- * Принимает указатель на сервер, сокет клиента и JSON-объект команды.
- */
-using CommandHandlerFunction = std::function<void(Server *, QTcpSocket *, const QJsonObject &)>;
-
-/**
- * @brief Класс CommandHandler обрабатывает команды клиентов в формате JSON.
+ * Каждая команда (login, register, send_message, get_history, get_online_users,
+ * join_room, leave_room, send_direct, resume, search) имеет соответствующую функцию-обработчик. Набор команд задан на этапе компиляции
+ * (commands.h): имя превращается в CommandId одной проверкой в таблице без коллизий,
+ * дальше switch вызывает обработчик с уже разобранным запросом.
  *
- * Каждая команда (login, register, send_message, get_history, get_online_users)
- * имеет соответствующую функцию-обработчик. Также используется механизм регистрации
- * хендлеров в хэш-таблице для динамического вызова.
+ * Обработчики не обращаются к БД напрямую: запись уходит в StorageExecutor,
+ * чтение (история, поиск, хэш пароля) — в ReadPool, а ответ клиенту отправляется из продолжения в потоке этого же клиента.
  */
 class CommandHandler {
 public:
@@ -39,55 +41,146 @@ public:
      */
     explicit CommandHandler(Server *serverInstance);
 
-    /**
-     * @brief Регистрирует все доступные обработчики команд.
-     */
-    void registerHandlers();
-
     /**
      * @brief Обрабатывает входящую команду от клиента.
      *
-     * Ищет соответствующий хендлер по ключу "type" и вызывает его.
+     * Находит команду по ключу "command" и вызывает её обработчик.
      * @param socket Сокет клиента.
-     * @param json JSON-объект, содержащий команду.
+     * @param command Разобранная команда.
      */
-    void processCommand(QTcpSocket *socket, const QJsonObject &json);
+    void processCommand(QTcpSocket *socket, const CommandView &command);
 
 private:
     Server *server; ///< Указатель на объект сервера
 
-    /// Хэш-таблица соответствий команд и их обработчиков
-    QHash<QString, CommandHandlerFunction> handlers;
+    /// timp_command_duration_us{command="..."} по номеру команды
+    std::array<Histogram *, CommandCount> latency{};
+
+    /**
+     * @brief Обрабатывает согласование формата кадров (hello).
+     *
+     * Клиент перечисляет поддерживаемые форматы в "protocols". Ответ всегда
+     * уходит в JSON, а следующие кадры — уже в выбранном формате.
+     */
+    static void handleHello(Server *server, QTcpSocket *socket, const HelloRequest &request);
 
     /**
      * @brief Обрабатывает команду входа (login).
      */
-    static void handleLogin(Server *server, QTcpSocket *socket, const QJsonObject &json);
+    static void handleLogin(Server *server, QTcpSocket *socket, const CredentialsRequest &request);
 
     /**
      * @brief Обрабатывает команду регистрации (register).
      */
-    static void handleRegister(Server *server, QTcpSocket *socket, const QJsonObject &json);
+    static void handleRegister(Server *server, QTcpSocket *socket, const CredentialsRequest &request);
 
     /**
      * @brief Обрабатывает отправку сообщения (send_message).
      */
-    static void handleSendMessage(Server *server, QTcpSocket *socket, const QJsonObject &json);
+    static void handleSendMessage(Server *server, QTcpSocket *socket, const SendMessageRequest &request);
 
     /**
      * @brief Обрабатывает запрос истории сообщений (get_history).
      */
-    static void handleGetHistory(Server *server, QTcpSocket *socket, const QJsonObject &json);
+    static void handleGetHistory(Server *server, QTcpSocket *socket, const GetHistoryRequest &request);
+
+    /**
+     * @brief Ищет сообщения комнаты по словам (search).
+     *
+     * Ответ search_results содержит фрагменты с подсветкой совпадений
+     * (Database::SnippetOpen/SnippetClose) и курсор следующей страницы.
+     */
+    static void handleSearch(Server *server, QTcpSocket *socket, const SearchRequest &request);
 
     /**
      * @brief Обрабатывает запрос списка онлайн-пользователей (get_online_users).
      */
-    static void handleGetOnlineUsers(Server *server, QTcpSocket *socket, const QJsonObject &json);
+    static void handleGetOnlineUsers(Server *server, QTcpSocket *socket, const EmptyRequest &request);
 
     /**
-     * @brief Рассылает всем клиентам актуальный список онлайн-пользователей.
+     * @brief Возвращает снимок метрик сервера (stats).
+     *
+     * Доступна только пользователям из ServerConfig::adminUsers.
+     */
+    static void handleStats(Server *server, QTcpSocket *socket, const EmptyRequest &request);
+
+    /**
+     * @brief Добавляет клиента в комнату и присылает её историю (join_room).
+     */
+    static void handleJoinRoom(Server *server, QTcpSocket *socket, const RoomRequest &request);
+
+    /**
+     * @brief Убирает клиента из комнаты (leave_room).
+     */
+    static void handleLeaveRoom(Server *server, QTcpSocket *socket, const RoomRequest &request);
+
+    /**
+     * @brief Отправляет личное сообщение одному пользователю (send_direct).
+     *
+     * Онлайн-получатель получает кадр через индекс имя -> соединение, для
+     * офлайн-получателя сообщение сохраняется недоставленным.
+     */
+    static void handleSendDirect(Server *server, QTcpSocket *socket, const DirectMessageRequest &request);
+
+    /**
+     * @brief Возобновляет сессию после обрыва связи (resume).
+     *
+     * Вместо пароля клиент предъявляет токен, выданный при входе, и id последнего
+     * полученного сообщения. Клиент возвращается в свои комнаты и получает
+     * только пропущенные сообщения; если он вернулся в пределах
+     * ServerConfig::resumeGrace, остальные не видят ни ухода, ни входа.
+     */
+    static void handleResume(Server *server, QTcpSocket *socket, const ResumeRequest &request);
+
+    /**
+     * @brief Отправляет сообщения комнаты новее lastSeenId, а затем вызывает then.
+     *
+     * Ответ — history с полем since_id. Если пропущено больше страницы,
+     * вместо них уходит последняя страница, как при входе.
+     */
+    static void sendMissedMessages(Server *server, QTcpSocket *socket, const QString &room, qint64 lastSeenId,
+                                   std::function<void()> then);
+
+    /**
+     * @brief Отправляет последнюю страницу истории комнаты, а затем вызывает then.
+     *
+     * Страница берётся из HistoryCache (для частых размеров — готовым общим
+     * кадром из HistoryFrames), а при промахе читается в потоке хранилища.
+     */
+    static void sendHistoryHead(Server *server, QTcpSocket *socket, const QString &room, int limit,
+                                std::function<void()> then);
+
+    /**
+     * @brief Отправляет последнюю страницу истории из памяти.
+     * @return false если страницы нет в HistoryCache.
+     */
+    static bool sendCachedHistoryHead(Server *server, QTcpSocket *socket, const QString &room, int limit);
+
+    /// Результат задания send_direct, когда получателя нет в базе
+    static constexpr qint64 UnknownRecipient = -2;
+
+    /**
+     * @brief Проверяет пароль в AuthPool и при успехе завершает вход.
+     *
+     * Если хэш слабее текущих параметров, он пересчитывается там же и
+     * сохраняется вместо старого. При переполненном пуле клиент получает
+     * "server busy".
+     *
+     * Для неизвестного пользователя пароль всё равно проверяется — по
+     * фиксированному хэшу, тем же путём через пул, — и вход отклоняется:
+     * по времени ответа и по "server busy" нельзя узнать, есть ли такое имя.
+     * @param stored Сохранённый хэш пароля или nullopt, если пользователя нет.
+     */
+    static void verifyPassword(Server *server, QTcpSocket *socket, const CredentialsRequest &request,
+                               const std::optional<QString> &stored);
+
+    /**
+     * @brief Завершает вход после проверки пароля.
+     *
+     * Регистрирует пользователя, рассылает его появление и выдаёт токен сессии
+     * для resume, затем отправляет историю и накопленные личные сообщения.
      */
-    static void broadcastOnlineUsers(Server *server);
+    static void finishLogin(Server *server, QTcpSocket *socket, const QString &username, bool valid);
 };
 
 #endif // COMMAND_HANDLER_H
@@ -0,0 +1,92 @@
+#include "command_view.h"
+
+#include <QCborArray>
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+CommandView::CommandView(const QJsonObject &json) : json(json) {
+}
+
+std::optional<CommandView> CommandView::parse(const QByteArrayView payload, const WireFormat format) {
+    if (format == WireFormat::Cbor) {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor(payload.data(), payload.size(), &error);
+        if (error.error != QCborError::NoError || !value.isMap()) {
+            return std::nullopt;
+        }
+
+        CommandView view;
+        view.format = WireFormat::Cbor;
+        view.cbor = value.toMap();
+        return view;
+    }
+
+    // fromRawData: the parser reads the framer's buffer directly, nothing is copied
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(payload.data(), payload.size()), &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        return std::nullopt;
+    }
+
+    return CommandView(doc.object());
+}
+
+QString CommandView::string(const QLatin1StringView key) const {
+    return format == WireFormat::Cbor ? cbor.value(key).toString() : json.value(key).toString();
+}
+
+qint64 CommandView::integer(const QLatin1StringView key, const qint64 defaultValue) const {
+    if (format == WireFormat::Cbor) {
+        return cbor.value(key).toInteger(defaultValue);
+    }
+    return json.value(key).toInteger(defaultValue);
+}
+
+double CommandView::number(const QLatin1StringView key, const double defaultValue) const {
+    if (format == WireFormat::Cbor) {
+        return cbor.value(key).toDouble(defaultValue);
+    }
+    return json.value(key).toDouble(defaultValue);
+}
+
+QStringList CommandView::stringList(const QLatin1StringView key) const {
+    QStringList result;
+    if (format == WireFormat::Cbor) {
+        for (const QCborValue &value: cbor.value(key).toArray()) {
+            result.append(value.toString());
+        }
+        return result;
+    }
+
+    for (const QJsonValue &value: json.value(key).toArray()) {
+        result.append(value.toString());
+    }
+    return result;
+}
+
+QHash<QString, qint64> CommandView::integerMap(const QLatin1StringView key) const {
+    QHash<QString, qint64> result;
+    if (format == WireFormat::Cbor) {
+        const QCborMap map = cbor.value(key).toMap();
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+            if (it.value().isInteger() && it.value().toInteger() >= 0) {
+                result.insert(it.key().toString(), it.value().toInteger());
+            }
+        }
+        return result;
+    }
+
+    const QJsonObject object = json.value(key).toObject();
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        // JSON numbers are doubles: toInteger() gives the default for anything that is not integral
+        if (const qint64 value = it.value().toInteger(-1); value >= 0) {
+            result.insert(it.key(), value);
+        }
+    }
+    return result;
+}
+
+bool CommandView::contains(const QLatin1StringView key) const {
+    return format == WireFormat::Cbor ? cbor.contains(key) : json.contains(key);
+}
@@ -0,0 +1,74 @@
+#ifndef COMMAND_VIEW_H
+#define COMMAND_VIEW_H
+
+#include <QByteArrayView>
+#include <QCborMap>
+#include <QHash>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <optional>
+
+#include "wire_format.h"
+
+/**
+ * @brief Класс CommandView — разобранная команда клиента в её исходном формате.
+ *
+ * JSON-кадр разбирается в QJsonObject, CBOR-кадр — в QCborMap, без перекодирования
+ * одного в другой. Обработчики читают поля через единые методы доступа.
+ */
+class CommandView {
+public:
+    /// Пустая команда (все поля отсутствуют)
+    CommandView() = default;
+
+    /**
+     * @brief Создаёт команду из готового JSON-объекта (для внутренних вызовов).
+     */
+    explicit CommandView(const QJsonObject &json);
+
+    /**
+     * @brief Разбирает кадр прямо из буфера FrameReader.
+     * @param payload Содержимое кадра.
+     * @param format Формат кадра.
+     * @return Команда или std::nullopt, если кадр не является объектом/словарём.
+     */
+    static std::optional<CommandView> parse(QByteArrayView payload, WireFormat format);
+
+    /**
+     * @brief Возвращает строковое поле или пустую строку.
+     */
+    [[nodiscard]] QString string(QLatin1StringView key) const;
+
+    /**
+     * @brief Возвращает целочисленное поле или значение по умолчанию.
+     */
+    [[nodiscard]] qint64 integer(QLatin1StringView key, qint64 defaultValue = 0) const;
+
+    /**
+     * @brief Возвращает числовое поле (целое или с плавающей точкой) или значение по умолчанию.
+     */
+    [[nodiscard]] double number(QLatin1StringView key, double defaultValue = 0) const;
+
+    /**
+     * @brief Возвращает массив строк или пустой список.
+     */
+    [[nodiscard]] QStringList stringList(QLatin1StringView key) const;
+
+    /**
+     * @brief Возвращает словарь строка -> целое или пустой словарь; нецелые и отрицательные значения пропускаются.
+     */
+    [[nodiscard]] QHash<QString, qint64> integerMap(QLatin1StringView key) const;
+
+    /**
+     * @brief Проверяет наличие поля.
+     */
+    [[nodiscard]] bool contains(QLatin1StringView key) const;
+
+private:
+    WireFormat format = WireFormat::Json; ///< Формат, в котором пришла команда
+    QJsonObject json;                     ///< Поля команды (формат Json)
+    QCborMap cbor;                        ///< Поля команды (формат Cbor)
+};
+
+#endif // COMMAND_VIEW_H
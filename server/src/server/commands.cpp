@@ -0,0 +1,86 @@
+#include "commands.h"
+
+#include "command_view.h"
+
+#include <algorithm>
+
+using namespace Qt::StringLiterals;
+
+HelloRequest HelloRequest::parse(const CommandView &command) {
+    return {command.stringList("protocols"_L1).contains("cbor")};
+}
+
+CredentialsRequest CredentialsRequest::parse(const CommandView &command) {
+    return {command.string("username"_L1), command.string("password"_L1)};
+}
+
+ResumeRequest ResumeRequest::parse(const CommandView &command) {
+    ResumeRequest request;
+    request.token = command.string("token"_L1);
+    if (command.contains("last_seen"_L1)) {
+        request.lastSeenIds = command.integerMap("last_seen"_L1);
+    } else {
+        request.lastSeenId = std::max<qint64>(command.integer("last_seen_id"_L1, 0), 0);
+    }
+    return request;
+}
+
+qint64 ResumeRequest::lastSeen(const QString &room) const {
+    // a room missing from the map was never seen by the client: it gets the latest page
+    return lastSeenIds.isEmpty() ? lastSeenId : std::max<qint64>(lastSeenIds.value(room, 0), 0);
+}
+
+namespace {
+    QString roomOrDefault(const CommandView &command) {
+        QString room = command.string("room"_L1);
+        return room.isEmpty() ? QString(DefaultRoom) : room;
+    }
+}
+
+SendMessageRequest SendMessageRequest::parse(const CommandView &command) {
+    return {command.string("message"_L1).trimmed(), roomOrDefault(command)};
+}
+
+DirectMessageRequest DirectMessageRequest::parse(const CommandView &command) {
+    return {command.string("to"_L1), command.string("message"_L1).trimmed()};
+}
+
+GetHistoryRequest GetHistoryRequest::parse(const CommandView &command) {
+    GetHistoryRequest request;
+    const qint64 limit = command.integer("limit"_L1, DefaultLimit);
+    if (limit > 0 && limit <= MaxLimit) {
+        request.limit = static_cast<int>(limit);
+    }
+    request.room = roomOrDefault(command);
+    // negative ids are treated as "not set" rather than rejected
+    request.beforeId = std::max<qint64>(command.integer("before_id"_L1, 0), 0);
+    request.afterId = std::max<qint64>(command.integer("after_id"_L1, 0), 0);
+    return request;
+}
+
+SearchRequest SearchRequest::parse(const CommandView &command) {
+    SearchRequest request;
+    request.query = command.string("query"_L1).trimmed();
+    request.room = roomOrDefault(command);
+    const qint64 limit = command.integer("limit"_L1, DefaultLimit);
+    if (limit > 0 && limit <= MaxLimit) {
+        request.limit = static_cast<int>(limit);
+    }
+    request.offset = static_cast<int>(std::clamp<qint64>(command.integer("offset"_L1, 0), 0, MaxOffset));
+    request.untilId = std::max<qint64>(command.integer("until_id"_L1, 0), 0);
+    return request;
+}
+
+bool RoomRequest::isValid() const {
+    if (room.isEmpty() || room.size() > MaxNameLength) {
+        return false;
+    }
+    return std::ranges::all_of(room, [](const QChar ch) {
+        return (ch >= u'a' && ch <= u'z') || (ch >= u'A' && ch <= u'Z') || (ch >= u'0' && ch <= u'9')
+               || ch == u'_' || ch == u'-';
+    });
+}
+
+RoomRequest RoomRequest::parse(const CommandView &command) {
+    return {command.string("room"_L1)};
+}
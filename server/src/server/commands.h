@@ -0,0 +1,247 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+
+#include <array>
+#include <bit>
+#include <optional>
+#include <string_view>
+
+class CommandView;
+
+/**
+ * @brief Стабильные номера команд протокола.
+ *
+ * Номера не меняются при добавлении команд (новые дописываются перед Count),
+ * поэтому по ним можно индексировать плоские массивы: обработчики, метрики.
+ */
+enum class CommandId : quint8 {
+    Hello,
+    Login,
+    Register,
+    SendMessage,
+    GetHistory,
+    GetOnlineUsers,
+    Stats,
+    JoinRoom,
+    LeaveRoom,
+    SendDirect,
+    Resume,
+    Search,
+    Count ///< Число команд, не команда
+};
+
+/// Число команд
+inline constexpr std::size_t CommandCount = static_cast<std::size_t>(CommandId::Count);
+
+/**
+ * @brief Единственное место, где перечислены имена команд.
+ */
+inline constexpr std::array<std::string_view, CommandCount> CommandNames = {
+    "hello",
+    "login",
+    "register",
+    "send_message",
+    "get_history",
+    "get_online_users",
+    "stats",
+    "join_room",
+    "leave_room",
+    "send_direct",
+    "resume",
+    "search",
+};
+
+/// Комната, в которую пользователь попадает при входе и куда уходят сообщения без "room"
+inline constexpr QLatin1StringView DefaultRoom("general");
+
+namespace detail {
+    constexpr quint32 codeUnit(const char ch) { return static_cast<unsigned char>(ch); }
+    constexpr quint32 codeUnit(const QChar ch) { return ch.unicode(); }
+}
+
+/**
+ * @brief FNV-1a по кодовым единицам строки (одинаков для std::string_view и QStringView).
+ */
+template<typename Chars>
+constexpr quint32 commandHash(const Chars &name) {
+    quint32 hash = 2166136261u;
+    for (const auto ch: name) {
+        hash = (hash ^ detail::codeUnit(ch)) * 16777619u;
+    }
+    return hash;
+}
+
+namespace detail {
+    /// Размер таблицы — степень двойки не меньше удвоенного числа команд
+    inline constexpr std::size_t CommandSlots = std::bit_ceil(CommandCount * 2);
+
+    /// Ищет наименьший сдвиг хэша, при котором все команды попадают в разные ячейки
+    constexpr int findCommandShift() {
+        for (int shift = 0; shift < 32; ++shift) {
+            std::array<bool, CommandSlots> used{};
+            bool collision = false;
+            for (const std::string_view name: CommandNames) {
+                const std::size_t slot = (commandHash(name) >> shift) & (CommandSlots - 1);
+                collision = collision || used[slot];
+                used[slot] = true;
+            }
+            if (!collision) return shift;
+        }
+        return -1;
+    }
+
+    inline constexpr int CommandShift = findCommandShift();
+    static_assert(CommandShift >= 0, "no collision-free shift for the command table; grow CommandSlots");
+
+    /// Ячейка -> номер команды (Count — пустая ячейка)
+    inline constexpr std::array<CommandId, CommandSlots> CommandTable = [] {
+        std::array<CommandId, CommandSlots> table{};
+        table.fill(CommandId::Count);
+        for (std::size_t i = 0; i < CommandCount; ++i) {
+            table[(commandHash(CommandNames[i]) >> CommandShift) & (CommandSlots - 1)] = static_cast<CommandId>(i);
+        }
+        return table;
+    }();
+}
+
+/**
+ * @brief Находит команду по имени: один хэш, одна ячейка, одно сравнение строк.
+ * @return Номер команды или std::nullopt для неизвестного имени.
+ */
+constexpr std::optional<CommandId> commandFromName(const QStringView name) {
+    const CommandId id = detail::CommandTable[(commandHash(name) >> detail::CommandShift)
+                                              & (detail::CommandSlots - 1)];
+    if (id == CommandId::Count) {
+        return std::nullopt;
+    }
+
+    const std::string_view expected = CommandNames[static_cast<std::size_t>(id)];
+    if (static_cast<std::size_t>(name.size()) != expected.size()) {
+        return std::nullopt;
+    }
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        if (detail::codeUnit(name[static_cast<qsizetype>(i)]) != detail::codeUnit(expected[i])) {
+            return std::nullopt;
+        }
+    }
+    return id;
+}
+
+/**
+ * @brief Имя команды по номеру.
+ */
+constexpr std::string_view commandName(const CommandId id) {
+    return CommandNames[static_cast<std::size_t>(id)];
+}
+
+// ----- Разобранные запросы -----
+
+/// hello: форматы кадров, которые понимает клиент
+struct HelloRequest {
+    bool wantsCbor = false;
+
+    static HelloRequest parse(const CommandView &command);
+};
+
+/// login и register: имя и пароль
+struct CredentialsRequest {
+    QString username;
+    QString password;
+
+    static CredentialsRequest parse(const CommandView &command);
+};
+
+/**
+ * resume: токен сессии и id последних сообщений, которые клиент успел получить, по комнатам.
+ *
+ * Старые клиенты присылают вместо словаря last_seen один last_seen_id на все комнаты.
+ */
+struct ResumeRequest {
+    QString token;
+    QHash<QString, qint64> lastSeenIds; ///< Комната -> последний полученный id
+    qint64 lastSeenId = 0;              ///< Общий id от старого клиента, если словаря нет
+
+    /// Курсор комнаты: с какого id досылать пропущенное (0 — отдать последнюю страницу)
+    [[nodiscard]] qint64 lastSeen(const QString &room) const;
+
+    static ResumeRequest parse(const CommandView &command);
+};
+
+/// send_message: текст сообщения (уже без пробелов по краям) и комната
+struct SendMessageRequest {
+    QString message;
+    QString room;
+
+    static SendMessageRequest parse(const CommandView &command);
+};
+
+/// send_direct: получатель ("to") и текст сообщения
+struct DirectMessageRequest {
+    QString recipient;
+    QString message;
+
+    static DirectMessageRequest parse(const CommandView &command);
+};
+
+/**
+ * get_history: число сообщений, уже приведённое к допустимому диапазону, и курсор.
+ *
+ * before_id листает назад от сообщения, after_id — вперёд; без курсора
+ * возвращаются последние сообщения. 0 — курсор не задан.
+ */
+struct GetHistoryRequest {
+    static constexpr int DefaultLimit = 50;
+    static constexpr int MaxLimit = 200;
+
+    int limit = DefaultLimit;
+    QString room = DefaultRoom;
+    qint64 beforeId = 0;
+    qint64 afterId = 0;
+
+    static GetHistoryRequest parse(const CommandView &command);
+};
+
+/**
+ * search: текст запроса, комната и размер страницы.
+ *
+ * Следующая страница запрашивается с offset и until_id из предыдущего ответа.
+ * until_id — снимок: новые сообщения в выдачу не попадают и страницы не сдвигают.
+ * Порядок внутри снимка всё же может немного поменяться (bm25 зависит от всего
+ * индекса), поэтому листать можно только на MaxOffset результатов вглубь.
+ */
+struct SearchRequest {
+    static constexpr int DefaultLimit = 20;
+    static constexpr int MaxLimit = 100;
+    static constexpr int MaxOffset = 500;
+
+    QString query;
+    QString room = DefaultRoom;
+    int limit = DefaultLimit;
+    int offset = 0;      ///< Уже показано результатов, не больше MaxOffset
+    qint64 untilId = 0;  ///< Снимок из предыдущего ответа (0 — первая страница)
+
+    static SearchRequest parse(const CommandView &command);
+};
+
+/// join_room и leave_room: имя комнаты
+struct RoomRequest {
+    static constexpr qsizetype MaxNameLength = 64;
+
+    QString room;
+
+    /// Имя комнаты: 1..64 символа из латиницы, цифр, '_' и '-'
+    [[nodiscard]] bool isValid() const;
+
+    static RoomRequest parse(const CommandView &command);
+};
+
+/// Команда без параметров (get_online_users, stats)
+struct EmptyRequest {
+    static EmptyRequest parse(const CommandView &) { return {}; }
+};
+
+#endif // COMMANDS_H
@@ -0,0 +1,64 @@
+#include "frame_reader.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+FrameReader::FrameReader(const qsizetype maxFrameSize) : maxFrameSize(maxFrameSize) {
+}
+
+qint64 FrameReader::fill(QIODevice *device) {
+    // drop consumed frames, keeping the allocation for the next read
+    if (readPos > 0) {
+        buffer.remove(0, readPos);
+        scanPos -= readPos;
+        readPos = 0;
+    }
+
+    // one max-sized frame plus its prefix or newline is all we ever need to hold
+    const qsizetype limit = maxFrameSize + OutboundFrame::LengthPrefixSize + 1;
+    const qint64 wanted = qMin<qint64>(device->bytesAvailable(), limit - buffer.size());
+    if (wanted <= 0) return 0;
+
+    const qsizetype oldSize = buffer.size();
+    buffer.resize(oldSize + wanted);
+    const qint64 got = device->read(buffer.data() + oldSize, wanted);
+    buffer.resize(oldSize + qMax<qint64>(got, 0));
+    return got;
+}
+
+FrameReader::Result FrameReader::next(QByteArrayView &payload, WireFormat &format) {
+    const qsizetype available = buffer.size() - readPos;
+    if (available <= 0) return Result::NeedMore;
+
+    const char *data = buffer.constData();
+
+    // json lines never start with a zero byte, cbor length prefixes always do
+    if (data[readPos] != 0) {
+        const qsizetype from = qMax(scanPos, readPos);
+        const auto newline = static_cast<const char *>(std::memchr(data + from, '\n', buffer.size() - from));
+        if (!newline) {
+            scanPos = buffer.size();
+            return available > maxFrameSize ? Result::Oversized : Result::NeedMore;
+        }
+
+        const qsizetype end = newline - data;
+        if (end - readPos > maxFrameSize) return Result::Oversized;
+
+        payload = QByteArrayView(data + readPos, end - readPos).trimmed();
+        format = WireFormat::Json;
+        readPos = scanPos = end + 1;
+        return Result::Frame;
+    }
+
+    if (available < OutboundFrame::LengthPrefixSize) return Result::NeedMore;
+
+    const qsizetype length = qFromBigEndian<quint32>(data + readPos);
+    if (length > maxFrameSize) return Result::Oversized;
+    if (available - OutboundFrame::LengthPrefixSize < length) return Result::NeedMore;
+
+    payload = QByteArrayView(data + readPos + OutboundFrame::LengthPrefixSize, length);
+    format = WireFormat::Cbor;
+    readPos = scanPos = readPos + OutboundFrame::LengthPrefixSize + length;
+    return Result::Frame;
+}
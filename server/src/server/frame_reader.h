@@ -0,0 +1,64 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QIODevice>
+
+#include "wire_format.h"
+
+/**
+ * @brief Класс FrameReader — инкрементальный разборщик входящих кадров одного соединения.
+ *
+ * Данные сокета дочитываются в один переиспользуемый буфер, а кадры выдаются
+ * как QByteArrayView прямо в этот буфер, без readLine()/trimmed() и промежуточных
+ * QByteArray. Поиск '\n' продолжается с места, где остановился в прошлый раз,
+ * поэтому медленно приходящая строка не сканируется повторно.
+ *
+ * Размер кадра ограничен maxFrameSize: строка без '\n' длиннее лимита или
+ * CBOR-кадр с большей длиной в префиксе отклоняются до получения тела.
+ */
+class FrameReader {
+public:
+    /**
+     * @brief Результат извлечения кадра.
+     */
+    enum class Result {
+        Frame,    ///< Кадр извлечён
+        NeedMore, ///< Полного кадра в буфере ещё нет
+        Oversized ///< Кадр превышает maxFrameSize
+    };
+
+    /**
+     * @brief Конструктор.
+     * @param maxFrameSize Максимальный размер кадра в байтах.
+     */
+    explicit FrameReader(qsizetype maxFrameSize);
+
+    /**
+     * @brief Дочитывает доступные данные устройства в буфер.
+     *
+     * Читает не больше, чем помещается в один кадр максимального размера,
+     * чтобы буфер оставался ограниченным. Представления, выданные next()
+     * до вызова fill(), становятся недействительными.
+     * @param device Сокет клиента.
+     * @return Число прочитанных байт.
+     */
+    qint64 fill(QIODevice *device);
+
+    /**
+     * @brief Извлекает следующий кадр из буфера.
+     * @param payload Содержимое кадра (действительно до следующего fill()).
+     * @param format Формат кадра.
+     * @return Результат извлечения.
+     */
+    Result next(QByteArrayView &payload, WireFormat &format);
+
+private:
+    qsizetype maxFrameSize; ///< Максимальный размер кадра
+    QByteArray buffer;      ///< Прочитанные, но ещё не разобранные данные
+    qsizetype readPos = 0;  ///< Начало первого неразобранного кадра
+    qsizetype scanPos = 0;  ///< Откуда продолжать поиск '\n'
+};
+
+#endif // FRAME_READER_H
@@ -0,0 +1,77 @@
+#include "history_frames.h"
+
+#include <algorithm>
+
+#include "metrics/metrics.h"
+
+HistoryFrames::HistoryFrames(const qsizetype maxRooms) : maxRooms(std::max<qsizetype>(maxRooms, 0)) {
+}
+
+bool HistoryFrames::caches(const int limit) {
+    return std::ranges::contains(CachedLimits, limit);
+}
+
+qsizetype HistoryFrames::slotIndex(const int limit, const WireFormat format) {
+    const auto position = std::ranges::find(CachedLimits, limit) - CachedLimits.begin();
+    return position * 2 + (format == WireFormat::Cbor ? 1 : 0);
+}
+
+QByteArray HistoryFrames::find(const QString &room, const int limit, const WireFormat format,
+                               const quint64 generation) const {
+    static Counter &hits = Metrics::instance().counter("timp_history_frame_hits_total",
+                                                       "history responses sent as a shared pre-encoded frame");
+
+    QReadLocker locker(&lock);
+    const auto it = rooms.constFind(room);
+    if (it == rooms.cend()) {
+        return {};
+    }
+
+    const Slot &slot = (*it)[slotIndex(limit, format)];
+    if (slot.frame.isEmpty() || slot.generation != generation) {
+        return {};
+    }
+    hits.add();
+    return slot.frame;
+}
+
+void HistoryFrames::store(const QString &room, const int limit, const WireFormat format, const quint64 generation,
+                          const QByteArray &frame) {
+    static Counter &rebuilds = Metrics::instance().counter("timp_history_frame_rebuilds_total",
+                                                           "history frames encoded after a room changed");
+
+    QWriteLocker locker(&lock);
+    auto it = rooms.find(room);
+    if (it == rooms.end()) {
+        // before the insert: erasing moves other entries of the hash
+        evict();
+        it = rooms.insert(room, RoomSlots());
+    }
+    Slot &slot = (*it)[slotIndex(limit, format)];
+    // a slower requester may finish encoding an older page after a newer one was stored
+    if (!slot.frame.isEmpty() && slot.generation > generation) {
+        return;
+    }
+    slot = {frame, generation};
+    rebuilds.add();
+}
+
+void HistoryFrames::drop(const QString &room) {
+    QWriteLocker locker(&lock);
+    rooms.remove(room);
+}
+
+quint64 HistoryFrames::newestGeneration(const RoomSlots &slots) {
+    return std::ranges::max(slots, {}, &Slot::generation).generation;
+}
+
+void HistoryFrames::evict() {
+    static Counter &evictions = Metrics::instance().counter("timp_history_frame_evictions_total",
+                                                            "rooms whose frames were dropped to keep the cache bounded");
+    if (maxRooms == 0 || rooms.size() < maxRooms) return;
+
+    // generations are global, so the oldest one is the room that went quiet first
+    const auto oldest = std::ranges::min_element(rooms.begin(), rooms.end(), {}, &HistoryFrames::newestGeneration);
+    rooms.erase(oldest);
+    evictions.add();
+}
@@ -0,0 +1,89 @@
+#ifndef HISTORY_FRAMES_H
+#define HISTORY_FRAMES_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+
+#include <array>
+
+#include "commands.h"
+#include "wire_format.h"
+
+/**
+ * @brief Класс HistoryFrames хранит уже закодированные ответы history.
+ *
+ * Все, кто запрашивает последнюю страницу комнаты между двумя сообщениями,
+ * получают одинаковые байты, поэтому кадр кодируется один раз на формат и
+ * дальше разделяется между соединениями (QByteArray неизменяем и разделяется
+ * неявно). Кадр привязан к поколению комнаты из HistoryCache: после нового
+ * сообщения он считается устаревшим и пересобирается при следующем запросе.
+ *
+ * Хранятся только страницы частых размеров (CachedLimits) без курсора и не
+ * больше чем для maxRooms комнат: при переполнении вытесняются кадры комнаты
+ * с самым старым поколением, то есть той, где дольше всех не было сообщений.
+ * Методы потокобезопасны.
+ */
+class HistoryFrames {
+public:
+    /**
+     * @brief Конструктор.
+     * @param maxRooms Для скольких комнат хранить кадры (0 — без ограничения).
+     */
+    explicit HistoryFrames(qsizetype maxRooms = 0);
+
+    /// Размеры страниц, для которых хранятся кадры
+    static constexpr std::array<int, 2> CachedLimits = {GetHistoryRequest::DefaultLimit, GetHistoryRequest::MaxLimit};
+
+    /**
+     * @brief Хранится ли кадр для страницы такого размера.
+     */
+    static bool caches(int limit);
+
+    /**
+     * @brief Возвращает кадр последней страницы комнаты.
+     * @param room Имя комнаты.
+     * @param limit Размер страницы (один из CachedLimits).
+     * @param format Формат кадра.
+     * @param generation Текущее поколение комнаты.
+     * @return Кадр или пустой массив, если кадра нет или он устарел.
+     */
+    [[nodiscard]] QByteArray find(const QString &room, int limit, WireFormat format, quint64 generation) const;
+
+    /**
+     * @brief Запоминает кадр последней страницы комнаты.
+     *
+     * Кадр более старого поколения, чем уже сохранённый, отбрасывается.
+     */
+    void store(const QString &room, int limit, WireFormat format, quint64 generation, const QByteArray &frame);
+
+    /**
+     * @brief Забывает кадры комнаты (её буфер вытеснен из HistoryCache).
+     */
+    void drop(const QString &room);
+
+private:
+    /// Кадр и поколение, из которого он собран
+    struct Slot {
+        QByteArray frame;
+        quint64 generation = 0;
+    };
+
+    /// Ячейки комнаты: по одной на размер страницы и формат
+    using RoomSlots = std::array<Slot, CachedLimits.size() * 2>;
+
+    static qsizetype slotIndex(int limit, WireFormat format);
+
+    /// Самое новое поколение среди кадров комнаты
+    static quint64 newestGeneration(const RoomSlots &slots);
+
+    /// Освобождает место под новую комнату, вытесняя комнату с самым старым поколением
+    void evict();
+
+    mutable QReadWriteLock lock;
+    const qsizetype maxRooms;
+    QHash<QString, RoomSlots> rooms;
+};
+
+#endif // HISTORY_FRAMES_H
@@ -0,0 +1,49 @@
+#include "presence.h"
+
+#include <algorithm>
+
+bool Presence::join(const QString &username, QTcpSocket *socket, ServerWorker *worker) {
+    QWriteLocker locker(&lock);
+    const auto it = std::ranges::lower_bound(users, username);
+    if (it != users.end() && *it == username) {
+        return false;
+    }
+    users.insert(it, username);
+    routes.insert(username, {socket, worker});
+    return true;
+}
+
+bool Presence::leave(const QString &username) {
+    QWriteLocker locker(&lock);
+    const auto it = std::ranges::lower_bound(users, username);
+    if (it == users.end() || *it != username) {
+        return false;
+    }
+    users.erase(it);
+    routes.remove(username);
+    return true;
+}
+
+bool Presence::contains(const QString &username) const {
+    QReadLocker locker(&lock);
+    return routes.contains(username);
+}
+
+std::optional<Presence::Route> Presence::routeOf(const QString &username) const {
+    QReadLocker locker(&lock);
+    const auto it = routes.constFind(username);
+    if (it == routes.cend()) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+QStringList Presence::snapshot() const {
+    QReadLocker locker(&lock);
+    return users;
+}
+
+qsizetype Presence::count() const {
+    QReadLocker locker(&lock);
+    return users.size();
+}
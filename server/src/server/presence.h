@@ -0,0 +1,80 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QStringList>
+
+#include <optional>
+
+class QTcpSocket;
+class ServerWorker;
+
+/**
+ * @brief Класс Presence хранит отсортированный индекс онлайн-пользователей.
+ *
+ * Индекс поддерживается отсортированным при каждом входе/выходе (бинарный поиск
+ * и вставка), поэтому:
+ * - проверка онлайн-статуса выполняется за O(1) по обратному индексу
+ * - снимок списка не требует сортировки и копирования (QStringList разделяется неявно)
+ *
+ * Рядом хранится обратный индекс имя -> соединение и его воркер для адресной
+ * доставки (send_direct): поиск получателя — O(1) без обхода соединений.
+ *
+ * Методы потокобезопасны: ими пользуются воркеры из разных потоков.
+ */
+class Presence {
+public:
+    /// Где искать соединение пользователя
+    struct Route {
+        QTcpSocket *socket = nullptr;   ///< Только для сравнения в потоке воркера
+        ServerWorker *worker = nullptr; ///< Воркер, которому принадлежит соединение
+    };
+
+    /**
+     * @brief Отмечает пользователя как онлайн.
+     * @param username Имя пользователя.
+     * @param socket Соединение пользователя.
+     * @param worker Воркер, в потоке которого живёт соединение.
+     * @return false если пользователь уже онлайн.
+     */
+    bool join(const QString &username, QTcpSocket *socket, ServerWorker *worker);
+
+    /**
+     * @brief Отмечает пользователя как офлайн.
+     * @param username Имя пользователя.
+     * @return false если пользователь не был онлайн.
+     */
+    bool leave(const QString &username);
+
+    /**
+     * @brief Проверяет, онлайн ли пользователь.
+     */
+    [[nodiscard]] bool contains(const QString &username) const;
+
+    /**
+     * @brief Возвращает соединение пользователя и его воркер или nullopt, если пользователь офлайн.
+     *
+     * Сокет можно только передать воркеру-владельцу: он живёт в потоке воркера
+     * и может быть удалён к моменту доставки, поэтому вне этого потока его нельзя
+     * разыменовывать (в том числе спрашивать у него parent()).
+     */
+    [[nodiscard]] std::optional<Route> routeOf(const QString &username) const;
+
+    /**
+     * @brief Возвращает отсортированный снимок списка онлайн-пользователей.
+     */
+    [[nodiscard]] QStringList snapshot() const;
+
+    /**
+     * @brief Возвращает число онлайн-пользователей.
+     */
+    [[nodiscard]] qsizetype count() const;
+
+private:
+    mutable QReadWriteLock lock;  ///< Защищает users и routes
+    QStringList users;            ///< Отсортированные имена
+    QHash<QString, Route> routes; ///< Имя -> соединение и воркер
+};
+
+#endif // PRESENCE_H
@@ -2,92 +2,112 @@
 
 #include <QJsonArray>
 
+#include <algorithm>
+
 #include "command_handler.h"
+#include "server_worker.h"
 #include "database/database.h"
+#include "database/history_cache.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
 
 #include <QJsonDocument>
 #include <QJsonObject>
 
 
-Server::Server(QObject *parent) : QObject(parent), server(new QTcpServer(this)) {
+Server::Server(const ServerConfig &config, QObject *parent) : QTcpServer(parent), config(config),
+                                                                 frames(config.historyCacheRooms),
+                                                                 sessions(config.sessionTtl) {
     commandHandler = new CommandHandler(this);
+    // frames of a room outlive its ring otherwise, keyed by a generation nobody reports any more
+    HistoryCache::instance().setEvictionListener([this](const QString &room) { frames.drop(room); });
+
+    if (config.workerThreads <= 0) {
+        // single-threaded mode: the only worker shares the main event loop
+        auto *worker = new ServerWorker(this, commandHandler);
+        worker->setParent(this);
+        workers.append(worker);
+        return;
+    }
+
+    for (int i = 0; i < config.workerThreads; ++i) {
+        auto *thread = new QThread(this);
+        thread->setObjectName(QString("worker-%1").arg(i));
+
+        auto *worker = new ServerWorker(this, commandHandler);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        thread->start();
+        threads.append(thread);
+        workers.append(worker);
+    }
 }
 
 Server::~Server() {
+    HistoryCache::instance().setEvictionListener({});
+    close();
+    for (QThread *thread: threads) {
+        thread->quit();
+        thread->wait();
+    }
     delete commandHandler;
 }
 
 
-bool Server::startServer(const quint16 port) const {
-    if (!server->listen(QHostAddress::Any, port)) {
-        qDebug() << "failed to start server. error: " << server->errorString();
+bool Server::startServer(const quint16 port) {
+    if (!listen(QHostAddress::Any, port)) {
+        qCCritical(lcServer) << "failed to start server. error: " << errorString();
         return false;
     }
 
-    connect(server, SIGNAL(newConnection()), this, SLOT(handleNewConnection()));
-    qDebug() << "server is listening on port" << port;
+    qCInfo(lcServer) << "server is listening on port" << port << "with" << workers.size() << "worker(s)";
     return true;
 }
 
-void Server::handleNewConnection() {
-    QTcpSocket *socket = server->nextPendingConnection();
-    connect(socket, SIGNAL(readyRead()), this, SLOT(handleReadyRead()));
-    connect(socket, SIGNAL(disconnected()), this, SLOT(handleClientDisconnected()));
-    clients.append(socket);
-    qDebug() << "new client connected: " << socket->peerAddress().toString();
-}
-
-void Server::handleReadyRead() const {
-    const auto socket = qobject_cast<QTcpSocket *>(sender());
-    if (!socket) return;
+void Server::incomingConnection(const qintptr socketDescriptor) {
+    ServerWorker *worker = pickWorker();
+    worker->reserveConnection();
 
-    while (socket->canReadLine()) {
-        const QByteArray jsonData = socket->readLine().trimmed();
-        qDebug() << "got data from client:" << jsonData;
-
-        const QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-        if (doc.isNull()) {
-            qDebug() << "failed to parse json";
-            continue;
-        }
-
-        const QJsonObject json = doc.object();
+    // the socket must be created in the thread that will own it
+    QMetaObject::invokeMethod(worker, [worker, socketDescriptor] {
+        worker->addConnection(socketDescriptor);
+    }, Qt::QueuedConnection);
+}
 
-        commandHandler->processCommand(socket, json);
-    }
+const ServerConfig &Server::configuration() const {
+    return config;
 }
 
-void Server::handleClientDisconnected() {
-    const auto socket = qobject_cast<QTcpSocket *>(sender());
-    if (!socket) return;
+HistoryFrames &Server::historyFrames() {
+    return frames;
+}
 
-    // check if user was authenticated
-    if (connectedUsers.contains(socket)) {
-        const QString username = connectedUsers[socket];
-        // broadcast leaving
-        broadcastSystemMessage(username + " has left the chat");
-        connectedUsers.remove(socket);
+SessionStore &Server::sessionStore() {
+    return sessions;
+}
 
-        // send updated user list
-        QJsonObject usersResponse;
-        usersResponse["type"] = "online_users";
-        QJsonArray usersArray;
-        for (const QString &user : getOnlineUsers()) {
-            usersArray.append(user);
-        }
-        usersResponse["users"] = usersArray;
-        broadcastJSON(usersResponse);
+ServerWorker *Server::pickWorker() {
+    if (config.dispatchPolicy == DispatchPolicy::LeastLoaded) {
+        return *std::ranges::min_element(workers, {}, &ServerWorker::connectionCount);
     }
 
-    clients.removeOne(socket);
-    socket->deleteLater();
-    qDebug() << "client disconnected";
+    ServerWorker *worker = workers[nextWorker];
+    nextWorker = (nextWorker + 1) % workers.size();
+    return worker;
+}
+
+ServerWorker *Server::workerFor(QTcpSocket *socket) {
+    return qobject_cast<ServerWorker *>(socket->parent());
 }
 
 void Server::sendResponse(QTcpSocket *socket, const QJsonObject &jsonResponse) {
-    qDebug() << "sending response: " << jsonResponse;
-    socket->write(QJsonDocument(jsonResponse).toJson(QJsonDocument::Compact) + "\n");
-    socket->flush();
+    qCDebug(lcNet) << "sending response: " << jsonResponse;
+    if (auto *connection = qobject_cast<ClientConnection *>(socket)) {
+        connection->enqueue(OutboundFrame::encode(jsonResponse, connection->wireFormat()), FramePriority::High);
+        return;
+    }
+    socket->write(OutboundFrame::encode(jsonResponse, WireFormat::Json));
 }
 
 void Server::sendCommandResponse(QTcpSocket *socket, const CommandResponse &response) {
@@ -98,34 +118,121 @@ void Server::sendCommandResponse(QTcpSocket *socket, const CommandResponse &resp
 }
 
 bool Server::isUserOnline(const QString &username) const {
-    return connectedUsers.values().contains(username);
+    return presence.contains(username);
+}
+
+namespace {
+    Gauge &authenticatedUsers() {
+        static Gauge &gauge = Metrics::instance().gauge("timp_authenticated_users", "users currently logged in");
+        return gauge;
+    }
+}
+
+bool Server::addConnectedUser(QTcpSocket *socket, const QString &username) {
+    // called on the socket's own thread, the only place its parent may be read
+    if (!presence.join(username, socket, workerFor(socket))) {
+        return false;
+    }
+
+    workerFor(socket)->setUser(socket, username);
+    authenticatedUsers().set(presence.count());
+    return true;
 }
 
-void Server::addConnectedUser(QTcpSocket *socket, const QString &username) {
-    connectedUsers[socket] = username;
+void Server::removeConnectedUser(const QString &username) {
+    presence.leave(username);
+    authenticatedUsers().set(presence.count());
 }
 
 QString Server::getUserBySocket(QTcpSocket *socket) const {
-    return connectedUsers.value(socket, QString());
+    return workerFor(socket)->userBySocket(socket);
 }
 
-void Server::broadcastJSON(const QJsonObject &json) {
-    const QByteArray data = QJsonDocument(json).toJson(QJsonDocument::Compact) + "\n";
-    for (QTcpSocket *client: clients) {
-        if (connectedUsers.contains(client)) {
-            client->write(data);
-            client->flush();
+void Server::fanOut(const QJsonObject &json, const FramePriority priority,
+                    const std::function<void(ServerWorker *, OutboundFrame &, FramePriority)> &write) {
+    // encode every format in use once, here, instead of once per worker
+    OutboundFrame frame(json);
+    frame.bytes(WireFormat::Json);
+    if (ClientConnection::anyCborConnections()) {
+        frame.bytes(WireFormat::Cbor);
+    }
+
+    for (ServerWorker *worker: workers) {
+        if (worker->thread() == QThread::currentThread()) {
+            write(worker, frame, priority);
+            continue;
         }
+
+        // the encoded buffers are implicitly shared, so every worker gets the same bytes
+        QMetaObject::invokeMethod(worker, [worker, frame, priority, write]() mutable {
+            write(worker, frame, priority);
+        }, Qt::QueuedConnection);
     }
 }
 
-void Server::broadcastMessage(const QString &sender, const QString &message) {
+void Server::broadcastJSON(const QJsonObject &json, const FramePriority priority) {
+    static Counter &broadcasts = Metrics::instance().counter("timp_broadcasts_total", "frames broadcast to all users");
+    broadcasts.add();
+
+    fanOut(json, priority, [](ServerWorker *worker, OutboundFrame &frame, const FramePriority framePriority) {
+        worker->writeToAuthenticated(frame, framePriority);
+    });
+}
+
+void Server::broadcastToRoom(const QString &room, const QJsonObject &json, const FramePriority priority) {
+    static Counter &roomBroadcasts = Metrics::instance().counter("timp_room_broadcasts_total",
+                                                                 "frames broadcast to one room");
+    roomBroadcasts.add();
+
+    fanOut(json, priority, [room](ServerWorker *worker, OutboundFrame &frame, const FramePriority framePriority) {
+        worker->writeToRoom(room, frame, framePriority);
+    });
+}
+
+void Server::broadcastMessage(const QString &room, const QString &sender, const QString &message, const qint64 id) {
     QJsonObject jsonMessage;
     jsonMessage["type"] = "message";
+    if (id > 0) {
+        jsonMessage["id"] = id;
+    }
+    jsonMessage["room"] = room;
     jsonMessage["sender"] = sender;
     jsonMessage["content"] = message;
     jsonMessage["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    broadcastJSON(jsonMessage);
+    broadcastToRoom(room, jsonMessage);
+}
+
+bool Server::sendDirect(const QString &recipient, const QJsonObject &json, const qint64 messageId) {
+    const std::optional<Presence::Route> route = presence.routeOf(recipient);
+    if (!route) {
+        return false;
+    }
+
+    // the socket belongs to another thread: only its worker, recorded at login, may look at it
+    OutboundFrame frame(json);
+    ServerWorker *worker = route->worker;
+    QTcpSocket *socket = route->socket;
+    if (worker->thread() == QThread::currentThread()) {
+        return worker->writeToUser(socket, recipient, frame, messageId);
+    }
+
+    // the socket may be gone by the time the worker runs this; it checks before touching it
+    QMetaObject::invokeMethod(worker, [worker, socket, recipient, frame, messageId]() mutable {
+        worker->writeToUser(socket, recipient, frame, messageId);
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+bool Server::joinRoom(QTcpSocket *socket, const QString &room) {
+    return workerFor(socket)->joinRoom(socket, room);
+}
+
+bool Server::leaveRoom(QTcpSocket *socket, const QString &room) {
+    return workerFor(socket)->leaveRoom(socket, room);
+}
+
+bool Server::isInRoom(QTcpSocket *socket, const QString &room) const {
+    return workerFor(socket)->isInRoom(socket, room);
 }
 
 void Server::broadcastSystemMessage(const QString &message) {
@@ -133,11 +240,19 @@ void Server::broadcastSystemMessage(const QString &message) {
     jsonMessage["type"] = "system";
     jsonMessage["content"] = message;
     jsonMessage["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    broadcastJSON(jsonMessage);
+    broadcastJSON(jsonMessage, FramePriority::Low);
+}
+
+void Server::broadcastPresenceDelta(const QString &username, const bool joined) {
+    QJsonObject delta;
+    delta["type"] = "presence_delta";
+    delta["event"] = joined ? "join" : "leave";
+    delta["user"] = username;
+    delta["count"] = presence.count();
+    // a dropped delta would leave the client's list wrong until the next login, so not Low
+    broadcastJSON(delta, FramePriority::Normal);
 }
 
 QStringList Server::getOnlineUsers() const {
-    QStringList users = connectedUsers.values();
-    users.sort();
-    return users;
+    return presence.snapshot();
 }
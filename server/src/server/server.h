@@ -3,10 +3,19 @@
 
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThread>
 
+#include <functional>
+
+#include "client_connection.h"
 #include "command_handler.h"
+#include "history_frames.h"
+#include "presence.h"
+#include "server_config.h"
+#include "session_store.h"
 
 class CommandHandler;
+class ServerWorker;
 
 /**
  * @brief Класс Server реализует TCP-сервер для обработки клиентских соединений.
@@ -16,16 +25,21 @@ class CommandHandler;
  * - Обменивается JSON-сообщениями с клиентами
  * - Хранит список подключённых пользователей
  * - Делегирует обработку команд объекту CommandHandler
+ *
+ * Принятые дескрипторы раздаются пулу воркеров (ServerWorker), каждый из которых
+ * работает в своём потоке. Если рабочих потоков 0, единственный воркер живёт
+ * в главном потоке.
  */
-class Server final : public QObject {
+class Server final : public QTcpServer {
     Q_OBJECT
 
 public:
     /**
      * @brief Конструктор сервера.
+     * @param config Параметры запуска (число потоков, стратегия распределения).
      * @param parent Родительский QObject.
      */
-    explicit Server(QObject *parent = nullptr);
+    explicit Server(const ServerConfig &config = {}, QObject *parent = nullptr);
 
     /// Деструктор сервера
     ~Server() override;
@@ -35,7 +49,22 @@ public:
      * @param port Порт, на котором будет слушать сервер. По умолчанию 1234.
      * @return true если сервер успешно запущен, иначе false.
      */
-    [[nodiscard]] bool startServer(quint16 port = 1234) const;
+    [[nodiscard]] bool startServer(quint16 port = 1234);
+
+    /**
+     * @brief Возвращает параметры запуска сервера.
+     */
+    [[nodiscard]] const ServerConfig &configuration() const;
+
+    /**
+     * @brief Возвращает общие для всех воркеров готовые кадры истории.
+     */
+    HistoryFrames &historyFrames();
+
+    /**
+     * @brief Возвращает токены возобновления сессий.
+     */
+    SessionStore &sessionStore();
 
     /**
      * @brief Отправляет клиенту стандартный ответ (статус и сообщение).
@@ -53,10 +82,20 @@ public:
 
     /**
      * @brief Добавляет пользователя в список подключённых.
+     *
+     * Проверка и добавление выполняются атомарно, поэтому два одновременных
+     * входа под одним именем из разных потоков не пройдут оба.
      * @param socket Сокет клиента.
      * @param username Имя пользователя.
+     * @return false если пользователь уже онлайн.
      */
-    void addConnectedUser(QTcpSocket *socket, const QString &username);
+    bool addConnectedUser(QTcpSocket *socket, const QString &username);
+
+    /**
+     * @brief Удаляет пользователя из списка подключённых.
+     * @param username Имя пользователя.
+     */
+    void removeConnectedUser(const QString &username);
 
     /**
      * @brief Возвращает имя пользователя по его сокету.
@@ -67,23 +106,73 @@ public:
 
     /**
      * @brief Отправляет произвольный JSON-ответ клиенту.
+     *
+     * Ответ ставится в исходящую очередь соединения с приоритетом High.
      * @param socket Сокет клиента.
      * @param jsonResponse JSON-объект с ответом.
      */
     static void sendResponse(QTcpSocket *socket, const QJsonObject &jsonResponse);
 
     /**
-     * @brief Рассылает текстовое сообщение всем клиентам.
+     * @brief Рассылает текстовое сообщение участникам комнаты.
+     * @param room Имя комнаты.
      * @param sender Имя отправителя.
      * @param message Текст сообщения.
+     * @param id Идентификатор сохранённого сообщения; 0 — ещё не сохранено
+     *           (клиент не сможет учесть его в last_seen при resume).
+     */
+    void broadcastMessage(const QString &room, const QString &sender, const QString &message, qint64 id = 0);
+
+    /**
+     * @brief Рассылает JSON-объект только участникам комнаты.
+     *
+     * Каждый воркер проходит лишь по своему индексу комнаты, остальные
+     * авторизованные клиенты не затрагиваются.
+     * @param room Имя комнаты.
+     * @param json JSON-объект для рассылки.
+     * @param priority Приоритет кадра в исходящих очередях клиентов.
+     */
+    void broadcastToRoom(const QString &room, const QJsonObject &json, FramePriority priority = FramePriority::Normal);
+
+    /**
+     * @brief Доставляет кадр одному пользователю (send_direct).
+     *
+     * Получатель находится по индексу имя -> соединение, кадр передаётся только
+     * воркеру, владеющему этим соединением. Если соединение закроется раньше,
+     * чем воркер успеет поставить кадр в очередь, сообщение с messageId снова
+     * помечается недоставленным и уйдёт при следующем входе.
+     * @param recipient Имя получателя.
+     * @param json JSON-объект для доставки.
+     * @param messageId Идентификатор сохранённого сообщения.
+     * @return false если получатель офлайн.
      */
-    void broadcastMessage(const QString &sender, const QString &message);
+    bool sendDirect(const QString &recipient, const QJsonObject &json, qint64 messageId);
+
+    /**
+     * @brief Добавляет клиента в комнату.
+     * @return false если клиент уже в комнате.
+     */
+    bool joinRoom(QTcpSocket *socket, const QString &room);
+
+    /**
+     * @brief Убирает клиента из комнаты.
+     * @return false если клиента в комнате не было.
+     */
+    bool leaveRoom(QTcpSocket *socket, const QString &room);
+
+    /**
+     * @brief Проверяет, состоит ли клиент в комнате.
+     */
+    [[nodiscard]] bool isInRoom(QTcpSocket *socket, const QString &room) const;
 
     /**
      * @brief Рассылает JSON-объект всем клиентам.
+     *
+     * Кадр сериализуется один раз и передаётся в потоки всех воркеров.
      * @param json JSON-объект для рассылки.
+     * @param priority Приоритет кадра в исходящих очередях клиентов.
      */
-    void broadcastJSON(const QJsonObject &json);
+    void broadcastJSON(const QJsonObject &json, FramePriority priority = FramePriority::Normal);
 
     /**
      * @brief Рассылает системное сообщение всем клиентам.
@@ -91,32 +180,58 @@ public:
      */
     void broadcastSystemMessage(const QString &message);
 
+    /**
+     * @brief Рассылает всем клиентам изменение присутствия (presence_delta).
+     *
+     * Вместо полного списка онлайн-пользователей клиенты получают только
+     * событие входа или выхода одного пользователя.
+     * @param username Имя пользователя.
+     * @param joined true — вошёл, false — вышел.
+     */
+    void broadcastPresenceDelta(const QString &username, bool joined);
+
     /**
      * @brief Возвращает список имён всех онлайн-пользователей.
-     * @return Список имён.
+     * @return Отсортированный список имён.
      */
     QStringList getOnlineUsers() const;
 
-private slots:
+protected:
     /**
-     * @brief Обрабатывает новое входящее соединение.
+     * @brief Передаёт принятый дескриптор одному из воркеров.
+     * @param socketDescriptor Дескриптор нового соединения.
      */
-    void handleNewConnection();
+    void incomingConnection(qintptr socketDescriptor) override;
 
+private:
     /**
-     * @brief Обрабатывает готовность клиента к чтению данных.
+     * @brief Возвращает воркер, владеющий сокетом.
      */
-    void handleReadyRead() const;
+    static ServerWorker *workerFor(QTcpSocket *socket);
 
     /**
-     * @brief Обрабатывает отключение клиента.
+     * @brief Выбирает воркер для нового соединения согласно DispatchPolicy.
      */
-    void handleClientDisconnected();
+    ServerWorker *pickWorker();
 
-private:
-    QTcpServer *server;                          ///< Серверный сокет
-    QList<QTcpSocket *> clients;                 ///< Список клиентских сокетов
-    QHash<QTcpSocket *, QString> connectedUsers; ///< Ассоциация сокетов и имён пользователей
+    /**
+     * @brief Кодирует кадр один раз и передаёт его каждому воркеру.
+     * @param json JSON-объект для рассылки.
+     * @param priority Приоритет кадра.
+     * @param write Что сделать с кадром в потоке воркера.
+     */
+    void fanOut(const QJsonObject &json, FramePriority priority,
+                const std::function<void(ServerWorker *, OutboundFrame &, FramePriority)> &write);
+
+    ServerConfig config;                         ///< Параметры запуска
+
+    QList<ServerWorker *> workers;               ///< Воркеры (неизменны после конструктора)
+    QList<QThread *> threads;                    ///< Потоки воркеров
+    int nextWorker = 0;                          ///< Индекс для RoundRobin
+
+    Presence presence;                           ///< Индекс авторизованных пользователей всех воркеров
+    HistoryFrames frames;                        ///< Закодированные последние страницы комнат
+    SessionStore sessions;                       ///< Токены для resume после обрыва связи
 
     CommandHandler *commandHandler;              ///< Обработчик команд
 };
@@ -0,0 +1,72 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <QString>
+#include <QStringList>
+
+#include <chrono>
+
+#include "auth/auth_policy.h"
+#include "database/commit_policy.h"
+#include "database/retention_policy.h"
+#include "database/storage_policy.h"
+
+/**
+ * @brief Стратегия распределения новых соединений между рабочими потоками.
+ */
+enum class DispatchPolicy {
+    RoundRobin,  ///< По кругу
+    LeastLoaded  ///< В поток с наименьшим числом соединений
+};
+
+/**
+ * @brief Пороги исходящей очереди одного клиента (в байтах).
+ *
+ * Выше highWatermark клиент считается медленным: низкоприоритетные кадры
+ * отбрасываются, пока очередь не опустится ниже lowWatermark. При превышении
+ * hardLimit клиент отключается.
+ */
+struct SendQueueLimits {
+    qint64 lowWatermark = 64 * 1024;        ///< Нижний порог (и объём, отдаваемый сокету за раз)
+    qint64 highWatermark = 1024 * 1024;     ///< Верхний порог
+    qint64 hardLimit = 4 * 1024 * 1024;     ///< Предел, после которого клиент отключается
+};
+
+/**
+ * @brief Структура ServerConfig содержит параметры запуска сервера.
+ *
+ * Заполняется из аргументов командной строки в main().
+ */
+struct ServerConfig {
+    quint16 port = 1234;                            ///< Порт, на котором слушает сервер
+    QString databasePath = "database.sqlite";       ///< Путь к файлу базы данных
+
+    /// Количество рабочих потоков. 0 — все соединения обслуживаются в главном потоке.
+    int workerThreads = 0;
+    DispatchPolicy dispatchPolicy = DispatchPolicy::RoundRobin; ///< Стратегия распределения соединений
+
+    SendQueueLimits sendQueue;                      ///< Пороги исходящих очередей клиентов
+    qsizetype maxFrameSize = 1024 * 1024;           ///< Максимальный размер входящего кадра
+
+    /// Сколько кадр может ждать в очереди, чтобы уйти в сокет одной записью с соседними.
+    /// 0 — кадры, накопленные за один проход цикла событий.
+    std::chrono::microseconds writeLatencyBudget{0};
+
+    StoragePolicy storage;                          ///< Бэкенд хранилища и эфемерные комнаты
+    GroupCommitPolicy groupCommit;                  ///< Групповое сохранение сообщений и режим надёжности
+    int storageReaders = 2;                         ///< Соединений только для чтения (0 — чтения в потоке хранилища)
+    qsizetype historyCacheSize = 200;               ///< Последних сообщений каждой комнаты в памяти (0 — без кэша)
+    qsizetype historyCacheRooms = 1024;             ///< Комнат в кэше истории (0 — без ограничения)
+    RetentionPolicy retention;                      ///< Перенос старых сообщений в архивные сегменты
+
+    AuthPolicy auth;                                ///< Хэширование паролей и размер пула для него
+
+    std::chrono::seconds sessionTtl{24 * 60 * 60};  ///< Время жизни токена возобновления сессии
+    /// Сколько после обрыва связи ждать возобновления, прежде чем объявить уход пользователя
+    std::chrono::seconds resumeGrace{30};
+
+    quint16 metricsPort = 9464;                     ///< Порт HTTP-слушателя метрик на 127.0.0.1 (0 — выключен)
+    QStringList adminUsers;                         ///< Пользователи, которым доступна команда stats
+};
+
+#endif // SERVER_CONFIG_H
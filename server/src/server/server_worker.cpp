@@ -0,0 +1,206 @@
+#include "server_worker.h"
+
+#include <QTimer>
+
+#include "command_view.h"
+
+#include "command_handler.h"
+#include "server.h"
+#include "database/database.h"
+#include "database/storage_executor.h"
+#include "log/logging.h"
+#include "metrics/metrics.h"
+
+namespace {
+    Gauge &connectedSockets() {
+        static Gauge &gauge = Metrics::instance().gauge("timp_connected_sockets", "open client connections");
+        return gauge;
+    }
+}
+
+ServerWorker::ServerWorker(Server *serverInstance, CommandHandler *handler)
+    : server(serverInstance), commandHandler(handler) {
+}
+
+void ServerWorker::reserveConnection() {
+    load.fetch_add(1, std::memory_order_relaxed);
+}
+
+int ServerWorker::connectionCount() const {
+    return load.load(std::memory_order_relaxed);
+}
+
+void ServerWorker::addConnection(const qintptr socketDescriptor) {
+    auto *socket = new ClientConnection(server->configuration(), this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qCWarning(lcNet) << "failed to accept connection: " << socket->errorString();
+        socket->deleteLater();
+        load.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    connect(socket, &QTcpSocket::readyRead, this, &ServerWorker::handleReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &ServerWorker::handleClientDisconnected);
+    clients.append(socket);
+    connectedSockets().add(1);
+    qCDebug(lcNet) << "new client connected: " << socket->peerAddress().toString();
+}
+
+void ServerWorker::setUser(QTcpSocket *socket, const QString &username) {
+    connectedUsers[socket] = username;
+}
+
+QString ServerWorker::userBySocket(QTcpSocket *socket) const {
+    return connectedUsers.value(socket, QString());
+}
+
+void ServerWorker::writeToAuthenticated(OutboundFrame &frame, const FramePriority priority) {
+    QList<ClientConnection *> targets;
+    targets.reserve(connectedUsers.size());
+    for (ClientConnection *client: std::as_const(clients)) {
+        if (connectedUsers.contains(client)) {
+            targets.append(client);
+        }
+    }
+    writeFrame(targets, frame, priority);
+}
+
+void ServerWorker::writeToRoom(const QString &room, OutboundFrame &frame, const FramePriority priority) {
+    const auto it = roomMembers.constFind(room);
+    if (it == roomMembers.cend()) return;
+    writeFrame(*it, frame, priority);
+}
+
+void ServerWorker::writeFrame(const QList<ClientConnection *> &targets, OutboundFrame &frame,
+                              const FramePriority priority) {
+    static Histogram &fanoutTime = Metrics::instance().histogram("timp_broadcast_fanout_us",
+                                                                 "time to queue one broadcast on a worker, microseconds");
+    static Counter &fanoutBytes = Metrics::instance().counter("timp_broadcast_bytes_total",
+                                                              "bytes queued to clients by broadcasts");
+    ScopedTimer timer(fanoutTime);
+
+    quint64 bytes = 0;
+    for (ClientConnection *client: targets) {
+        client->enqueue(frame, priority);
+        bytes += frame.bytes(client->wireFormat()).size();
+    }
+    fanoutBytes.add(bytes);
+}
+
+bool ServerWorker::writeToUser(QTcpSocket *socket, const QString &username, OutboundFrame &frame,
+                               const qint64 messageId) {
+    const auto it = connectedUsers.constFind(socket);
+    if (it == connectedUsers.cend() || *it != username) {
+        StorageExecutor::instance().post([messageId] { Database::markUndelivered(messageId); });
+        return false;
+    }
+
+    qobject_cast<ClientConnection *>(socket)->enqueue(frame, FramePriority::Normal);
+    return true;
+}
+
+bool ServerWorker::joinRoom(QTcpSocket *socket, const QString &room) {
+    auto *client = qobject_cast<ClientConnection *>(socket);
+    if (!client || isInRoom(socket, room)) {
+        return false;
+    }
+
+    roomMembers[room].append(client);
+    socketRooms[socket].append(room);
+    return true;
+}
+
+bool ServerWorker::leaveRoom(QTcpSocket *socket, const QString &room) {
+    const auto it = roomMembers.find(room);
+    if (it == roomMembers.end() || !it->removeOne(qobject_cast<ClientConnection *>(socket))) {
+        return false;
+    }
+
+    if (it->isEmpty()) {
+        roomMembers.erase(it);
+    }
+    socketRooms[socket].removeOne(room);
+    return true;
+}
+
+bool ServerWorker::isInRoom(QTcpSocket *socket, const QString &room) const {
+    return socketRooms.value(socket).contains(room);
+}
+
+void ServerWorker::handleReadyRead() {
+    const auto socket = qobject_cast<ClientConnection *>(sender());
+    if (!socket) return;
+
+    FrameReader &reader = socket->frameReader();
+    FrameReader::Result result;
+    do {
+        reader.fill(socket);
+
+        QByteArrayView payload;
+        WireFormat format;
+        while ((result = reader.next(payload, format)) == FrameReader::Result::Frame) {
+            if (payload.isEmpty()) continue;
+            qCDebug(lcNet) << "got data from client:" << payload;
+
+            const std::optional<CommandView> command = CommandView::parse(payload, format);
+            if (!command) {
+                qCWarning(lcNet) << "malformed frame, dropping client" << socket->peerAddress().toString();
+                socket->abort();
+                return;
+            }
+
+            commandHandler->processCommand(socket, *command);
+        }
+
+        if (result == FrameReader::Result::Oversized) {
+            qCWarning(lcNet) << "oversized frame, dropping client" << socket->peerAddress().toString();
+            socket->abort();
+            return;
+        }
+    } while (socket->bytesAvailable() > 0);
+}
+
+void ServerWorker::handleClientDisconnected() {
+    const auto socket = qobject_cast<ClientConnection *>(sender());
+    if (!socket) return;
+
+    // check if user was authenticated
+    if (connectedUsers.contains(socket)) {
+        const QString username = connectedUsers.take(socket);
+        server->removeConnectedUser(username);
+
+        // a client holding a session may resume shortly; the others hear about the leave only if it does not
+        const quint64 disconnect = server->sessionStore().park(username, socketRooms.value(socket));
+        if (disconnect == 0) {
+            announceLeave(username);
+        } else {
+            QTimer::singleShot(server->configuration().resumeGrace, this, [this, username, disconnect] {
+                if (server->sessionStore().expire(username, disconnect)) {
+                    announceLeave(username);
+                }
+            });
+        }
+    }
+
+    const QStringList rooms = socketRooms.take(socket);
+    for (const QString &room: rooms) {
+        const auto it = roomMembers.find(room);
+        if (it != roomMembers.end() && it->removeOne(socket) && it->isEmpty()) {
+            roomMembers.erase(it);
+        }
+    }
+
+    clients.removeOne(socket);
+    connectedSockets().add(-1);
+    load.fetch_sub(1, std::memory_order_relaxed);
+    socket->deleteLater();
+    qCDebug(lcNet) << "client disconnected";
+}
+
+void ServerWorker::announceLeave(const QString &username) {
+    // broadcast leaving
+    server->broadcastSystemMessage(username + " has left the chat");
+
+    // clients patch their user lists instead of receiving the whole list again
+    server->broadcastPresenceDelta(username, false);
+}
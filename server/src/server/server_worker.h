@@ -0,0 +1,145 @@
+#ifndef SERVER_WORKER_H
+#define SERVER_WORKER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QHash>
+
+#include <atomic>
+
+#include "client_connection.h"
+
+class Server;
+class CommandHandler;
+
+/**
+ * @brief Класс ServerWorker обслуживает часть клиентских соединений в своём потоке.
+ *
+ * Каждый воркер живёт в собственном потоке со своим циклом событий и владеет:
+ * - сокетами переданных ему клиентов
+ * - своей долей ассоциаций сокет -> имя пользователя
+ * - индексом комната -> участники среди своих клиентов
+ *
+ * Все методы, кроме reserveConnection() и connectionCount(), вызываются только
+ * из потока воркера.
+ */
+class ServerWorker final : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Конструктор воркера.
+     * @param serverInstance Указатель на объект сервера.
+     * @param handler Общий (не изменяемый после создания) обработчик команд.
+     */
+    ServerWorker(Server *serverInstance, CommandHandler *handler);
+
+    /**
+     * @brief Резервирует место под новое соединение (вызывается из потока сервера).
+     *
+     * Счётчик увеличивается сразу, чтобы стратегия LeastLoaded учитывала
+     * соединения, которые ещё не успели дойти до воркера.
+     */
+    void reserveConnection();
+
+    /**
+     * @brief Возвращает текущее число соединений воркера.
+     */
+    [[nodiscard]] int connectionCount() const;
+
+    /**
+     * @brief Создаёт сокет для принятого дескриптора в потоке воркера.
+     * @param socketDescriptor Дескриптор, полученный в Server::incomingConnection.
+     */
+    void addConnection(qintptr socketDescriptor);
+
+    /**
+     * @brief Привязывает имя пользователя к сокету.
+     */
+    void setUser(QTcpSocket *socket, const QString &username);
+
+    /**
+     * @brief Возвращает имя пользователя по сокету или пустую строку.
+     */
+    [[nodiscard]] QString userBySocket(QTcpSocket *socket) const;
+
+    /**
+     * @brief Ставит кадр в очереди всех авторизованных клиентов воркера.
+     * @param frame Кадр; каждый клиент получает его в своём формате.
+     * @param priority Приоритет кадра.
+     */
+    void writeToAuthenticated(OutboundFrame &frame, FramePriority priority);
+
+    /**
+     * @brief Ставит кадр в очередь одного клиента, если он всё ещё подключён как username.
+     *
+     * Указатель только сравнивается со своими соединениями и не разыменовывается,
+     * пока не найден среди них. Если клиента уже нет, сообщение messageId
+     * помечается недоставленным.
+     * @return true если кадр поставлен в очередь.
+     */
+    bool writeToUser(QTcpSocket *socket, const QString &username, OutboundFrame &frame, qint64 messageId);
+
+    /**
+     * @brief Добавляет клиента в комнату.
+     * @return false если клиент уже в комнате.
+     */
+    bool joinRoom(QTcpSocket *socket, const QString &room);
+
+    /**
+     * @brief Убирает клиента из комнаты.
+     * @return false если клиента в комнате не было.
+     */
+    bool leaveRoom(QTcpSocket *socket, const QString &room);
+
+    /**
+     * @brief Проверяет, состоит ли клиент в комнате.
+     */
+    [[nodiscard]] bool isInRoom(QTcpSocket *socket, const QString &room) const;
+
+    /**
+     * @brief Ставит кадр в очереди участников комнаты среди клиентов воркера.
+     * @param room Имя комнаты.
+     * @param frame Кадр; каждый клиент получает его в своём формате.
+     * @param priority Приоритет кадра.
+     */
+    void writeToRoom(const QString &room, OutboundFrame &frame, FramePriority priority);
+
+private slots:
+    /**
+     * @brief Обрабатывает готовность клиента к чтению данных.
+     */
+    void handleReadyRead();
+
+    /**
+     * @brief Обрабатывает отключение клиента.
+     */
+    void handleClientDisconnected();
+
+private:
+    Server *server;                              ///< Указатель на объект сервера
+    CommandHandler *commandHandler;              ///< Обработчик команд
+
+    QList<ClientConnection *> clients;           ///< Соединения клиентов воркера
+    QHash<QTcpSocket *, QString> connectedUsers; ///< Ассоциация сокетов и имён пользователей
+
+    QHash<QString, QList<ClientConnection *>> roomMembers; ///< Комната -> участники (только клиенты воркера)
+    QHash<QTcpSocket *, QStringList> socketRooms;          ///< Обратный индекс для отключения
+
+    /**
+     * @brief Ставит кадр в очереди переданных клиентов и обновляет метрики рассылки.
+     */
+    static void writeFrame(const QList<ClientConnection *> &targets, OutboundFrame &frame, FramePriority priority);
+
+    /**
+     * @brief Рассылает всем уход пользователя: системное сообщение и presence_delta.
+     *
+     * Для пользователя с сессией вызывается только после отсрочки
+     * ServerConfig::resumeGrace, если он не вернулся командой resume.
+     */
+    void announceLeave(const QString &username);
+
+    std::atomic<int> load{0};                    ///< Число соединений (включая зарезервированные)
+};
+
+#endif // SERVER_WORKER_H
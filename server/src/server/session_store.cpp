@@ -0,0 +1,100 @@
+#include "session_store.h"
+
+#include <QByteArray>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+
+namespace {
+    constexpr qsizetype TokenBytes = 32;
+}
+
+SessionStore::SessionStore(const std::chrono::seconds ttl) : ttl(ttl) {}
+
+QString SessionStore::issue(const QString &username) {
+    QByteArray bytes(TokenBytes, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32 *>(bytes.data()), TokenBytes / sizeof(quint32));
+    const QString token = QString::fromLatin1(bytes.toBase64(QByteArray::Base64UrlEncoding
+                                                             | QByteArray::OmitTrailingEquals));
+
+    QMutexLocker locker(&lock);
+    // logins are rare next to everything else, so expired sessions are swept here
+    prune();
+    if (const auto previous = tokens.constFind(username); previous != tokens.cend()) {
+        sessions.remove(*previous);
+    }
+    sessions.insert(token, {username, {}, false, 0, QDeadlineTimer(ttl)});
+    tokens.insert(username, token);
+    return token;
+}
+
+bool SessionStore::settle(const QString &username) {
+    QMutexLocker locker(&lock);
+    Session *session = find(username);
+    if (!session || !session->lingering) {
+        return false;
+    }
+    session->lingering = false;
+    return true;
+}
+
+std::optional<SessionStore::Session> SessionStore::resume(const QString &token) {
+    QMutexLocker locker(&lock);
+    const auto it = sessions.find(token);
+    if (it == sessions.end() || it->expiry.hasExpired()) {
+        return std::nullopt;
+    }
+
+    Session before = *it;
+    it->lingering = false;
+    it->expiry.setRemainingTime(ttl);
+    return before;
+}
+
+quint64 SessionStore::park(const QString &username, const QStringList &rooms) {
+    QMutexLocker locker(&lock);
+    Session *session = find(username);
+    if (!session) {
+        return 0;
+    }
+    session->rooms = rooms;
+    session->lingering = true;
+    session->disconnect = ++disconnects;
+    return session->disconnect;
+}
+
+bool SessionStore::expire(const QString &username, const quint64 disconnect) {
+    QMutexLocker locker(&lock);
+    const auto token = tokens.constFind(username);
+    if (token == tokens.cend()) {
+        return false;
+    }
+
+    // looked up without find(): a token that expired during the grace period still owes its leave
+    const auto it = sessions.find(*token);
+    if (it == sessions.end() || !it->lingering || it->disconnect != disconnect) {
+        return false;
+    }
+    it->lingering = false;
+    return true;
+}
+
+void SessionStore::prune() {
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        // a lingering session still has a leave to announce; expire() drops the flag first
+        if (it->expiry.hasExpired() && !it->lingering) {
+            tokens.remove(it->username);
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+SessionStore::Session *SessionStore::find(const QString &username) {
+    const auto token = tokens.constFind(username);
+    if (token == tokens.cend()) {
+        return nullptr;
+    }
+    const auto it = sessions.find(*token);
+    return it == sessions.end() || it->expiry.hasExpired() ? nullptr : &*it;
+}
@@ -0,0 +1,99 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <chrono>
+#include <optional>
+
+/**
+ * @brief Класс SessionStore хранит токены возобновления сессий.
+ *
+ * При входе пользователь получает случайный токен. После обрыва связи клиент
+ * переподключается с этим токеном (команда resume) вместо повторного входа:
+ * пароль не проверяется заново, а клиент получает только пропущенные сообщения.
+ *
+ * Отключение пользователя с живой сессией не объявляется сразу: сессия
+ * "зависает" на время отсрочки, и если клиент вернулся за это время, ни
+ * ухода, ни повторного входа остальные не увидят. Номер отключения
+ * позволяет таймеру отсрочки понять, что пользователь успел вернуться.
+ *
+ * У пользователя одна сессия: новый вход заменяет старый токен.
+ * Методы потокобезопасны; хранилище живёт только в памяти сервера.
+ */
+class SessionStore {
+public:
+    /// Состояние сессии
+    struct Session {
+        QString username;
+        QStringList rooms;        ///< Комнаты пользователя на момент отключения
+        bool lingering = false;   ///< Отключился, уход ещё не объявлен
+        quint64 disconnect = 0;   ///< Номер последнего отключения
+        QDeadlineTimer expiry;    ///< Когда токен перестаёт действовать
+    };
+
+    /**
+     * @param ttl Время жизни токена с момента входа или последнего возобновления.
+     */
+    explicit SessionStore(std::chrono::seconds ttl);
+
+    /**
+     * @brief Выдаёт пользователю новый токен, заменяя прежний.
+     * @return Токен (43 символа base64url).
+     */
+    QString issue(const QString &username);
+
+    /**
+     * @brief Снимает отложенный уход пользователя перед новым входом.
+     * @return true если уход ещё не был объявлен, т.е. объявлять вход не нужно.
+     */
+    bool settle(const QString &username);
+
+    /**
+     * @brief Возобновляет сессию по токену.
+     *
+     * Продлевает токен и снимает отложенный уход.
+     * @return Сессия в том состоянии, в каком она была до вызова, или
+     *         std::nullopt для неизвестного либо истёкшего токена.
+     */
+    std::optional<Session> resume(const QString &token);
+
+    /**
+     * @brief Откладывает объявление ухода отключившегося пользователя.
+     * @param username Имя пользователя.
+     * @param rooms Комнаты, в которые клиент вернётся при возобновлении.
+     * @return Номер отключения для expire() или 0, если сессии нет.
+     */
+    quint64 park(const QString &username, const QStringList &rooms);
+
+    /**
+     * @brief Завершает отсрочку после отключения с номером disconnect.
+     * @return true если пользователь так и не вернулся и уход пора объявить.
+     */
+    bool expire(const QString &username, quint64 disconnect);
+
+    /// Удаляем копирование
+    SessionStore(const SessionStore &) = delete;
+    /// Удаляем присваивание
+    SessionStore &operator=(const SessionStore &) = delete;
+
+private:
+    /// Удаляет истёкшие сессии (вызывается под lock)
+    void prune();
+
+    /// Сессия пользователя, если она есть и не истекла (вызывается под lock)
+    Session *find(const QString &username);
+
+    std::chrono::seconds ttl;
+    quint64 disconnects = 0;                 ///< Счётчик отключений для номеров
+
+    mutable QMutex lock;
+    QHash<QString, Session> sessions;        ///< Токен -> сессия
+    QHash<QString, QString> tokens;          ///< Имя пользователя -> токен
+};
+
+#endif // SESSION_STORE_H
@@ -0,0 +1,37 @@
+#include "wire_format.h"
+
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonDocument>
+#include <QtEndian>
+
+#include "log/logging.h"
+
+OutboundFrame::OutboundFrame(const QJsonObject &json) : json(json) {
+}
+
+const QByteArray &OutboundFrame::bytes(const WireFormat format) {
+    QByteArray &cached = format == WireFormat::Cbor ? cborBytes : jsonBytes;
+    if (cached.isEmpty()) {
+        cached = encode(json, format);
+    }
+    return cached;
+}
+
+QByteArray OutboundFrame::encode(const QJsonObject &json, const WireFormat format) {
+    if (format == WireFormat::Json) {
+        return QJsonDocument(json).toJson(QJsonDocument::Compact) + "\n";
+    }
+
+    const QByteArray payload = QCborValue(QCborMap::fromJsonObject(json)).toCbor();
+    // the peer would take a longer payload for a corrupt length and drop the connection
+    if (payload.size() > MaxCborFrameSize) {
+        qCWarning(lcNet) << "dropping oversized frame:" << payload.size() << "bytes";
+        return {};
+    }
+
+    QByteArray frame(LengthPrefixSize, Qt::Uninitialized);
+    qToBigEndian<quint32>(payload.size(), frame.data());
+    frame.append(payload);
+    return frame;
+}
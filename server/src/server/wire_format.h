@@ -0,0 +1,63 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <QByteArray>
+#include <QJsonObject>
+
+/**
+ * @brief Формат кадров на проводе.
+ *
+ * - Json: текстовый JSON, одна строка на кадр (формат по умолчанию, понятен старым клиентам)
+ * - Cbor: 4-байтная длина (big-endian), за ней CBOR-словарь. Старший байт длины
+ *   всегда 0, так как кадры ограничены 16 МиБ.
+ *
+ * Так как JSON-строка никогда не начинается с нулевого байта, принимающая сторона
+ * определяет формат каждого кадра по его первому байту.
+ */
+enum class WireFormat {
+    Json,
+    Cbor
+};
+
+/**
+ * @brief Класс OutboundFrame — исходящий кадр, кодируемый в каждый формат не более одного раза.
+ *
+ * При рассылке одна и та же копия передаётся всем воркерам; формат,
+ * который ещё не был закодирован, кодируется лениво в потоке воркера.
+ */
+class OutboundFrame {
+public:
+    /// Размер префикса длины CBOR-кадра
+    static constexpr qsizetype LengthPrefixSize = 4;
+
+    /// Максимальный размер CBOR-кадра (старший байт префикса должен быть нулём)
+    static constexpr qsizetype MaxCborFrameSize = 0x00FFFFFF;
+
+    /**
+     * @brief Конструктор кадра.
+     * @param json Содержимое кадра.
+     */
+    explicit OutboundFrame(const QJsonObject &json);
+
+    /**
+     * @brief Возвращает кадр, закодированный в указанный формат.
+     * @param format Формат кадра.
+     * @return Готовые к записи в сокет байты; пустой массив, если кадр не помещается в формат.
+     */
+    const QByteArray &bytes(WireFormat format);
+
+    /**
+     * @brief Кодирует JSON-объект в кадр указанного формата.
+     * @param json Содержимое кадра.
+     * @param format Формат кадра.
+     * @return Готовые к записи в сокет байты; пустой массив, если CBOR-кадр больше MaxCborFrameSize.
+     */
+    static QByteArray encode(const QJsonObject &json, WireFormat format);
+
+private:
+    QJsonObject json;     ///< Содержимое кадра
+    QByteArray jsonBytes; ///< Кадр в формате Json (если уже закодирован)
+    QByteArray cborBytes; ///< Кадр в формате Cbor (если уже закодирован)
+};
+
+#endif // WIRE_FORMAT_H
@@ -0,0 +1,128 @@
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QtTest/QtTest>
+
+#include "database/archive_segment.h"
+
+using namespace Qt::StringLiterals;
+
+/**
+ * @brief Тесты формата архивного сегмента: кодирование и разбор.
+ */
+class ArchiveSegmentTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    // сообщения комнат и личные, с пропусками в id, переживают кодирование без изменений
+    void roundTrip();
+
+    // пустой сегмент — пустой список, а не ошибка
+    void emptySegment();
+
+    // похожий на повторы текст сжимается
+    void compresses();
+
+    // время из столбца таблицы попадает в архив в том же виде, в каком его отдаёт таблица
+    void timestampRoundTrip();
+
+    // чужая сигнатура, обрезанный файл и несогласованные столбцы — повреждение
+    void corruptedRejected();
+};
+
+namespace {
+    /// Сравнивает сообщения поле за полем
+    void compareMessages(const QList<ArchivedMessage> &actual, const QList<ArchivedMessage> &expected) {
+        QCOMPARE(actual.size(), expected.size());
+        for (qsizetype i = 0; i < actual.size(); ++i) {
+            QCOMPARE(actual[i].id, expected[i].id);
+            QCOMPARE(actual[i].room, expected[i].room);
+            QCOMPARE(actual[i].sender, expected[i].sender);
+            QCOMPARE(actual[i].recipient, expected[i].recipient);
+            QCOMPARE(actual[i].content, expected[i].content);
+            QCOMPARE(actual[i].timestamp, expected[i].timestamp);
+        }
+    }
+
+    QList<ArchivedMessage> sample() {
+        return {
+            {3, u"general"_s, u"alice"_s, {}, u"hello"_s, u"2026-01-01T10:00:00"_s},
+            {4, u"general"_s, u"bob"_s, {}, u"привет"_s, u"2026-01-01T10:00:01"_s},
+            {17, u"@direct"_s, u"alice"_s, u"bob"_s, u"just for you"_s, u"2026-01-01T10:05:00"_s},
+            {1000000000000, u"dev"_s, u"carol"_s, {}, QString(), u"2026-01-02T00:00:00"_s},
+        };
+    }
+}
+
+void ArchiveSegmentTest::roundTrip() {
+    const QList<ArchivedMessage> messages = sample();
+    const QByteArray data = ArchiveSegment::encode(messages);
+    QVERIFY(data.startsWith(ArchiveSegment::Magic));
+
+    const std::optional<QList<ArchivedMessage>> decoded = ArchiveSegment::decode(data);
+    QVERIFY(decoded);
+    compareMessages(*decoded, messages);
+}
+
+void ArchiveSegmentTest::emptySegment() {
+    const std::optional<QList<ArchivedMessage>> decoded = ArchiveSegment::decode(ArchiveSegment::encode({}));
+    QVERIFY(decoded);
+    QVERIFY(decoded->isEmpty());
+}
+
+void ArchiveSegmentTest::compresses() {
+    QList<ArchivedMessage> messages;
+    qsizetype raw = 0;
+    for (int i = 0; i < 1000; ++i) {
+        messages.append({i + 1, u"general"_s, u"alice"_s, {}, u"status update number %1"_s.arg(i),
+                         u"2026-01-01T10:00:00"_s});
+        raw += messages.last().content.toUtf8().size() + messages.last().timestamp.size();
+    }
+
+    const QByteArray data = ArchiveSegment::encode(messages);
+    QVERIFY2(data.size() < raw / 4, qPrintable(u"%1 bytes for %2 bytes of text"_s.arg(data.size()).arg(raw)));
+
+    const std::optional<QList<ArchivedMessage>> decoded = ArchiveSegment::decode(data);
+    QVERIFY(decoded);
+    compareMessages(*decoded, messages);
+}
+
+void ArchiveSegmentTest::timestampRoundTrip() {
+    // what QSQLITE hands over for the "yyyy-MM-dd HH:mm:ss" column
+    const QDateTime column = QDateTime::fromString(u"2026-01-02 03:04:05"_s, u"yyyy-MM-dd HH:mm:ss"_s);
+    QVERIFY(column.isValid());
+    const QString timestamp = ArchiveSegment::timestamp(column);
+    QCOMPARE(timestamp, u"2026-01-02T03:04:05"_s);
+
+    const QList<ArchivedMessage> messages = {{1, u"general"_s, u"alice"_s, {}, u"hi"_s, timestamp}};
+    const std::optional<QList<ArchivedMessage>> decoded = ArchiveSegment::decode(ArchiveSegment::encode(messages));
+    QVERIFY(decoded);
+    QCOMPARE(decoded->constFirst().timestamp, timestamp);
+    QCOMPARE(QDateTime::fromString(decoded->constFirst().timestamp, Qt::ISODate), column);
+}
+
+void ArchiveSegmentTest::corruptedRejected() {
+    const QByteArray data = ArchiveSegment::encode(sample());
+
+    QVERIFY(!ArchiveSegment::decode(QByteArray()));
+    QVERIFY(!ArchiveSegment::decode(QByteArray(ArchiveSegment::Magic)));
+    QVERIFY(!ArchiveSegment::decode(data.left(data.size() / 2)));
+
+    QByteArray foreign = data;
+    foreign[0] = 'X';
+    QVERIFY(!ArchiveSegment::decode(foreign));
+
+    // a column shorter than the others
+    QCborMap columns;
+    columns["id"_L1] = QCborArray{1, 1};
+    for (const QLatin1StringView name: {"room"_L1, "sender"_L1, "recipient"_L1, "content"_L1, "timestamp"_L1}) {
+        columns[name] = QCborArray{u"x"_s, u"y"_s};
+    }
+    columns["content"_L1] = QCborArray{u"x"_s};
+    const QByteArray uneven = QByteArray(ArchiveSegment::Magic) + qCompress(columns.toCborValue().toCbor());
+    QVERIFY(!ArchiveSegment::decode(uneven));
+}
+
+QTEST_APPLESS_MAIN(ArchiveSegmentTest)
+
+#include "archive_segment_test.moc"
@@ -0,0 +1,112 @@
+#include <QtTest/QtTest>
+
+#include "server/command_view.h"
+#include "server/commands.h"
+
+using namespace Qt::StringLiterals;
+
+/**
+ * @brief Тесты таблицы команд и разбора аргументов запросов.
+ */
+class CommandsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    // каждое имя из CommandNames находится и даёт обратно то же имя
+    void everyNameRoundTrips();
+
+    // похожие и чужие имена не находятся
+    void unknownNamesRejected();
+
+    // limit вне диапазона заменяется значением по умолчанию, отрицательные id — нулём
+    void historyArgumentsClamped();
+
+    // комната без имени — комната по умолчанию
+    void defaultRoom();
+
+    // допустимые имена комнат
+    void roomNameValidation();
+};
+
+namespace {
+    /// Разбирает JSON-команду так же, как это делает сервер
+    CommandView parse(const QByteArray &json) {
+        std::optional<CommandView> command = CommandView::parse(json, WireFormat::Json);
+        if (!command) {
+            qFatal("not a command: %s", json.constData());
+        }
+        return *command;
+    }
+}
+
+void CommandsTest::everyNameRoundTrips() {
+    for (std::size_t i = 0; i < CommandCount; ++i) {
+        const CommandId id = static_cast<CommandId>(i);
+        const std::string_view name = commandName(id);
+        const QString qname = QString::fromLatin1(name.data(), static_cast<qsizetype>(name.size()));
+
+        const std::optional<CommandId> found = commandFromName(qname);
+        QVERIFY2(found, qPrintable(qname));
+        QCOMPARE(*found, id);
+    }
+}
+
+void CommandsTest::unknownNamesRejected() {
+    const QStringList names = {u""_s, u"logi"_s, u"login_"_s, u"Login"_s, u"LOGIN"_s,
+                               u"send-message"_s, u"history"_s, u"логин"_s};
+    for (const QString &name: names) {
+        QVERIFY2(!commandFromName(name), qPrintable(name));
+    }
+}
+
+void CommandsTest::historyArgumentsClamped() {
+    const GetHistoryRequest fits = GetHistoryRequest::parse(
+        parse(R"({"command":"get_history","limit":10,"before_id":42})"));
+    QCOMPARE(fits.limit, 10);
+    QCOMPARE(fits.beforeId, qint64(42));
+    QCOMPARE(fits.afterId, qint64(0));
+
+    const GetHistoryRequest tooMany = GetHistoryRequest::parse(
+        parse(R"({"command":"get_history","limit":100000,"before_id":-5,"after_id":-1})"));
+    QCOMPARE(tooMany.limit, GetHistoryRequest::DefaultLimit);
+    QCOMPARE(tooMany.beforeId, qint64(0));
+    QCOMPARE(tooMany.afterId, qint64(0));
+
+    const GetHistoryRequest zero = GetHistoryRequest::parse(parse(R"({"command":"get_history","limit":0})"));
+    QCOMPARE(zero.limit, GetHistoryRequest::DefaultLimit);
+
+    const SearchRequest search = SearchRequest::parse(
+        parse(R"({"command":"search","query":"  hi  ","offset":100000,"until_id":7})"));
+    QCOMPARE(search.query, u"hi"_s);
+    QCOMPARE(search.offset, SearchRequest::MaxOffset);
+    QCOMPARE(search.untilId, qint64(7));
+}
+
+void CommandsTest::defaultRoom() {
+    const SendMessageRequest noRoom = SendMessageRequest::parse(parse(R"({"command":"send_message","message":" hi "})"));
+    QCOMPARE(noRoom.message, u"hi"_s);
+    QCOMPARE(noRoom.room, QString(DefaultRoom));
+
+    const SendMessageRequest emptyRoom = SendMessageRequest::parse(
+        parse(R"({"command":"send_message","message":"hi","room":""})"));
+    QCOMPARE(emptyRoom.room, QString(DefaultRoom));
+
+    const SendMessageRequest named = SendMessageRequest::parse(
+        parse(R"({"command":"send_message","message":"hi","room":"dev"})"));
+    QCOMPARE(named.room, u"dev"_s);
+}
+
+void CommandsTest::roomNameValidation() {
+    QVERIFY(RoomRequest{u"general"_s}.isValid());
+    QVERIFY(RoomRequest{u"dev_ops-2"_s}.isValid());
+    QVERIFY(RoomRequest{QString(RoomRequest::MaxNameLength, u'a')}.isValid());
+
+    QVERIFY(!RoomRequest{QString()}.isValid());
+    QVERIFY(!RoomRequest{QString(RoomRequest::MaxNameLength + 1, u'a')}.isValid());
+    QVERIFY(!RoomRequest{u"two words"_s}.isValid());
+    QVERIFY(!RoomRequest{u"комната"_s}.isValid());
+}
+
+QTEST_APPLESS_MAIN(CommandsTest)
+
+#include "commands_test.moc"
@@ -0,0 +1,153 @@
+#include <QBuffer>
+#include <QCborArray>
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtEndian>
+#include <QtTest/QtTest>
+
+#include "server/command_view.h"
+#include "server/frame_reader.h"
+#include "server/wire_format.h"
+
+using namespace Qt::StringLiterals;
+
+/**
+ * @brief Тесты разбора входящих кадров: FrameReader и CommandView.
+ */
+class FrameReaderTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    // строка JSON, пришедшая по частям, собирается в один кадр
+    void jsonLineInPieces();
+
+    // кадры обоих форматов подряд в одном чтении
+    void mixedFramesInOneRead();
+
+    // CBOR-кадр из OutboundFrame::encode разбирается в ту же команду
+    void cborRoundTrip();
+
+    // строка ровно в лимит проходит, длиннее — отклоняется, не дожидаясь '\n'
+    void jsonLineLimit();
+
+    // CBOR-кадр с длиной больше лимита отклоняется по одному префиксу
+    void oversizedCborPrefix();
+
+    // кадр, который не является объектом, — не команда
+    void nonObjectRejected();
+};
+
+namespace {
+    /// Отдаёт читателю байты так, как их отдал бы сокет
+    void feed(FrameReader &reader, const QByteArray &bytes) {
+        QBuffer device;
+        device.setData(bytes);
+        QVERIFY(device.open(QIODevice::ReadOnly));
+        reader.fill(&device);
+    }
+}
+
+void FrameReaderTest::jsonLineInPieces() {
+    FrameReader reader(1024);
+    QByteArrayView payload;
+    WireFormat format = WireFormat::Cbor;
+
+    feed(reader, R"({"command":"lo)");
+    QCOMPARE(reader.next(payload, format), FrameReader::Result::NeedMore);
+
+    feed(reader, "gin\"}\r\n");
+    QCOMPARE(reader.next(payload, format), FrameReader::Result::Frame);
+    QCOMPARE(format, WireFormat::Json);
+    QCOMPARE(payload.toByteArray(), QByteArray(R"({"command":"login"})"));
+
+    QCOMPARE(reader.next(payload, format), FrameReader::Result::NeedMore);
+}
+
+void FrameReaderTest::mixedFramesInOneRead() {
+    FrameReader reader(1024);
+    QByteArrayView payload;
+    WireFormat format = WireFormat::Json;
+
+    feed(reader, OutboundFrame::encode(QJsonObject{{"command", "hello"}}, WireFormat::Json)
+                 + OutboundFrame::encode(QJsonObject{{"command", "login"}}, WireFormat::Cbor)
+                 + OutboundFrame::encode(QJsonObject{{"command", "stats"}}, WireFormat::Json));
+
+    const QStringList expected = {"hello", "login", "stats"};
+    const QList<WireFormat> formats = {WireFormat::Json, WireFormat::Cbor, WireFormat::Json};
+    for (qsizetype i = 0; i < expected.size(); ++i) {
+        QCOMPARE(reader.next(payload, format), FrameReader::Result::Frame);
+        QCOMPARE(format, formats[i]);
+        const std::optional<CommandView> command = CommandView::parse(payload, format);
+        QVERIFY(command);
+        QCOMPARE(command->string("command"_L1), expected[i]);
+    }
+    QCOMPARE(reader.next(payload, format), FrameReader::Result::NeedMore);
+}
+
+void FrameReaderTest::cborRoundTrip() {
+    FrameReader reader(1024);
+    QByteArrayView payload;
+    WireFormat format = WireFormat::Json;
+
+    const QJsonObject request{{"command", "send_message"}, {"message", "привет"}, {"room", "general"},
+                              {"limit", 50}, {"rooms", QJsonArray{"a", "b"}}};
+    feed(reader, OutboundFrame::encode(request, WireFormat::Cbor));
+    QCOMPARE(reader.next(payload, format), FrameReader::Result::Frame);
+    QCOMPARE(format, WireFormat::Cbor);
+
+    const std::optional<CommandView> command = CommandView::parse(payload, format);
+    QVERIFY(command);
+    QCOMPARE(command->string("message"_L1), u"привет"_s);
+    QCOMPARE(command->string("room"_L1), u"general"_s);
+    QCOMPARE(command->integer("limit"_L1), qint64(50));
+    QCOMPARE(command->stringList("rooms"_L1), QStringList({"a", "b"}));
+    QVERIFY(!command->contains("missing"_L1));
+}
+
+void FrameReaderTest::jsonLineLimit() {
+    QByteArrayView payload;
+    WireFormat format = WireFormat::Cbor;
+
+    FrameReader fits(16);
+    feed(fits, QByteArray(16, 'x') + '\n');
+    QCOMPARE(fits.next(payload, format), FrameReader::Result::Frame);
+    QCOMPARE(payload.size(), qsizetype(16));
+
+    FrameReader tooLong(16);
+    feed(tooLong, QByteArray(17, 'x') + '\n');
+    QCOMPARE(tooLong.next(payload, format), FrameReader::Result::Oversized);
+
+    // no newline yet, but already more than a frame may hold
+    FrameReader unterminated(16);
+    feed(unterminated, QByteArray(64, 'x'));
+    QCOMPARE(unterminated.next(payload, format), FrameReader::Result::Oversized);
+}
+
+void FrameReaderTest::oversizedCborPrefix() {
+    QByteArrayView payload;
+    WireFormat format = WireFormat::Json;
+
+    QByteArray prefix(OutboundFrame::LengthPrefixSize, Qt::Uninitialized);
+    qToBigEndian<quint32>(17, prefix.data());
+
+    FrameReader reader(16);
+    feed(reader, prefix);
+    QCOMPARE(reader.next(payload, format), FrameReader::Result::Oversized);
+
+    // a prefix alone is not a frame yet
+    FrameReader partial(16);
+    feed(partial, QByteArray(2, '\0'));
+    QCOMPARE(partial.next(payload, format), FrameReader::Result::NeedMore);
+}
+
+void FrameReaderTest::nonObjectRejected() {
+    QVERIFY(!CommandView::parse("[1, 2]", WireFormat::Json));
+    QVERIFY(!CommandView::parse("{\"command\":", WireFormat::Json));
+    const QByteArray array = QCborValue(QCborArray{1, 2}).toCbor();
+    QVERIFY(!CommandView::parse(array, WireFormat::Cbor));
+}
+
+QTEST_APPLESS_MAIN(FrameReaderTest)
+
+#include "frame_reader_test.moc"
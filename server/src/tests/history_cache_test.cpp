@@ -0,0 +1,242 @@
+#include <QtTest/QtTest>
+
+#include "database/database.h"
+#include "database/history_cache.h"
+#include "server/history_frames.h"
+
+using namespace Qt::StringLiterals;
+
+/**
+ * @brief Тесты HistoryCache: границы страниц, флаг complete и вытеснение комнат.
+ *
+ * Хранилище — MemoryStore (бэкенд Memory), поэтому тест не пишет на диск.
+ * Каждый тест работает со своими комнатами: Database общая на весь прогон.
+ */
+class HistoryCacheTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    // комната целиком в буфере: любые страницы без БД, hasMore только внутри буфера
+    void completeRoom();
+
+    // в буфере только хвост комнаты: страница, выходящая за него, — промах
+    void truncatedRoom();
+
+    // листание вперёд возможно, только если после after_id ничего не вытеснено
+    void forwardPaging();
+
+    // добавление по кругу перезаписывает самое старое сообщение
+    void appendWraps();
+
+    // после вытеснения комната без буфера — промах, а не пустая история
+    void roomEviction();
+
+    // кадры вытесненной комнаты забываются и не отдаются по старому поколению
+    void evictedRoomFrames();
+
+private:
+    /// Сохраняет count сообщений в комнату и возвращает их id по возрастанию
+    static QList<qint64> fill(const QString &room, int count);
+
+    /// id сообщений страницы
+    static QList<qint64> ids(const Database::HistoryPage &page);
+};
+
+QList<qint64> HistoryCacheTest::fill(const QString &room, const int count) {
+    QList<Database::NewMessage> messages;
+    for (int i = 0; i < count; ++i) {
+        messages.append({room, u"tester"_s, u"message %1"_s.arg(i)});
+    }
+    if (!Database::saveMessages(messages)) {
+        qFatal("saveMessages failed");
+    }
+
+    QList<qint64> result;
+    for (const Database::NewMessage &message: messages) {
+        result.append(message.id);
+    }
+    return result;
+}
+
+QList<qint64> HistoryCacheTest::ids(const Database::HistoryPage &page) {
+    QList<qint64> result;
+    for (const Database::StoredMessage &message: page.messages) {
+        result.append(message.id);
+    }
+    return result;
+}
+
+void HistoryCacheTest::initTestCase() {
+    StoragePolicy storage;
+    storage.backend = StorageBackend::Memory;
+    storage.memoryRoomLimit = 0;
+    QVERIFY(Database::instance().init({}, Durability::Relaxed, storage));
+}
+
+void HistoryCacheTest::completeRoom() {
+    const QList<qint64> stored = fill(u"complete"_s, 5);
+    HistoryCache &cache = HistoryCache::instance();
+    cache.warm(10);
+
+    // warmed rings have a generation of their own; 0 means no ring at all
+    QVERIFY(cache.generation(u"complete"_s) > 0);
+    QCOMPARE(cache.generation(u"nobody-wrote-here"_s), quint64(0));
+
+    const std::optional<Database::HistoryPage> all = cache.page(u"complete"_s, 50, {});
+    QVERIFY(all);
+    QCOMPARE(ids(*all), stored);
+    QVERIFY(!all->hasMore);
+
+    const std::optional<Database::HistoryPage> newest = cache.page(u"complete"_s, 2, {});
+    QVERIFY(newest);
+    QCOMPARE(ids(*newest), stored.mid(3));
+    QVERIFY(newest->hasMore);
+
+    const std::optional<Database::HistoryPage> before = cache.page(u"complete"_s, 2, {stored[2], 0});
+    QVERIFY(before);
+    QCOMPARE(ids(*before), stored.mid(0, 2));
+    QVERIFY(!before->hasMore);
+
+    // no messages at all is an answer too, as long as no ring was ever evicted
+    const std::optional<Database::HistoryPage> empty = cache.page(u"nobody-wrote-here"_s, 50, {});
+    QVERIFY(empty);
+    QVERIFY(empty->messages.isEmpty());
+    QVERIFY(!empty->hasMore);
+
+    cache.warm(0);
+    QVERIFY(!cache.page(u"complete"_s, 50, {}));
+}
+
+void HistoryCacheTest::truncatedRoom() {
+    const QList<qint64> stored = fill(u"truncated"_s, 20);
+    HistoryCache &cache = HistoryCache::instance();
+    cache.warm(5);
+
+    const std::optional<Database::HistoryPage> newest = cache.page(u"truncated"_s, 3, {});
+    QVERIFY(newest);
+    QCOMPARE(ids(*newest), stored.mid(17));
+    QVERIFY(newest->hasMore);
+
+    // the whole ring is a page, but older messages exist only in the store
+    const std::optional<Database::HistoryPage> ring = cache.page(u"truncated"_s, 5, {});
+    QVERIFY(ring);
+    QCOMPARE(ids(*ring), stored.mid(15));
+    QVERIFY(ring->hasMore);
+
+    QVERIFY(!cache.page(u"truncated"_s, 6, {}));
+    QVERIFY(!cache.page(u"truncated"_s, 3, {stored[16], 0}));
+    QVERIFY(!cache.page(u"truncated"_s, 3, {stored[5], 0}));
+}
+
+void HistoryCacheTest::forwardPaging() {
+    const QList<qint64> stored = fill(u"forward"_s, 20);
+    HistoryCache &cache = HistoryCache::instance();
+    cache.warm(5);
+
+    const std::optional<Database::HistoryPage> next = cache.page(u"forward"_s, 2, {0, stored[15]});
+    QVERIFY(next);
+    QCOMPARE(ids(*next), stored.mid(16, 2));
+    QVERIFY(next->hasMore);
+
+    const std::optional<Database::HistoryPage> last = cache.page(u"forward"_s, 10, {0, stored[17]});
+    QVERIFY(last);
+    QCOMPARE(ids(*last), stored.mid(18));
+    QVERIFY(!last->hasMore);
+
+    const std::optional<Database::HistoryPage> upToDate = cache.page(u"forward"_s, 10, {0, stored[19]});
+    QVERIFY(upToDate);
+    QVERIFY(upToDate->messages.isEmpty());
+    QVERIFY(!upToDate->hasMore);
+
+    // stored[3]..stored[14] are not in memory
+    QVERIFY(!cache.page(u"forward"_s, 10, {0, stored[2]}));
+}
+
+void HistoryCacheTest::appendWraps() {
+    const QList<qint64> stored = fill(u"wraps"_s, 3);
+    HistoryCache &cache = HistoryCache::instance();
+    cache.warm(3);
+
+    const quint64 warmed = cache.generation(u"wraps"_s);
+    QList<qint64> expected = stored;
+    for (int i = 0; i < 2; ++i) {
+        const QList<qint64> added = fill(u"wraps"_s, 1);
+        cache.append(u"wraps"_s, {added[0], u"tester"_s, u"late"_s, {}});
+        expected.append(added[0]);
+    }
+    QVERIFY(cache.generation(u"wraps"_s) > warmed);
+
+    const std::optional<Database::HistoryPage> page = cache.page(u"wraps"_s, 3, {});
+    QVERIFY(page);
+    QCOMPARE(ids(*page), expected.mid(2));
+    // the ring was complete until the first overwrite
+    QVERIFY(page->hasMore);
+    QVERIFY(!cache.page(u"wraps"_s, 4, {}));
+}
+
+void HistoryCacheTest::roomEviction() {
+    fill(u"evict-a"_s, 1);
+    fill(u"evict-b"_s, 1);
+    HistoryCache &cache = HistoryCache::instance();
+    // more rooms in the store than the cache may hold: the rest start out as misses
+    cache.warm(4, 1);
+    QVERIFY(!cache.page(u"nobody-wrote-here"_s, 50, {}));
+
+    const QList<qint64> first = fill(u"evict-new"_s, 1);
+    cache.append(u"evict-new"_s, {first[0], u"tester"_s, u"new"_s, {}});
+    const quint64 generation = cache.generation(u"evict-new"_s);
+    QVERIFY(generation > 0);
+
+    // a new ring does not know whether the room had older messages
+    const std::optional<Database::HistoryPage> page = cache.page(u"evict-new"_s, 1, {});
+    QVERIFY(page);
+    QCOMPARE(ids(*page), first);
+    QVERIFY(page->hasMore);
+    QVERIFY(!cache.page(u"evict-new"_s, 2, {}));
+
+    // the newcomer is now the least recently written room and makes way for the next one
+    const QList<qint64> other = fill(u"evict-other"_s, 1);
+    cache.append(u"evict-other"_s, {other[0], u"tester"_s, u"other"_s, {}});
+    QCOMPARE(cache.generation(u"evict-new"_s), quint64(0));
+    QVERIFY(!cache.page(u"evict-new"_s, 1, {}));
+
+    // a ring created again never repeats a generation it had before
+    const QList<qint64> again = fill(u"evict-new"_s, 1);
+    cache.append(u"evict-new"_s, {again[0], u"tester"_s, u"again"_s, {}});
+    QVERIFY(cache.generation(u"evict-new"_s) > generation);
+}
+
+void HistoryCacheTest::evictedRoomFrames() {
+    fill(u"frames-a"_s, 1);
+    HistoryCache &cache = HistoryCache::instance();
+    HistoryFrames frames;
+    cache.setEvictionListener([&frames](const QString &room) { frames.drop(room); });
+    cache.warm(4, 1);
+
+    const QList<qint64> first = fill(u"frames-room"_s, 1);
+    cache.append(u"frames-room"_s, {first[0], u"tester"_s, u"first"_s, {}});
+    const quint64 generation = cache.generation(u"frames-room"_s);
+    QVERIFY(generation > 0);
+    frames.store(u"frames-room"_s, GetHistoryRequest::DefaultLimit, WireFormat::Json, generation, "frame");
+    QCOMPARE(frames.find(u"frames-room"_s, GetHistoryRequest::DefaultLimit, WireFormat::Json, generation),
+             QByteArray("frame"));
+
+    // the room gets more messages, then loses its ring before anyone asks for its history again
+    const QList<qint64> second = fill(u"frames-room"_s, 1);
+    cache.append(u"frames-room"_s, {second[0], u"tester"_s, u"second"_s, {}});
+    const QList<qint64> other = fill(u"frames-other"_s, 1);
+    cache.append(u"frames-other"_s, {other[0], u"tester"_s, u"other"_s, {}});
+
+    QCOMPARE(cache.generation(u"frames-room"_s), quint64(0));
+    QVERIFY(!cache.page(u"frames-room"_s, GetHistoryRequest::DefaultLimit, {}));
+    QVERIFY(frames.find(u"frames-room"_s, GetHistoryRequest::DefaultLimit, WireFormat::Json, generation).isEmpty());
+    QVERIFY(frames.find(u"frames-room"_s, GetHistoryRequest::DefaultLimit, WireFormat::Json, 0).isEmpty());
+
+    cache.setEvictionListener({});
+}
+
+QTEST_GUILESS_MAIN(HistoryCacheTest)
+
+#include "history_cache_test.moc"
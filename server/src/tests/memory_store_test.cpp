@@ -0,0 +1,179 @@
+#include <QtTest/QtTest>
+
+#include "database/memory_store.h"
+
+using namespace Qt::StringLiterals;
+
+/**
+ * @brief Тесты MemoryStore: страницы истории в обе стороны, предел комнаты,
+ * пользователи и личные сообщения.
+ *
+ * Сообщений больше, чем в одном блоке арены, чтобы страницы пересекали границы блоков.
+ */
+class MemoryStoreTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    // последняя страница и листание назад до начала комнаты
+    void pageBackward();
+
+    // листание вперёд от after_id до самого нового сообщения
+    void pageForward();
+
+    // оба курсора сразу — страница внутри интервала
+    void pageBetween();
+
+    // комната хранит не меньше roomLimit сообщений и отдаёт память целыми блоками
+    void roomLimit();
+
+    // пользователи, личные сообщения и последний id
+    void usersAndDirect();
+};
+
+namespace {
+    constexpr int Messages = 3000;
+
+    /// id сообщений: нечётные, чтобы курсор мог указывать между сообщениями
+    qint64 idAt(const int index) { return 2 * index + 1; }
+
+    /// Сохраняет Messages сообщений в комнату
+    void fill(MemoryStore &store, const QString &room) {
+        QList<MessageStore::NewMessage> messages;
+        for (int i = 0; i < Messages; ++i) {
+            messages.append({room, u"tester"_s, u"message %1"_s.arg(i), idAt(i)});
+        }
+        QVERIFY(store.saveMessages(messages));
+        QVERIFY(!messages.first().timestamp.isEmpty());
+    }
+
+    /// id сообщений страницы
+    QList<qint64> ids(const MessageStore::HistoryPage &page) {
+        QList<qint64> result;
+        for (const MessageStore::StoredMessage &message: page.messages) {
+            result.append(message.id);
+        }
+        return result;
+    }
+
+    /// id сообщений с индексами [from, to)
+    QList<qint64> range(const int from, const int to) {
+        QList<qint64> result;
+        for (int i = from; i < to; ++i) {
+            result.append(idAt(i));
+        }
+        return result;
+    }
+}
+
+void MemoryStoreTest::pageBackward() {
+    MemoryStore store;
+    fill(store, u"general"_s);
+
+    const MessageStore::HistoryPage latest = store.messages(u"general"_s, 50, {});
+    QCOMPARE(ids(latest), range(Messages - 50, Messages));
+    QVERIFY(latest.hasMore);
+    QCOMPARE(latest.messages.first().sender, u"tester"_s);
+    QCOMPARE(latest.messages.last().content, u"message %1"_s.arg(Messages - 1));
+
+    // across the boundary of the first two blocks
+    const MessageStore::HistoryPage crossing = store.messages(u"general"_s, 50, {idAt(1050), 0});
+    QCOMPARE(ids(crossing), range(1000, 1050));
+    QVERIFY(crossing.hasMore);
+
+    // a cursor between two ids
+    const MessageStore::HistoryPage between = store.messages(u"general"_s, 3, {idAt(10) - 1, 0});
+    QCOMPARE(ids(between), range(7, 10));
+
+    const MessageStore::HistoryPage first = store.messages(u"general"_s, 50, {idAt(30), 0});
+    QCOMPARE(ids(first), range(0, 30));
+    QVERIFY(!first.hasMore);
+
+    const MessageStore::HistoryPage exact = store.messages(u"general"_s, 30, {idAt(30), 0});
+    QCOMPARE(ids(exact), range(0, 30));
+    QVERIFY(!exact.hasMore);
+
+    QVERIFY(store.messages(u"general"_s, 50, {idAt(0), 0}).messages.isEmpty());
+    QVERIFY(store.messages(u"elsewhere"_s, 50, {}).messages.isEmpty());
+}
+
+void MemoryStoreTest::pageForward() {
+    MemoryStore store;
+    fill(store, u"general"_s);
+
+    const MessageStore::HistoryPage crossing = store.messages(u"general"_s, 50, {0, idAt(2030)});
+    QCOMPARE(ids(crossing), range(2031, 2081));
+    QVERIFY(crossing.hasMore);
+
+    const MessageStore::HistoryPage last = store.messages(u"general"_s, 50, {0, idAt(Messages - 11)});
+    QCOMPARE(ids(last), range(Messages - 10, Messages));
+    QVERIFY(!last.hasMore);
+
+    const MessageStore::HistoryPage upToDate = store.messages(u"general"_s, 50, {0, idAt(Messages - 1)});
+    QVERIFY(upToDate.messages.isEmpty());
+    QVERIFY(!upToDate.hasMore);
+}
+
+void MemoryStoreTest::pageBetween() {
+    MemoryStore store;
+    fill(store, u"general"_s);
+
+    const MessageStore::HistoryPage page = store.messages(u"general"_s, 50, {idAt(1030), idAt(1019)});
+    QCOMPARE(ids(page), range(1020, 1030));
+    QVERIFY(!page.hasMore);
+
+    const MessageStore::HistoryPage limited = store.messages(u"general"_s, 5, {idAt(1030), idAt(1019)});
+    QCOMPARE(ids(limited), range(1020, 1025));
+    QVERIFY(limited.hasMore);
+}
+
+void MemoryStoreTest::roomLimit() {
+    MemoryStore store(1500);
+    fill(store, u"general"_s);
+    fill(store, u"other"_s);
+
+    // the oldest block goes once the rest still holds the limit
+    const MessageStore::HistoryPage oldest = store.messages(u"general"_s, 50, {idAt(1030), 0});
+    QCOMPARE(ids(oldest), range(1024, 1030));
+    QVERIFY(!oldest.hasMore);
+
+    const MessageStore::HistoryPage kept = store.messages(u"general"_s, Messages, {});
+    QVERIFY(kept.messages.size() >= 1500);
+    QCOMPARE(kept.messages.last().id, idAt(Messages - 1));
+
+    QStringList rooms = store.rooms();
+    rooms.sort();
+    QCOMPARE(rooms, QStringList({u"general"_s, u"other"_s}));
+}
+
+void MemoryStoreTest::usersAndDirect() {
+    MemoryStore store;
+    QCOMPARE(store.lastMessageId().value_or(-1), qint64(0));
+
+    QVERIFY(store.registerUser(u"alice"_s, u"hash-1"_s));
+    QVERIFY(!store.registerUser(u"alice"_s, u"hash-2"_s));
+    QVERIFY(store.userExists(u"alice"_s));
+    QVERIFY(!store.userExists(u"bob"_s));
+    QCOMPARE(store.passwordHash(u"alice"_s).value_or(QString()), u"hash-1"_s);
+    QVERIFY(!store.passwordHash(u"bob"_s));
+    store.updatePasswordHash(u"alice"_s, u"hash-3"_s);
+    QCOMPARE(store.passwordHash(u"alice"_s).value_or(QString()), u"hash-3"_s);
+
+    QVERIFY(store.saveDirectMessage(5, u"alice"_s, u"bob"_s, u"first"_s, false));
+    QVERIFY(store.saveDirectMessage(7, u"alice"_s, u"bob"_s, u"seen"_s, true));
+    QVERIFY(store.saveDirectMessage(9, u"alice"_s, u"carol"_s, u"other"_s, false));
+    QCOMPARE(store.lastMessageId().value_or(-1), qint64(9));
+
+    const QList<QVariantMap> pending = store.takeUndeliveredMessages(u"bob"_s);
+    QCOMPARE(pending.size(), qsizetype(1));
+    QCOMPARE(pending[0]["id"].toLongLong(), qint64(5));
+    QCOMPARE(pending[0]["content"].toString(), u"first"_s);
+    QVERIFY(store.takeUndeliveredMessages(u"bob"_s).isEmpty());
+
+    // a delivery that failed waits for the next login
+    store.markUndelivered(5);
+    QCOMPARE(store.takeUndeliveredMessages(u"bob"_s).size(), qsizetype(1));
+}
+
+QTEST_APPLESS_MAIN(MemoryStoreTest)
+
+#include "memory_store_test.moc"
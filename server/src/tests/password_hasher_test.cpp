@@ -0,0 +1,90 @@
+#include <QtTest/QtTest>
+
+#include "auth/password_hasher.h"
+
+using namespace Qt::StringLiterals;
+
+/**
+ * @brief Тесты PasswordHasher: формат хэша, проверка и решение о пересчёте.
+ *
+ * Итераций мало, чтобы тест шёл быстро: проверяется логика, а не стойкость.
+ */
+class PasswordHasherTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    // верный пароль подходит, неверный — нет; соль у каждого хэша своя
+    void hashAndVerify();
+
+    // хэш с меньшим числом итераций подходит, но помечается для пересчёта
+    void weakerHashNeedsUpgrade();
+
+    // пароль, сохранённый до хэширования, сравнивается как есть и пересчитывается
+    void plaintextNeedsUpgrade();
+
+    // испорченная строка с префиксом схемы не подходит ни к какому паролю
+    void malformedHashRejected();
+};
+
+namespace {
+    constexpr int Iterations = 1000;
+}
+
+void PasswordHasherTest::hashAndVerify() {
+    const QString stored = PasswordHasher::hash(u"correct horse"_s, Iterations);
+    QVERIFY(stored.startsWith(u"pbkdf2-sha256$1000$"_s));
+    QCOMPARE(stored.split(u'$').size(), qsizetype(4));
+    QVERIFY(!stored.contains(u"correct horse"_s));
+
+    const PasswordHasher::Verification right = PasswordHasher::verify(u"correct horse"_s, stored, Iterations);
+    QVERIFY(right.valid);
+    QVERIFY(!right.needsUpgrade);
+
+    const PasswordHasher::Verification wrong = PasswordHasher::verify(u"correct hors"_s, stored, Iterations);
+    QVERIFY(!wrong.valid);
+    QVERIFY(!wrong.needsUpgrade);
+
+    QVERIFY(PasswordHasher::hash(u"correct horse"_s, Iterations) != stored);
+    QVERIFY(PasswordHasher::verify(u"пароль"_s, PasswordHasher::hash(u"пароль"_s, Iterations), Iterations).valid);
+}
+
+void PasswordHasherTest::weakerHashNeedsUpgrade() {
+    const QString stored = PasswordHasher::hash(u"secret"_s, Iterations);
+
+    const PasswordHasher::Verification raised = PasswordHasher::verify(u"secret"_s, stored, Iterations * 2);
+    QVERIFY(raised.valid);
+    QVERIFY(raised.needsUpgrade);
+
+    // lowering the setting never rehashes a stronger hash
+    const PasswordHasher::Verification lowered = PasswordHasher::verify(u"secret"_s, stored, Iterations / 2);
+    QVERIFY(lowered.valid);
+    QVERIFY(!lowered.needsUpgrade);
+
+    // only a successful login may trigger a rehash
+    const PasswordHasher::Verification wrong = PasswordHasher::verify(u"guess"_s, stored, Iterations * 2);
+    QVERIFY(!wrong.valid);
+    QVERIFY(!wrong.needsUpgrade);
+}
+
+void PasswordHasherTest::plaintextNeedsUpgrade() {
+    const PasswordHasher::Verification right = PasswordHasher::verify(u"secret"_s, u"secret"_s, Iterations);
+    QVERIFY(right.valid);
+    QVERIFY(right.needsUpgrade);
+
+    const PasswordHasher::Verification wrong = PasswordHasher::verify(u"secre"_s, u"secret"_s, Iterations);
+    QVERIFY(!wrong.valid);
+    QVERIFY(!wrong.needsUpgrade);
+}
+
+void PasswordHasherTest::malformedHashRejected() {
+    const QStringList broken = {u"pbkdf2-sha256$0$c2FsdA==$a2V5"_s, u"pbkdf2-sha256$x$c2FsdA==$a2V5"_s,
+                                u"pbkdf2-sha256$-5$c2FsdA==$a2V5"_s};
+    for (const QString &stored: broken) {
+        const PasswordHasher::Verification result = PasswordHasher::verify(stored, stored, Iterations);
+        QVERIFY2(!result.valid, qPrintable(stored));
+    }
+}
+
+QTEST_APPLESS_MAIN(PasswordHasherTest)
+
+#include "password_hasher_test.moc"
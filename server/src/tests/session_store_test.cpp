@@ -0,0 +1,124 @@
+#include <QtTest/QtTest>
+
+#include "server/session_store.h"
+
+using namespace Qt::StringLiterals;
+using namespace std::chrono_literals;
+
+/**
+ * @brief Тесты SessionStore: выдача и замена токенов, отсрочка ухода, истечение.
+ */
+class SessionStoreTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    // токен возобновляет сессию своего пользователя; новый вход отменяет старый токен
+    void issueAndResume();
+
+    // возврат в пределах отсрочки отменяет объявление ухода
+    void resumeWithinGrace();
+
+    // уход объявляется ровно один раз и только для последнего отключения
+    void expireOnce();
+
+    // новый вход во время отсрочки тоже отменяет уход
+    void settleBeforeLogin();
+
+    // истёкший токен не возобновляет сессию, но долг объявить уход остаётся
+    void expiredToken();
+};
+
+void SessionStoreTest::issueAndResume() {
+    SessionStore store(1h);
+    const QString token = store.issue(u"alice"_s);
+    QCOMPARE(token.size(), qsizetype(43));
+    QVERIFY(!token.contains(u'+') && !token.contains(u'/') && !token.contains(u'='));
+
+    const std::optional<SessionStore::Session> session = store.resume(token);
+    QVERIFY(session);
+    QCOMPARE(session->username, u"alice"_s);
+    QVERIFY(!session->lingering);
+
+    QVERIFY(!store.resume(u"not-a-token"_s));
+    QVERIFY(!store.resume(QString()));
+
+    const QString replaced = store.issue(u"alice"_s);
+    QVERIFY(replaced != token);
+    QVERIFY(!store.resume(token));
+    QVERIFY(store.resume(replaced));
+
+    // sessions of other users are left alone
+    const QString bob = store.issue(u"bob"_s);
+    QVERIFY(store.resume(replaced));
+    QCOMPARE(store.resume(bob)->username, u"bob"_s);
+}
+
+void SessionStoreTest::resumeWithinGrace() {
+    SessionStore store(1h);
+    const QString token = store.issue(u"alice"_s);
+
+    const quint64 disconnect = store.park(u"alice"_s, {u"general"_s, u"dev"_s});
+    QVERIFY(disconnect > 0);
+
+    const std::optional<SessionStore::Session> session = store.resume(token);
+    QVERIFY(session);
+    QVERIFY(session->lingering);
+    QCOMPARE(session->rooms, QStringList({u"general"_s, u"dev"_s}));
+    QCOMPARE(session->disconnect, disconnect);
+
+    // back in time: the grace timer has nothing to announce
+    QVERIFY(!store.expire(u"alice"_s, disconnect));
+    QVERIFY(!store.resume(token)->lingering);
+}
+
+void SessionStoreTest::expireOnce() {
+    SessionStore store(1h);
+    store.issue(u"alice"_s);
+
+    QCOMPARE(store.park(u"nobody"_s, {}), quint64(0));
+    QVERIFY(!store.expire(u"nobody"_s, 1));
+
+    const quint64 first = store.park(u"alice"_s, {});
+    const quint64 second = store.park(u"alice"_s, {});
+    QVERIFY(second > first);
+
+    // the timer of an earlier disconnect must not announce the later one
+    QVERIFY(!store.expire(u"alice"_s, first));
+    QVERIFY(store.expire(u"alice"_s, second));
+    QVERIFY(!store.expire(u"alice"_s, second));
+}
+
+void SessionStoreTest::settleBeforeLogin() {
+    SessionStore store(1h);
+    store.issue(u"alice"_s);
+    QVERIFY(!store.settle(u"alice"_s));
+    QVERIFY(!store.settle(u"nobody"_s));
+
+    const quint64 disconnect = store.park(u"alice"_s, {u"general"_s});
+    QVERIFY(store.settle(u"alice"_s));
+    QVERIFY(!store.settle(u"alice"_s));
+    QVERIFY(!store.expire(u"alice"_s, disconnect));
+}
+
+void SessionStoreTest::expiredToken() {
+    SessionStore expired(0s);
+    const QString token = expired.issue(u"alice"_s);
+    QVERIFY(!expired.resume(token));
+    QCOMPARE(expired.park(u"alice"_s, {}), quint64(0));
+
+    SessionStore store(1s);
+    const QString lingering = store.issue(u"alice"_s);
+    const quint64 disconnect = store.park(u"alice"_s, {});
+    QVERIFY(disconnect > 0);
+    QTest::qSleep(1100);
+
+    QVERIFY(!store.resume(lingering));
+    // a login of someone else sweeps expired sessions, but not one that still owes a leave
+    store.issue(u"bob"_s);
+    QVERIFY(store.expire(u"alice"_s, disconnect));
+    QVERIFY(!store.expire(u"alice"_s, disconnect));
+}
+
+QTEST_APPLESS_MAIN(SessionStoreTest)
+
+#include "session_store_test.moc"
@@ -0,0 +1,11 @@
+#include "caller_thread.h"
+
+#include <memory>
+
+QObject *CallerThread::sink() {
+    thread_local std::unique_ptr<QObject> sink;
+    if (!sink) {
+        sink = std::make_unique<QObject>();
+    }
+    return sink.get();
+}
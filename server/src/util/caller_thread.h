@@ -0,0 +1,40 @@
+#ifndef CALLER_THREAD_H
+#define CALLER_THREAD_H
+
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+
+/**
+ * @brief Возврат результата фоновой работы в поток, который её запросил.
+ *
+ * Продолжение доставляется не самому context (он может быть удалён, пока
+ * работа идёт в другом потоке), а объекту-приёмнику потока вызывающего, и
+ * выполняется, только если context к тому моменту ещё жив.
+ */
+namespace CallerThread {
+    /**
+     * @brief Возвращает объект текущего потока, в который доставляются продолжения.
+     *
+     * Создаётся при первом обращении и живёт до конца потока, поэтому, в отличие
+     * от context, никогда не удаляется раньше поставленного в него вызова.
+     */
+    QObject *sink();
+
+    /**
+     * @brief Вызывает completion(result) в потоке sink, если guard ещё жив.
+     *
+     * guard и sink должны быть получены в потоке вызывающего до ухода в фоновую работу.
+     */
+    template<typename Completion, typename Result>
+    void complete(const QPointer<QObject> &guard, QObject *sink, Completion completion, Result result) {
+        QMetaObject::invokeMethod(sink, [guard, completion = std::move(completion),
+                                         result = std::move(result)]() mutable {
+            if (guard) {
+                completion(std::move(result));
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+#endif // CALLER_THREAD_H
@@ -0,0 +1,76 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Неблокирующая очередь «много производителей — один потребитель».
+ *
+ * Интрузивная очередь Вьюкова: push() из любого потока — один atomic exchange
+ * и одна запись указателя, без мьютексов; pop() вызывается только из одного
+ * потока-потребителя.
+ *
+ * Между exchange и связыванием узла потребитель может кратковременно не видеть
+ * уже добавленный элемент — он будет получен следующим вызовом pop().
+ *
+ * @tparam T Тип элемента (должен быть default-constructible и перемещаемым).
+ */
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(new Node), tail(head.load(std::memory_order_relaxed)) {
+    }
+
+    ~MpscQueue() {
+        while (pop()) {
+        }
+        delete tail;
+    }
+
+    /// Удаляем копирование
+    MpscQueue(const MpscQueue &) = delete;
+    /// Удаляем присваивание
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    /**
+     * @brief Добавляет элемент в очередь (из любого потока).
+     */
+    void push(T value) {
+        auto *node = new Node(std::move(value));
+        Node *previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Извлекает элемент (только из потока-потребителя).
+     * @return Элемент или std::nullopt, если очередь пуста.
+     */
+    std::optional<T> pop() {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return std::nullopt;
+        }
+
+        T value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return value;
+    }
+
+private:
+    /// Узел очереди; первый узел — заглушка без значения
+    struct Node {
+        explicit Node(T value = T()) : value(std::move(value)) {
+        }
+
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node *> head; ///< Последний добавленный узел (пишут производители)
+    Node *tail;               ///< Последний извлечённый узел (читает потребитель)
+};
+
+#endif // MPSC_QUEUE_H